@@ -302,6 +302,10 @@ export class App implements OnInit, AfterViewInit, OnDestroy {
   ];
 
   private telemetrySocket?: WebSocket;
+  private telemetrySeq = 0;
+  private telemetryKeySeq = new Map<string, number>();
+  private telemetryReconnectId?: ReturnType<typeof setTimeout>;
+  private destroyed = false;
   private logSocket?: WebSocket;
   private widgetIndex = new Map<string, number>();
   private settingsEntryIndex = new Map<string, SettingsEntry>();
@@ -347,6 +351,10 @@ export class App implements OnInit, AfterViewInit, OnDestroy {
   }
 
   ngOnDestroy(): void {
+    this.destroyed = true;
+    if (this.telemetryReconnectId !== undefined) {
+      clearTimeout(this.telemetryReconnectId);
+    }
     if (this.isBrowser) {
       this.telemetrySocket?.close();
       this.logSocket?.close();
@@ -613,12 +621,28 @@ export class App implements OnInit, AfterViewInit, OnDestroy {
       return;
     }
     const protocol = location.protocol === 'https:' ? 'wss' : 'ws';
-    this.telemetrySocket = new WebSocket(`${protocol}://${location.host}/ws/telemetry`);
+    // После переподключения сервер присылает только изменения после последнего полученного seq
+    const since = this.telemetrySeq > 0 ? `?since=${this.telemetrySeq}` : '';
+    this.telemetrySocket = new WebSocket(`${protocol}://${location.host}/ws/telemetry${since}`);
+    this.telemetrySocket.addEventListener('close', () => {
+      if (!this.destroyed) {
+        this.telemetryReconnectId = setTimeout(() => this.connectTelemetry(), 2000);
+      }
+    });
     this.telemetrySocket.addEventListener('message', (event) => {
       try {
         const payload = JSON.parse(event.data as string);
         if (payload?.type === 'telemetry') {
-          this.handleTelemetry(payload.key, payload.value);
+          this.applyTelemetry(payload.key, payload.value, payload.seq);
+        } else if (payload?.type === 'telemetryBatch' && Array.isArray(payload.values)) {
+          for (const item of payload.values) {
+            this.applyTelemetry(item?.key, item?.value, item?.seq);
+          }
+        }
+        // Продолжать можно только с номера, до которого сервер доставил все изменения,
+        // а не с наибольшего пришедшего: другой сегмент может еще держать более старое
+        if (typeof payload?.watermark === 'number' && payload.watermark > this.telemetrySeq) {
+          this.telemetrySeq = payload.watermark;
         }
       } catch {
         // Ignore malformed telemetry payloads
@@ -640,6 +664,17 @@ export class App implements OnInit, AfterViewInit, OnDestroy {
     });
   }
 
+  // Значение не новее уже показанного (например, отложенный пакет после начального среза) отбрасывается
+  private applyTelemetry(key: string, value: unknown, seq: unknown): void {
+    if (typeof seq === 'number') {
+      if (seq <= (this.telemetryKeySeq.get(key) ?? 0)) {
+        return;
+      }
+      this.telemetryKeySeq.set(key, seq);
+    }
+    this.handleTelemetry(key, value);
+  }
+
   private handleTelemetry(key: string, value: unknown): void {
     if (!key) {
       return;
@@ -14,13 +14,17 @@
 #include "core/EventBus.hpp"
 #include "core/MonitorEntry.hpp"
 #include "core/RadioTypes.hpp"
+#include "core/Scheduler.hpp"
+#include "core/ShardedBlackboard.hpp"
 #include "core/Types.hpp"
 #include "logger/DBLogger.hpp"
 #include "logger/Logger.hpp"
 #include "logger/WebSocketLogger.hpp"
 #include "packages/ConfigPackage.hpp"
 #include "packages/DatabasePackage.hpp"
+#include "shm/BbShmMirror.hpp"
 #include "storage/Database.hpp"
+#include "storage/StateFile.hpp"
 
 #include <UtilitaryRS/Crc64.hpp>
 #include <UtilitaryRS/Crc8.hpp>
@@ -30,17 +34,19 @@
 #include <drogon/HttpAppFramework.h>
 #include <drogon/orm/DbClient.h>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <memory>
-#include <thread>
 
 /// \brief Главный класс, описывающий приложение
 class Application {
 	Args args;
 
-	std::shared_ptr<Blackboard> bb;
+	ShardedBlackboard boards; // Пока одна установка, номер установки из радио не приходит
+	std::shared_ptr<Blackboard> bb; // BB этой установки
 	std::shared_ptr<EventBus> bus;
+	std::shared_ptr<Scheduler> scheduler;
 	std::shared_ptr<Database> db;
 	std::unique_ptr<DatabasePackage> dbPackage;
 
@@ -57,21 +63,25 @@ class Application {
 	DrogonApp drogonApp;
 
 	MonitorEntry monitor;
-	bool started;
+	std::unique_ptr<StateFile> state;
+	std::unique_ptr<BbShmMirror> mirror;
+	std::atomic<bool> started;
 
 public:
 	Application(Args &&aArgs, RS::DeviceVersion aVersion) :
 		args{std::move(aArgs)},
-		bb{std::make_shared<Blackboard>()},
+		boards{1},
+		bb{boards.shard(ShardedBlackboard::kLocalInstallation)},
 		bus{std::make_shared<EventBus>()},
+		scheduler{std::make_shared<Scheduler>()},
 		db{args.dbPath ? std::make_shared<Database>(args.dbPath.value()) : nullptr},
 		dbPackage{db ? std::make_unique<DatabasePackage>(bb, db) : nullptr},
 
 		config{args.configPath, bb},
-		radioHandler{args.interfacePath, aVersion, bb, bus},
+		radioHandler{args.interfacePath, aVersion, bb, bus, scheduler},
 
-		pumpControl{bb, bus},
-		lampControl{bb, bus},
+		pumpControl{bb, bus, scheduler},
+		lampControl{bb, bus, scheduler},
 
 		uDevices{bb},
 
@@ -81,6 +91,9 @@ public:
 		drogonApp{rest, sock, filter},
 
 		monitor{bb},
+		state{args.statePath ? std::make_unique<StateFile>(args.statePath.value(), bb,
+			std::vector<std::string>{Names::kPumpDev + Names::kIntPostfix + "."}) : nullptr},
+		mirror{args.shmName ? std::make_unique<BbShmMirror>(bb, mirroredPrefixes(), args.shmName.value()) : nullptr},
 		started{true}
 	{
 		Log::WebSocketLogger::registerSocket(sock);
@@ -91,14 +104,24 @@ public:
 			std::cout << "Config not found, creating..." << std::endl;
 		}
 
-		rest->registerInterfaces(bb, bus);
+		// Теплый рестарт: поверх значений по умолчанию контроллеров кладем сохраненное состояние
+		if (state) {
+			state->restore();
+		}
+
+		rest->registerInterfaces(bb, bus, db);
 		sock->registerInterfaces(bb, bus);
 		rest->initPathRouting();
-		drogonApp.setTerminator([this]() { started = false; });
+		drogonApp.setTerminator([this]() {
+			started = false;
+			started.notify_all();
+		});
 	}
 
 	int run()
 	{
+		bus->start();
+		scheduler->start();
 		radioHandler.start();
 		drogonApp.start();
 		monitor.invoke();
@@ -106,24 +129,109 @@ public:
 
 		bb->printAllKeys();
 
-		std::this_thread::sleep_for(std::chrono::milliseconds{250});
-		radioHandler.probe();
+		const auto warmup = std::chrono::milliseconds{250};
+		scheduler->after("probe", warmup, [this]() { radioHandler.probe(); });
+		scheduler->every("controllers", std::chrono::seconds{1}, [this]() {
+			startControllers();
+			return true;
+		}, warmup);
+		scheduler->every("housekeeping", std::chrono::seconds{6}, [this]() {
+			housekeeping();
+			return true;
+		});
+		// Запись файла с fsync не должна задерживать шаги насоса и радио
+		if (state) {
+			scheduler->background("state", std::chrono::seconds{6}, [this]() {
+				state->save();
+				return true;
+			});
+		}
 
-		while (started) {
-			if (!pumpControl.isStarted() && pumpControl.ready()) {
-				pumpControl.start();
-			}
+		started.wait(true);
+		scheduler->stop();
 
-			std::this_thread::sleep_for(std::chrono::seconds{1});
+		if (state) {
+			state->save(true);
+		}
 
-			if (!lampControl.isStarted() && lampControl.ready()) {
-				lampControl.start();
-			}
+		return 0;
+	}
 
-			std::this_thread::sleep_for(std::chrono::seconds{5});
+	/// \brief Запустить контроллеры, которые готовы и еще не работают (или остановились по ошибке)
+	void startControllers()
+	{
+		if (!pumpControl.isStarted() && pumpControl.ready()) {
+			pumpControl.start(state ? state->restoredAge() : std::chrono::milliseconds{0});
 		}
 
-		return 0;
+		if (!lampControl.isStarted() && lampControl.ready()) {
+			lampControl.start();
+		}
+	}
+
+	void housekeeping()
+	{
+		publishDispatchStats();
+		publishBbStats();
+	}
+
+	/// \brief Записи устройств, доступные сторонним процессам через разделяемую память
+	static std::vector<std::string> mirroredPrefixes()
+	{
+		std::vector<std::string> prefixes;
+		for (const auto &device : {Names::kWaterLevelDev, Names::kPPMMeterDev, Names::kPumpDev, Names::kLampDev,
+				 Names::kUpperLevelDev, Names::kPHMeterDev, Names::kTurbidimeterDev, Names::kTemperatureDev,
+				 Names::kLitreMeterDev, Names::kFlowDetectorDev}) {
+			prefixes.push_back(device + ".");
+		}
+		return prefixes;
+	}
+
+	void publishDispatchStats()
+	{
+		const DispatchStats stats = bb->dispatchStats();
+
+		auto batch = bb->batch();
+		batch.set(Names::kSystemDispatchLag, static_cast<unsigned>(stats.lastLagUs));
+		batch.set(Names::kSystemDispatchMaxLag, static_cast<unsigned>(stats.maxLagUs));
+		batch.set(Names::kSystemDispatchDropped, static_cast<unsigned>(stats.dropped));
+		batch.set(Names::kSystemDispatchQueued, static_cast<unsigned>(stats.queued));
+		batch.set(Names::kSystemDispatchCoalesced, static_cast<unsigned>(stats.coalesced));
+		batch.set(Names::kSystemBbSuppressed, static_cast<unsigned>(bb->suppressedCount()));
+	}
+
+	void publishBbStats()
+	{
+		const BbStats stats = bb->stats();
+		if (!stats.enabled) {
+			return;
+		}
+
+		uint64_t writes = 0;
+		uint64_t rejected = 0;
+		for (const auto &key : stats.keys) {
+			writes += key.writes;
+			rejected += key.rejected;
+		}
+
+		const BbObserverStats *slowest = nullptr;
+		for (const auto &observer : stats.observers) {
+			if (!slowest || observer.latency.percentileUs(99) > slowest->latency.percentileUs(99)) {
+				slowest = &observer;
+			}
+		}
+
+		auto batch = bb->batch();
+		batch.set(Names::kSystemBbWrites, static_cast<unsigned>(writes));
+		batch.set(Names::kSystemBbRejected, static_cast<unsigned>(rejected));
+		batch.set(Names::kSystemBbLockWaitP99, static_cast<unsigned>(stats.exclusiveWait.percentileUs(99)));
+		if (!stats.keys.empty()) {
+			batch.set(Names::kSystemBbHotKey, stats.keys.front().key);
+		}
+		if (slowest) {
+			batch.set(Names::kSystemBbSlowObserver, slowest->name);
+			batch.set(Names::kSystemBbSlowObserverP99, static_cast<unsigned>(slowest->latency.percentileUs(99)));
+		}
 	}
 
 	void testPacket()
@@ -9,6 +9,8 @@ struct Args {
 	std::string interfacePath;             // -i
 	std::string configPath;                // -c
 	std::optional<std::string> dbPath;     // -db
+	std::optional<std::string> statePath;  // -s
+	std::optional<std::string> shmName;    // -shm
 	unsigned logLevel = 0;                 // -D
 };
 
@@ -47,6 +49,22 @@ Args parseArgs(int argc, char* argv[]) {
 			result.dbPath = std::string(argv[++i]);
 		}
 
+		else if (arg == "-s") {
+			if (i + 1 >= argc) {
+				std::cerr << "Ошибка: флаг -s требует путь до файла состояния\n";
+				std::exit(1);
+			}
+			result.statePath = std::string(argv[++i]);
+		}
+
+		else if (arg == "-shm") {
+			if (i + 1 >= argc) {
+				std::cerr << "Ошибка: флаг -shm требует имя сегмента разделяемой памяти\n";
+				std::exit(1);
+			}
+			result.shmName = std::string(argv[++i]);
+		}
+
 		else if (arg == "-D") {
 			if (i + 1 >= argc) {
 				std::cerr << "Ошибка: флаг -D требует числовой аргумент\n";
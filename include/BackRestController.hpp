@@ -1,9 +1,12 @@
 #pragma once
 
+#include "BbSerializers.hpp"
+#include "BbNames.hpp"
 #include "core/Blackboard.hpp"
 #include "core/EventBus.hpp"
 #include "logger/Logger.hpp"
 #include "storage/Database.hpp"
+#include "storage/TelemetryHistory.hpp"
 
 #include <json/value.h>
 #include <drogon/HttpController.h>
@@ -13,11 +16,12 @@
 #include <drogon/WebSocketController.h>
 #include <nlohmann/json.hpp>
 
-#include <any>
 #include <chrono>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -28,6 +32,8 @@ public:
 	ADD_METHOD_TO(BackRestController::getValue, "/entry", drogon::Get);
 	ADD_METHOD_TO(BackRestController::setValue, "/entry", drogon::Put);
 	ADD_METHOD_TO(BackRestController::getHistory, "/history", drogon::Get);
+	ADD_METHOD_TO(BackRestController::getChanges, "/changes", drogon::Get);
+	ADD_METHOD_TO(BackRestController::getStats, "/stats", drogon::Get);
 	METHOD_LIST_END
 
 	void getValue(const drogon::HttpRequestPtr &req, std::function<void(const drogon::HttpResponsePtr &)> &&callback)
@@ -36,72 +42,45 @@ public:
 
 		const auto params = req->getParameters();
 		const std::string query = params.count("q") ? params.at("q") : std::string{};
-		Json::Value result(Json::objectValue);
+		json result = json::object();
 
 		if (!query.empty()) {
+			// Все ключи читаются из одного среза, ответ согласован и BB не блокируется на каждый ключ
+			const auto snap = bb->snapshot();
 			std::istringstream iss(query);
 			std::string key;
 
 			while (std::getline(iss, key, '+')) {
-				if (!bb->has(key)) {
+				const auto *entry = snap->find(key);
+				if (!entry) {
 					HYDRO_LOG_ERROR("Rest: getValue: BB has not key: " + key);
-					result[key] = Json::nullValue;
+					result[key] = nullptr;
 					continue;
 				}
 
-				if (bb->isType<bool>(key)) {
-					if (auto v = bb->get<bool>(key)) result[key] = v.value();
-
-				} else if (bb->isType<unsigned>(key)) {
-					if (auto v = bb->get<unsigned>(key)) result[key] = v.value();
-
-				} else if (bb->isType<int>(key)) {
-					if (auto v = bb->get<int>(key)) result[key] = v.value();
-
-				} else if (bb->isType<float>(key)) {
-					if (auto v = bb->get<unsigned>(key)) result[key] = v.value();
-
-				} else if (bb->isType<std::string>(key)) {
-					if (auto v = bb->get<std::string>(key)) result[key] = v.value();
-
-				} else if (bb->isType<std::chrono::milliseconds>(key)) {
-					if (auto v = bb->get<std::chrono::milliseconds>(key)) result[key] = static_cast<unsigned>(v.value().count());
-
-				} else if (bb->isType<std::chrono::seconds>(key)) {
-					if (auto v = bb->get<std::chrono::seconds>(key)) result[key] = static_cast<unsigned>(v.value().count());
-
-				} else {
-					result[key] = bb->getTypeName(key);
-				}
+				// Сериализатор выбирается по типу хранимого значения, без перебора типов
+				result[key] = BbSerializers::toJson(entry->value());
 			}
 		}
 
-		auto resp = drogon::HttpResponse::newHttpResponse();
-		resp->setStatusCode(drogon::k200OK);
-		resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-		resp->setBody(result.toStyledString());
-		callback(resp);
+		callback(jsonResponse(result));
 	}
 
 	void setValue(const drogon::HttpRequestPtr &req, std::function<void(const drogon::HttpResponsePtr &)> &&callback)
 	{
 		using namespace drogon;
 
-		const std::string bodyStr = std::string(req->getBody());
-		Json::Value input;
-		Json::CharReaderBuilder builder;
-		std::string errs;
-		std::istringstream bodyStream(bodyStr);
+		const json input = json::parse(req->getBody(), nullptr, false);
 
-		if (!Json::parseFromStream(builder, bodyStream, &input, &errs)) {
+		if (input.is_discarded()) {
 			auto resp = HttpResponse::newHttpResponse();
 			resp->setStatusCode(k400BadRequest);
-			resp->setBody(std::string("Invalid JSON: ") + errs);
+			resp->setBody("Invalid JSON");
 			callback(resp);
 			return;
 		}
 
-		if (!input.isObject()) {
+		if (!input.is_object()) {
 			auto resp = HttpResponse::newHttpResponse();
 			resp->setStatusCode(k400BadRequest);
 			resp->setBody("Expected JSON object");
@@ -109,37 +88,33 @@ public:
 			return;
 		}
 
-		bool result = false;
-		for (const auto &name : input.getMemberNames()) {
-			const Json::Value &val = input[name];
-
-			if (bb->has(name)) {
-				// Будем писать в BB по тому типу что даст BB
-				if (bb->isType<bool>(name)) {
-					result = bb->set<bool>(name, val.asBool());
-
-				} else if (bb->isType<unsigned>(name)) {
-					result = bb->set<unsigned>(name, val.asUInt());
-
-				} else if (bb->isType<int>(name)) {
-					result = bb->set<int>(name, val.asInt());
-
-				} else if (bb->isType<float>(name)) {
-					result = bb->set<float>(name, val.asFloat());
-
-				} else if (bb->isType<std::string>(name)) {
-					result = bb->set<std::string>(name, val.asString());
-
-				} else if (bb->isType<std::chrono::seconds>(name)) {
-					result = bb->set<std::chrono::seconds>(name, std::chrono::seconds{val.asUInt()});
-
-				} else if (bb->isType<std::chrono::milliseconds>(name)) {
-					result = bb->set<std::chrono::milliseconds>(name, std::chrono::milliseconds{val.asUInt()});
+		// Сначала разбираем все значения: запрос с неподходящим значением не применяется частично
+		std::vector<std::pair<std::string, BbValue>> values;
+		for (const auto &[name, val] : input.items()) {
+			const auto current = bb->getValue(name);
+			if (!current) {
+				continue;
+			}
 
-				} else {
-					HYDRO_LOG_ERROR("Rest: setValue : unsupported type");
-				}
+			// Тип берется из описания записи, для неописанных (статусы устройств) - из текущего значения
+			const auto *key = Names::findKey(name);
+			const size_t index = key ? key->index : current->index();
+
+			BbValue value;
+			if (!BbSerializers::fromJson(index, val, value)) {
+				HYDRO_LOG_ERROR("Rest: setValue: unsupported value for " + name);
+				auto resp = HttpResponse::newHttpResponse();
+				resp->setStatusCode(k400BadRequest);
+				resp->setBody("Unsupported value for " + name);
+				callback(resp);
+				return;
 			}
+			values.emplace_back(name, std::move(value));
+		}
+
+		bool result = !values.empty();
+		for (const auto &[name, value] : values) {
+			result = bb->setValue(name, value) && result;
 		}
 
 		auto resp = HttpResponse::newHttpResponse();
@@ -153,12 +128,18 @@ public:
 		callback(resp);
 	}
 
-	void registerInterfaces(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aBus)
+	/// \param aDb БД для старой истории, может быть nullptr
+	void registerInterfaces(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aBus,
+		std::shared_ptr<Database> aDb = nullptr)
 	{
 		bb = aBb;
 		bus = aBus;
+		db = aDb;
+		history = std::make_unique<TelemetryHistory>(aBb, aDb);
 	}
 
+	/// \brief История записи (/history?key=K&from=..&to=..&limit=N или /history?key=K&window=секунды)
+	/// Недавний интервал отдается из кольца в памяти, в SQLite уходит только более старая часть
 	void getHistory(const drogon::HttpRequestPtr &req, std::function<void(const drogon::HttpResponsePtr &)> &&callback)
 	{
 		using namespace drogon;
@@ -167,26 +148,40 @@ public:
 		std::string key = params.count("key") ? params.at("key") : "";
 		std::string fromTs = params.count("from") ? params.at("from") : "1970-01-01 00:00:00";
 		std::string toTs = params.count("to") ? params.at("to") : "9999-12-31 23:59:59";
-		size_t limit = params.count("limit") ? std::stoul(params.at("limit")) : 1000;
+		size_t limit = 1000;
+		int64_t fromMs = TelemetryHistory::parseTimestamp(fromTs);
+		int64_t toMs = TelemetryHistory::parseTimestamp(toTs);
 
-		if (key.empty()) {
+		try {
+			if (params.count("limit")) {
+				limit = std::stoul(params.at("limit"));
+			}
+			if (params.count("window")) {
+				toMs = HistoryRing::nowMs();
+				fromMs = toMs - static_cast<int64_t>(std::stoul(params.at("window"))) * 1000;
+			}
+		} catch (const std::exception &) {
+			fromMs = -1;
+		}
+
+		if (key.empty() || fromMs < 0 || toMs < 0) {
 			auto resp = HttpResponse::newHttpResponse();
 			resp->setStatusCode(k400BadRequest);
-			resp->setBody("Missing ?key=");
+			resp->setBody(key.empty() ? "Missing ?key=" : "Invalid interval");
 			callback(resp);
 			return;
 		}
 
-		// Вытащить данные из DB
-		auto items = db->queryHistory(key, fromTs, toTs, limit);
+		const auto items = history->query(key, fromMs, toMs, limit);
 		Json::Value out(Json::arrayValue);
 
-		for (auto &[k, type, value, ts] : items) {
+		for (const auto &sample : items.samples) {
 			Json::Value item;
-			item["key"] = k;
-			item["type"] = type;
-			item["value"] = value;
-			item["timestamp"] = ts;
+			item["key"] = key;
+			item["type"] = items.type;
+			item["value"] = sample.value;
+			item["timestamp"] = TelemetryHistory::formatTimestamp(sample.timestampMs);
+			item["timestampMs"] = static_cast<Json::Int64>(sample.timestampMs);
 			out.append(item);
 		}
 
@@ -194,8 +189,165 @@ public:
 		callback(resp);
 	}
 
+	/// \brief Записи, измененные после номера since (/changes?since=N)
+	/// Клиент сохраняет seq из ответа и в следующий раз запрашивает только разницу
+	void getChanges(const drogon::HttpRequestPtr &req, std::function<void(const drogon::HttpResponsePtr &)> &&callback)
+	{
+		using namespace drogon;
+
+		const auto params = req->getParameters();
+		uint64_t since = 0;
+
+		if (params.count("since")) {
+			try {
+				since = std::stoull(params.at("since"));
+			} catch (const std::exception &) {
+				auto resp = HttpResponse::newHttpResponse();
+				resp->setStatusCode(k400BadRequest);
+				resp->setBody("Invalid ?since=");
+				callback(resp);
+				return;
+			}
+		}
+
+		const BbChangeLog log = bb->changesSince(since);
+		json changes = json::array();
+
+		for (const auto &delta : log.entries) {
+			// Удаленные записи нужны только тому, кто их уже видел
+			if (!BbTypes::hasValue(delta.value) && since == 0) {
+				continue;
+			}
+
+			changes.push_back({{"key", std::string(delta.key)}, {"value", BbSerializers::toJson(delta.value)}, {"version", delta.version},
+				{"seq", delta.seq}});
+		}
+
+		json out{{"seq", log.sequence}, {"changes", std::move(changes)}};
+		callback(jsonResponse(out));
+	}
+
+	/// \brief Инструментирование BB и метрики доставки (/stats?top=N)
+	/// Счетчики и гистограммы BB есть только в сборке с HYDRO_BB_INSTRUMENTATION, иначе enabled = false.
+	/// Метрики шины событий собираются всегда
+	void getStats(const drogon::HttpRequestPtr &req, std::function<void(const drogon::HttpResponsePtr &)> &&callback)
+	{
+		using namespace drogon;
+
+		const auto params = req->getParameters();
+		size_t top = SIZE_MAX;
+
+		if (params.count("top")) {
+			try {
+				top = std::stoul(params.at("top"));
+			} catch (const std::exception &) {
+				auto resp = HttpResponse::newHttpResponse();
+				resp->setStatusCode(k400BadRequest);
+				resp->setBody("Invalid ?top=");
+				callback(resp);
+				return;
+			}
+		}
+
+		const BbStats stats = bb->stats();
+		const DispatchStats dispatch = bb->dispatchStats();
+
+		Json::Value keys(Json::arrayValue);
+		for (size_t i = 0; i < stats.keys.size() && i < top; ++i) {
+			const auto &key = stats.keys[i];
+			Json::Value item;
+			item["key"] = key.key;
+			item["writes"] = static_cast<Json::UInt64>(key.writes);
+			item["changes"] = static_cast<Json::UInt64>(key.changes);
+			item["rejected"] = static_cast<Json::UInt64>(key.rejected);
+			keys.append(item);
+		}
+
+		Json::Value observers(Json::arrayValue);
+		for (const auto &observer : stats.observers) {
+			Json::Value item = toJson(observer.latency);
+			item["name"] = observer.name;
+			item["async"] = observer.async;
+			observers.append(item);
+		}
+
+		Json::Value delivery(Json::objectValue);
+		delivery["delivered"] = static_cast<Json::UInt64>(dispatch.delivered);
+		delivery["dropped"] = static_cast<Json::UInt64>(dispatch.dropped);
+		delivery["coalesced"] = static_cast<Json::UInt64>(dispatch.coalesced);
+		delivery["queued"] = static_cast<Json::UInt64>(dispatch.queued);
+		delivery["maxLagUs"] = static_cast<Json::UInt64>(dispatch.maxLagUs);
+		delivery["suppressed"] = static_cast<Json::UInt64>(bb->suppressedCount());
+
+		// Шина событий по классам приоритета: глубина и задержка до рассылки
+		Json::Value busLanes(Json::arrayValue);
+		Json::Value eventBus(Json::objectValue);
+		if (bus) {
+			static constexpr const char *kLaneNames[kEventPriorities] = {"safety", "command", "routine"};
+			const EventBusStats busStats = bus->stats();
+			eventBus["coalesced"] = static_cast<Json::UInt64>(busStats.coalesced);
+			eventBus["deduplicated"] = static_cast<Json::UInt64>(busStats.deduplicated);
+			for (size_t i = 0; i < kEventPriorities; ++i) {
+				const auto &lane = busStats.lanes[i];
+				Json::Value item = toJson(lane.latency);
+				item["lane"] = kLaneNames[i];
+				item["sent"] = static_cast<Json::UInt64>(lane.sent);
+				item["dispatched"] = static_cast<Json::UInt64>(lane.dispatched);
+				item["dropped"] = static_cast<Json::UInt64>(lane.dropped);
+				item["superseded"] = static_cast<Json::UInt64>(lane.superseded);
+				item["depth"] = static_cast<Json::UInt64>(lane.depth);
+				busLanes.append(item);
+			}
+		}
+
+		Json::Value out(Json::objectValue);
+		out["enabled"] = stats.enabled;
+		out["keys"] = keys;
+		out["observers"] = observers;
+		out["exclusiveWait"] = toJson(stats.exclusiveWait);
+		out["sharedWait"] = toJson(stats.sharedWait);
+		out["dispatch"] = delivery;
+		eventBus["lanes"] = busLanes;
+		out["eventBus"] = eventBus;
+
+		auto resp = HttpResponse::newHttpJsonResponse(out);
+		callback(resp);
+	}
+
 private:
 	std::shared_ptr<Blackboard> bb;
 	std::shared_ptr<EventBus> bus;
 	std::shared_ptr<Database> db;
+	std::unique_ptr<TelemetryHistory> history;
+
+	static Json::Value toJson(const LatencyHistogram::Snapshot &h)
+	{
+		Json::Value buckets(Json::arrayValue);
+		for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+			if (h.buckets[i] == 0) {
+				continue;
+			}
+			Json::Value bucket;
+			bucket["leUs"] = static_cast<Json::UInt64>(LatencyHistogram::upperBoundUs(i));
+			bucket["count"] = static_cast<Json::UInt64>(h.buckets[i]);
+			buckets.append(bucket);
+		}
+
+		Json::Value out(Json::objectValue);
+		out["count"] = static_cast<Json::UInt64>(h.count);
+		out["p50Us"] = static_cast<Json::UInt64>(h.percentileUs(50));
+		out["p99Us"] = static_cast<Json::UInt64>(h.percentileUs(99));
+		out["maxUs"] = static_cast<Json::UInt64>(h.maxUs);
+		out["buckets"] = buckets;
+		return out;
+	}
+
+	static drogon::HttpResponsePtr jsonResponse(const json &aBody)
+	{
+		auto resp = drogon::HttpResponse::newHttpResponse();
+		resp->setStatusCode(drogon::k200OK);
+		resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+		resp->setBody(aBody.dump());
+		return resp;
+	}
 };
@@ -1,8 +1,8 @@
 #pragma once
 
+#include "BbSerializers.hpp"
 #include "BbNames.hpp"
 #include "logger/Logger.hpp"
-#include <any>
 #include <chrono>
 #include <core/Blackboard.hpp>
 #include <core/EventBus.hpp>
@@ -13,6 +13,8 @@
 #include <drogon/WebSocketConnection.h>
 #include <drogon/WebSocketController.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <string_view>
@@ -24,11 +26,31 @@ class BackWebSocket : public drogon::WebSocketController<BackWebSocket, false>,
 public:
 	BackWebSocket() = default;
 
-	// AbstractEntryObserver interface
-	void onPrefixUpdated(std::string_view /*prefix*/, std::string_view entry, const std::any &value) override
+	// AbstractPrefixObserver interface
+	void onPrefixUpdated(std::string_view prefix, std::string_view entry, const BbValue &value) override
 	{
-		nlohmann::json msg{{"type", "telemetry"}, {"key", entry}, {"value", toJson(value)}};
-		auto str = msg.dump();
+		onPrefixChanged(BbChange{prefix, entry, &value});
+	}
+
+	void onPrefixChanged(const BbChange &change) override
+	{
+		// seq записи отсеивает устаревшие значения, watermark - номер для продолжения после переподключения
+		nlohmann::json msg{{"type", "telemetry"}, {"key", change.entry}, {"value", valueOf(change)},
+			{"seq", change.seq}, {"watermark", bb->deliveredSequence(this)}};
+		broadcastTelemetry(msg.dump());
+	}
+
+	void onPrefixBatchUpdated(const std::vector<BbChange> &changes) override
+	{
+		// Один кадр на пакет вместо кадра на каждую запись
+		nlohmann::json values = nlohmann::json::array();
+		for (const auto &change : changes) {
+			values.push_back({{"key", change.entry}, {"value", valueOf(change)}, {"seq", change.seq}});
+		}
+
+		// Сегменты сбрасываются независимо, поэтому наибольший seq пакета продолжением служить не может
+		nlohmann::json msg{{"type", "telemetryBatch"}, {"values", std::move(values)},
+			{"watermark", bb->deliveredSequence(this)}};
 		broadcastTelemetry(msg.dump());
 	}
 
@@ -39,7 +61,7 @@ public:
 
 		if (path == "/ws/telemetry") {
 			telemetryClients.insert(conn);
-			sendInitialTelemetry(conn);
+			sendInitialTelemetry(conn, parseSince(req));
 		} else if (path == "/ws/logs") {
 			logClients.insert(conn);
 		}
@@ -56,12 +78,34 @@ public:
 		HYDRO_LOG_STATUS("Web socket closed");
 	}
 
+	/// \brief Запрос недавней истории для графика: {"type":"history","key":K,"window":секунды}
+	/// Ответ берется только из кольца в памяти, SQLite здесь не трогается
 	void handleNewMessage(const drogon::WebSocketConnectionPtr &conn, std::string &&message,
 		const drogon::WebSocketMessageType &type) override
 	{
-		(void)message;
-		(void)conn;
-		(void)type;
+		if (type != drogon::WebSocketMessageType::Text) {
+			return;
+		}
+
+		const auto request = nlohmann::json::parse(message, nullptr, false);
+		if (request.is_discarded() || request.value("type", "") != "history" || !request.contains("key")
+			|| !request["key"].is_string()) {
+			return;
+		}
+
+		const std::string key = request["key"];
+		const int64_t windowMs = request.value("window", kHistoryWindow.count()) * 1000;
+		const int64_t now = HistoryRing::nowMs();
+		const BbHistory history = bb->history(key, now - windowMs, now);
+
+		nlohmann::json samples = nlohmann::json::array();
+		for (const auto &sample : history.samples) {
+			samples.push_back({sample.timestampMs, sample.value});
+		}
+
+		nlohmann::json msg{{"type", "history"}, {"key", key}, {"enabled", history.enabled},
+			{"coveredFrom", history.coveredFromMs}, {"samples", std::move(samples)}};
+		conn->send(msg.dump());
 	}
 
 	void registerInterfaces(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aBus)
@@ -69,9 +113,12 @@ public:
 		bb = aBb;
 		bus = aBus;
 
-		bb->subscribeToPrefix(".telem", this);
-		bb->subscribeToPrefix(".int", this);
-		bb->subscribeToPrefix(".config", this);
+		// Рассылка клиентам не должна задерживать писателей BB. Дашборду хватает 4 обновлений в секунду,
+		// датчики вроде waterLevel меняются каждый кадр, промежуточные значения схлопываются
+		const SubscribeOptions options{Delivery::Async, 256, kTelemetryInterval};
+		bb->subscribeToSegment(Names::kTelemPostfix, this, options);
+		bb->subscribeToSegment(Names::kIntPostfix, this, options);
+		bb->subscribeToSegment(Names::kConfigPostfix, this, options);
 	}
 
 	void log(Log::Level aLevel, std::string &aMsg)
@@ -84,12 +131,21 @@ public:
 		broadcastLogs(message);
 	}
 
+	/// \brief Значение BB в JSON для кадра телеметрии
+	static nlohmann::json toJson(const BbValue &v)
+	{
+		return BbSerializers::toJson(v);
+	}
+
 	WS_PATH_LIST_BEGIN
 	WS_PATH_ADD("/ws/telemetry", drogon::Get);
 	WS_PATH_ADD("/ws/logs", drogon::Get);
 	WS_PATH_LIST_END
 
 private:
+	static constexpr std::chrono::milliseconds kTelemetryInterval{250};
+	static constexpr std::chrono::seconds kHistoryWindow{600};
+
 	std::shared_ptr<Blackboard> bb;
 	std::shared_ptr<EventBus> bus;
 
@@ -98,25 +154,71 @@ private:
 
 	std::recursive_mutex mutex;
 
-	void sendInitialTelemetry(const drogon::WebSocketConnectionPtr &conn)
+	/// \brief Номер изменения, с которого клиент хочет продолжить (/ws/telemetry?since=N)
+	/// \return 0 если клиент подключается впервые
+	static uint64_t parseSince(const drogon::HttpRequestPtr &req)
 	{
-		const std::vector<std::string_view> telemKeys = bb->getKeysByPrefix(Names::kTelemPostfix);
-		for (const auto &key : telemKeys) {
-			nlohmann::json msg{{"type", "telemetry"}, {"key", key}, {"value", toJson(bb->getAny(key).value())}};
-			conn->send(msg.dump());
+		const auto &params = req->getParameters();
+		auto it = params.find("since");
+		if (it == params.end()) {
+			return 0;
 		}
 
-		const std::vector<std::string_view> configKeys = bb->getKeysByPrefix(Names::kConfigPostfix);
-		for (const auto &key : configKeys) {
-			nlohmann::json msg{{"type", "telemetry"}, {"key", key}, {"value", toJson(bb->getAny(key).value())}};
-			conn->send(msg.dump());
+		try {
+			return std::stoull(it->second);
+		} catch (const std::exception &) {
+			return 0;
 		}
+	}
 
-		const std::vector<std::string_view> intKeys = bb->getKeysByPrefix(Names::kIntPostfix);
-		for (const auto &key : intKeys) {
-			nlohmann::json msg{{"type", "telemetry"}, {"key", key}, {"value", toJson(bb->getAny(key).value())}};
-			conn->send(msg.dump());
+	/// \brief Отправить клиенту состояние одним кадром
+	/// Новый клиент получает срез BB, переподключившийся - только записи, измененные после since.
+	/// Значения среза помечены номером среза: более старые значения из следующих кадров клиент отбросит
+	void sendInitialTelemetry(const drogon::WebSocketConnectionPtr &conn, uint64_t since)
+	{
+		nlohmann::json values = nlohmann::json::array();
+		uint64_t seq;
+
+		if (since == 0) {
+			const auto snap = bb->snapshot();
+			seq = snap->sequence();
+			for (const auto &entry : snap->all()) {
+				if (isPublished(entry.key)) {
+					values.push_back({{"key", entry.key}, {"value", toJson(entry.value())}, {"seq", seq}});
+				}
+			}
+		} else {
+			const BbChangeLog log = bb->changesSince(since);
+			for (const auto &delta : log.entries) {
+				if (!isPublished(delta.key)) {
+					continue;
+				}
+
+				if (BbTypes::hasValue(delta.value)) {
+					values.push_back({{"key", delta.key}, {"value", toJson(delta.value)}, {"seq", delta.seq}});
+				} else {
+					// Запись удалена, пока клиента не было
+					values.push_back({{"key", delta.key}, {"value", nullptr}, {"seq", delta.seq}});
+				}
+			}
+			seq = log.sequence;
 		}
+
+		nlohmann::json msg{{"type", "telemetryBatch"}, {"values", std::move(values)}, {"watermark", seq}};
+		conn->send(msg.dump());
+	}
+
+	/// \brief Значение изменения для кадра, удаленная запись уходит как null, как и в changesSince
+	static nlohmann::json valueOf(const BbChange &change)
+	{
+		return change.removed ? nlohmann::json(nullptr) : toJson(*change.value);
+	}
+
+	static bool isPublished(std::string_view key)
+	{
+		return KeyPattern::hasSegment(key, KeyPattern::normalizeSegment(Names::kTelemPostfix))
+			|| KeyPattern::hasSegment(key, KeyPattern::normalizeSegment(Names::kConfigPostfix))
+			|| KeyPattern::hasSegment(key, KeyPattern::normalizeSegment(Names::kIntPostfix));
 	}
 
 	void broadcastTelemetry(const std::string &msg)
@@ -136,28 +238,4 @@ private:
 			if (c->connected())
 				c->send(msg);
 	}
-
-	static nlohmann::json toJson(const std::any &v)
-	{
-		// clang-format off
-		if (v.type() == typeid(int)) return std::any_cast<int>(v);
-		if (v.type() == typeid(double)) return std::any_cast<double>(v);
-		if (v.type() == typeid(float)) return std::any_cast<float>(v);
-		if (v.type() == typeid(bool)) return std::any_cast<bool>(v);
-		if (v.type() == typeid(std::string)) return std::any_cast<std::string>(v);
-		if (v.type() == typeid(uint64_t)) return std::any_cast<uint64_t>(v);
-		if (v.type() == typeid(DeviceStatus)) return std::any_cast<int>(v);
-		// clang-format on
-
-		if (v.type() == typeid(unsigned)) {
-			const unsigned value = std::any_cast<unsigned>(v);
-			return value;
-		}
-		if (v.type() == typeid(std::chrono::seconds)) {
-			const auto seconds = std::any_cast<std::chrono::seconds>(v);
-			return static_cast<unsigned>(seconds.count());
-		}
-
-		return "unsupported";
-	}
 };
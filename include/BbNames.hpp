@@ -1,6 +1,10 @@
 #pragma once
 
+#include "core/BbKey.hpp"
+
+#include <chrono>
 #include <string>
+#include <string_view>
 
 namespace Names {
 
@@ -42,36 +46,70 @@ static constexpr std::string kRsPostfix      = ".rs";
 static constexpr std::string kValueEnder     = ".value";
 static constexpr std::string kStatusEnder    = ".status";
 static constexpr std::string kStatusStrEnder = ".statusStr";
+// Описания записей: имя, тип и единица измерения. Имена собраны по схеме выше,
+// тип проверяется при создании BlackboardEntry, а REST/WS выбирают по нему сериализатор
 // Предсоставленные имена подписок
-static const std::string kTelemPipe          = kMultiControllerDev + kRsPostfix + ".data";
-static const std::string kTelemBridgeStatus  = kBridgeDev + kRsPostfix + ".status";
+inline constexpr BbKey<HydroRS::MultiControllerTelem> kTelemPipe{"multiController.rs.data"};
+inline constexpr BbKey<DeviceStatus> kTelemBridgeStatus{"bridge.rs.status"};
 
-static const std::string kLitreMeterFullVal  = kLitreMeterDev + kIntPostfix + ".fullValue";
-static const std::string kLitreMeterTankVal  = kLitreMeterDev + kIntPostfix + ".tankValue";
-static const std::string kLitreMeterTubeVal  = kLitreMeterDev + kIntPostfix + ".tubeValue";
-static const std::string kLitreMeterCalibLit = kLitreMeterDev + kConfigPostfix + "calLitre"; // Калибровочное значение литров
-static const std::string kLitreMeterCalibLev = kLitreMeterDev + kConfigPostfix + "calLevel"; // Калибровочное значение уровня
+inline constexpr BbKey<float> kLitreMeterFullVal  {"litreMeter.int.fullValue", "l"};
+inline constexpr BbKey<float> kLitreMeterTankVal  {"litreMeter.int.tankValue", "l"};
+inline constexpr BbKey<float> kLitreMeterTubeVal  {"litreMeter.int.tubeValue", "l"};
+// Калибровочные точки, к имени добавляется номер. Точки между сегментами нет исторически,
+// имена уже лежат в конфигах пользователей
+inline constexpr auto kLitreMeterCalibLit = bbFamily<float>("litreMeter.configcalLitre", "l"); // Калибровочное значение литров
+inline constexpr auto kLitreMeterCalibLev = bbFamily<float>("litreMeter.configcalLevel", "%"); // Калибровочное значение уровня
 // Параметры
-static const std::string kLampEnabled        = kLampDev + kConfigPostfix + ".enabled"; // bool
-static const std::string kLampOnTime         = kLampDev + kConfigPostfix + ".onTime"; // secs
-static const std::string kLampOffTime        = kLampDev + kConfigPostfix + ".offTime"; // secs
+inline constexpr BbKey<bool> kLampEnabled         {"lamp.config.enabled"};
+inline constexpr BbKey<int> kLampOnTime           {"lamp.config.onTime", "min"}; // Минута суток
+inline constexpr BbKey<int> kLampOffTime          {"lamp.config.offTime", "min"};
 
-static const std::string kPumpEnabled        = kPumpDev + kConfigPostfix + ".enabled"; // bool
-static const std::string kPumpMode           = kPumpDev + kConfigPostfix + ".mode"; // PumpModes (Swing..)
-static const std::string kPumpOnTime         = kPumpDev + kConfigPostfix + ".onTime"; // secs
-static const std::string kPumpOffTime        = kPumpDev + kConfigPostfix + ".offTime"; // sec
-static const std::string kPumpSwingTime      = kPumpDev + kConfigPostfix + ".swingTime"; // sec
-static const std::string kPumpValidTime      = kPumpDev + kConfigPostfix + ".validTime"; // sec
-static const std::string kPumpMaxFloodTime   = kPumpDev + kConfigPostfix + ".maxFloodTime"; // sec
+inline constexpr BbKey<bool> kPumpEnabled         {"pump.config.enabled"};
+inline constexpr BbKey<PumpModes> kPumpMode       {"pump.config.mode"};
+inline constexpr BbKey<std::chrono::seconds> kPumpOnTime       {"pump.config.onTime", "s"};
+inline constexpr BbKey<std::chrono::seconds> kPumpOffTime      {"pump.config.offTime", "s"};
+inline constexpr BbKey<std::chrono::seconds> kPumpSwingTime    {"pump.config.swingTime", "s"};
+inline constexpr BbKey<std::chrono::seconds> kPumpValidTime    {"pump.config.validTime", "s"};
+inline constexpr BbKey<std::chrono::seconds> kPumpMaxFloodTime {"pump.config.maxFloodTime", "s"};
 
-static const std::string kBridgeMacs         = kBridgeDev + kConfigPostfix + ".mac"; // Список со строками
-static const std::string kSystemMaintance    = kSystemDev + kConfigPostfix + ".maintance"; // bool
-static const std::string kWaterLevelMinLevel = kWaterLevelDev + kConfigPostfix + ".minValue"; // значение от 0 до 100
+inline constexpr auto kBridgeMacs = bbFamily<std::string>("bridge.config.mac"); // Строки .1 - .6
+inline constexpr BbKey<bool> kSystemMaintance     {"system.config.maintance"};
+inline constexpr BbKey<float> kWaterLevelMinLevel {"waterLevel.config.minValue", "%"}; // значение от 0 до 100
 // Внутренние переменные для работы
-static const std::string kPumpPlainType      = kPumpDev + kIntPostfix + ".plainType"; // Осушение-орошение
-static const std::string kPumpNextSwitchTime = kPumpDev + kIntPostfix + ".nextSwitchTime"; // время до переключения
-static const std::string kPumpDesiredState   = kPumpDev + kIntPostfix + ".desiredState"; // Желаемое состояние насоса
-static const std::string kPumpSwingState     = kPumpDev + kIntPostfix + ".swingState"; // состояние качелей
+inline constexpr BbKey<PlainType> kPumpPlainType      {"pump.int.plainType"}; // Осушение-орошение
+inline constexpr BbKey<std::chrono::seconds> kPumpNextSwitchTime   {"pump.int.nextSwitchTime", "s"}; // время до переключения
+inline constexpr BbKey<bool> kPumpDesiredState        {"pump.int.desiredState"}; // Желаемое состояние насоса
+inline constexpr BbKey<SwingState> kPumpSwingState    {"pump.int.swingState"}; // состояние качелей
+
+inline constexpr BbKey<unsigned> kSystemDispatchLag       {"system.int.dispatchLag", "us"}; // последняя задержка доставки
+inline constexpr BbKey<unsigned> kSystemDispatchMaxLag    {"system.int.dispatchMaxLag", "us"};
+inline constexpr BbKey<unsigned> kSystemDispatchDropped   {"system.int.dispatchDropped"}; // отброшено оповещений
+inline constexpr BbKey<unsigned> kSystemDispatchQueued    {"system.int.dispatchQueued"}; // в очередях
+inline constexpr BbKey<unsigned> kSystemDispatchCoalesced {"system.int.dispatchCoalesced"}; // схлопнуто значений
+inline constexpr BbKey<unsigned> kSystemBbSuppressed      {"system.int.bbSuppressed"}; // отсеяно политиками изменения
+// Только со сборкой HYDRO_BB_INSTRUMENTATION
+inline constexpr BbKey<unsigned> kSystemBbWrites          {"system.int.bbWrites"}; // всего записей
+inline constexpr BbKey<unsigned> kSystemBbRejected        {"system.int.bbRejected"}; // отказов записи
+inline constexpr BbKey<std::string> kSystemBbHotKey       {"system.int.bbHotKey"}; // самая записываемая запись
+inline constexpr BbKey<unsigned> kSystemBbLockWaitP99     {"system.int.bbLockWaitP99", "us"}; // ожидание писателей
+inline constexpr BbKey<std::string> kSystemBbSlowObserver {"system.int.bbSlowObserver"}; // самый медленный подписчик
+inline constexpr BbKey<unsigned> kSystemBbSlowObserverP99 {"system.int.bbSlowObserverP99", "us"};
+
+/// \brief Все описанные записи
+inline constexpr BbKeyTable kKeys{kTelemPipe, kTelemBridgeStatus, kLitreMeterFullVal, kLitreMeterTankVal,
+	kLitreMeterTubeVal, kLitreMeterCalibLit, kLitreMeterCalibLev, kLampEnabled, kLampOnTime, kLampOffTime,
+	kPumpEnabled, kPumpMode, kPumpOnTime, kPumpOffTime, kPumpSwingTime, kPumpValidTime, kPumpMaxFloodTime,
+	kBridgeMacs, kSystemMaintance, kWaterLevelMinLevel, kPumpPlainType, kPumpNextSwitchTime, kPumpDesiredState,
+	kPumpSwingState, kSystemDispatchLag, kSystemDispatchMaxLag, kSystemDispatchDropped, kSystemDispatchQueued,
+	kSystemDispatchCoalesced, kSystemBbSuppressed, kSystemBbWrites, kSystemBbRejected, kSystemBbHotKey,
+	kSystemBbLockWaitP99, kSystemBbSlowObserver, kSystemBbSlowObserverP99};
+
+/// \brief Описание записи по имени
+/// \return nullptr если запись не описана, тогда тип определяется по значению в BB
+static inline const BbKeyInfo *findKey(std::string_view aName)
+{
+	return kKeys.find(aName);
+}
 
 static inline std::string getValueNameByDevice(const std::string &aDeviceName)
 {
@@ -0,0 +1,259 @@
+/*!
+@file
+@brief Единый реестр сериализаторов значений Blackboard: JSON, бинарный и SQL
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/BbKey.hpp"
+#include "core/BlackboardValue.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// \brief Сериализаторы по индексу альтернативы BbValue
+/// Набор типов BB закрыт, поэтому реестр - массив, собранный на этапе компиляции, а поиск
+/// сериализатора - одно обращение по value.index(). REST, WebSocket, БД и файл состояния
+/// пользуются одним реестром, новый тип в BbValue автоматически получает все представления
+namespace BbSerializers {
+
+using Json = nlohmann::json;
+
+/// \brief Представления одной альтернативы BbValue
+struct Serializer {
+	std::string_view name; // Имя типа в таблице telemetry и в ответах
+	Json (*toJson)(const BbValue &aValue);
+	bool (*fromJson)(const Json &aJson, BbValue &aOut);
+	void (*toBinary)(const BbValue &aValue, std::vector<uint8_t> &aOut);
+	bool (*fromBinary)(const uint8_t *aData, size_t aSize, BbValue &aOut);
+	std::optional<double> (*toSql)(const BbValue &aValue); // nullopt - в таблицу telemetry не пишется
+};
+
+template<typename T>
+constexpr std::string_view nameOf()
+{
+	// clang-format off
+	if constexpr (std::is_same_v<T, std::monostate>) return "none";
+	else if constexpr (std::is_same_v<T, bool>) return "bool";
+	else if constexpr (std::is_same_v<T, int>) return "int";
+	else if constexpr (std::is_same_v<T, unsigned>) return "u32";
+	else if constexpr (std::is_same_v<T, float>) return "float";
+	else if constexpr (std::is_same_v<T, std::string>) return "string";
+	else if constexpr (std::is_same_v<T, std::chrono::seconds>) return "seconds";
+	else if constexpr (std::is_same_v<T, std::chrono::milliseconds>) return "milliseconds";
+	else if constexpr (std::is_same_v<T, DeviceStatus>) return "status";
+	else if constexpr (std::is_same_v<T, HydroRS::MultiControllerTelem>) return "telemetry";
+	else if constexpr (std::is_same_v<T, RS::DeviceVersion>) return "version";
+	else static_assert(sizeof(T) == 0, "BbValue alternative has no serializer, extend BbSerializers");
+	// clang-format on
+}
+
+/// \brief Поля версии устройства по порядку объявления, структура берется из UtilitaryRS как есть
+inline constexpr std::array<const char *, 6> kVersionFields{"type", "hw", "major", "minor", "revision", "hash"};
+
+template<typename T>
+Json toJsonAs(const BbValue &aValue)
+{
+	[[maybe_unused]] const T &v = *std::get_if<T>(&aValue);
+
+	if constexpr (std::is_same_v<T, std::monostate>) {
+		return nullptr;
+	} else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
+		return v;
+	} else if constexpr (std::is_same_v<T, std::chrono::seconds> || std::is_same_v<T, std::chrono::milliseconds>) {
+		return v.count();
+	} else if constexpr (std::is_enum_v<T>) {
+		return static_cast<int>(v);
+	} else if constexpr (std::is_same_v<T, HydroRS::MultiControllerTelem>) {
+		// Структура упакована, поля копируются по значению, ссылки на них брать нельзя
+		auto flags = [](auto aStatus) { return static_cast<unsigned>(aStatus); };
+		return Json{{"pumpState", static_cast<bool>(v.pumpState)}, {"lampState", static_cast<bool>(v.lampState)},
+			{"upperState", static_cast<bool>(v.upperState)}, {"flowDetector", static_cast<bool>(v.flowDetector)},
+			{"waterLevel", static_cast<float>(v.waterLevel)}, {"ppm", static_cast<float>(v.ppm)},
+			{"temperature", static_cast<float>(v.temperature)}, {"ph", static_cast<float>(v.ph)},
+			{"turbidimeter", static_cast<float>(v.turbidimeter)}, {"pumpCurrent", static_cast<float>(v.pumpCurrent)},
+			{"pumpStatus", flags(v.pumpStatus)}, {"lampStatus", flags(v.lampStatus)},
+			{"upperStatus", flags(v.upperStatus)}, {"waterLevelStatus", flags(v.waterLevelStatus)},
+			{"ppmStatus", flags(v.ppmStatus)}, {"temperatureStatus", flags(v.temperatureStatus)},
+			{"phStatus", flags(v.phStatus)}, {"turbidimeterStatus", flags(v.turbidimeterStatus)}};
+	} else if constexpr (std::is_same_v<T, RS::DeviceVersion>) {
+		const auto [type, hw, major, minor, revision, hash] = v;
+		return Json{{kVersionFields[0], static_cast<unsigned>(type)}, {kVersionFields[1], static_cast<unsigned>(hw)},
+			{kVersionFields[2], static_cast<unsigned>(major)}, {kVersionFields[3], static_cast<unsigned>(minor)},
+			{kVersionFields[4], static_cast<unsigned>(revision)}, {kVersionFields[5], static_cast<uint64_t>(hash)}};
+	} else {
+		static_assert(sizeof(T) == 0, "BbValue alternative has no JSON encoder, extend BbSerializers");
+	}
+}
+
+inline bool isNonNegative(const Json &aJson)
+{
+	return aJson.is_number_unsigned() || (aJson.is_number_integer() && aJson.get<int64_t>() >= 0);
+}
+
+template<typename T>
+bool fromJsonAs(const Json &aJson, BbValue &aOut)
+{
+	if constexpr (std::is_same_v<T, bool>) {
+		if (aJson.is_boolean() || aJson.is_number()) {
+			aOut.emplace<bool>(aJson.is_boolean() ? aJson.get<bool>() : aJson.get<double>() != 0.0);
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, float>) {
+		if (aJson.is_number()) {
+			aOut.emplace<float>(aJson.get<float>());
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, int> || std::is_enum_v<T>) {
+		if (aJson.is_number_integer()) {
+			aOut.emplace<T>(static_cast<T>(aJson.get<int>()));
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, unsigned>) {
+		if (isNonNegative(aJson)) {
+			aOut.emplace<unsigned>(aJson.get<unsigned>());
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, std::string>) {
+		if (aJson.is_string()) {
+			aOut.emplace<std::string>(aJson.get<std::string>());
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, std::chrono::seconds> || std::is_same_v<T, std::chrono::milliseconds>) {
+		if (isNonNegative(aJson)) {
+			aOut.emplace<T>(aJson.get<typename T::rep>());
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, RS::DeviceVersion>) {
+		if (!aJson.is_object()) {
+			return false;
+		}
+
+		// Поле читается, только если оно есть и помещается в свой тип
+		bool complete = true;
+		const auto read = [&aJson, &complete](const char *aName, auto aZero) {
+			using F = decltype(aZero);
+			auto it = aJson.find(aName);
+			if (it == aJson.end() || !isNonNegative(*it) || it->get<uint64_t>() > std::numeric_limits<F>::max()) {
+				complete = false;
+				return aZero;
+			}
+			return static_cast<F>(it->get<uint64_t>());
+		};
+
+		// Поля упакованной структуры присваиваются значением, ссылку на них брать нельзя
+		T version{};
+		auto &[type, hw, major, minor, revision, hash] = version;
+		type = read(kVersionFields[0], decltype(type){});
+		hw = read(kVersionFields[1], decltype(hw){});
+		major = read(kVersionFields[2], decltype(major){});
+		minor = read(kVersionFields[3], decltype(minor){});
+		revision = read(kVersionFields[4], decltype(revision){});
+		hash = read(kVersionFields[5], decltype(hash){});
+		if (complete) {
+			aOut.emplace<T>(version);
+			return true;
+		}
+	} else if constexpr (std::is_same_v<T, std::monostate> || std::is_same_v<T, HydroRS::MultiControllerTelem>) {
+		// Пустое значение и кадр телеметрии приходят только от устройств, из JSON не пишутся
+		return false;
+	} else {
+		static_assert(sizeof(T) == 0, "BbValue alternative has no JSON decoder, extend BbSerializers");
+	}
+
+	return false;
+}
+
+/// \brief Бинарное представление: тривиальные типы побайтово, строки как есть
+template<typename T>
+void toBinaryAs(const BbValue &aValue, std::vector<uint8_t> &aOut)
+{
+	[[maybe_unused]] const T &v = *std::get_if<T>(&aValue);
+
+	if constexpr (std::is_same_v<T, std::string>) {
+		aOut.insert(aOut.end(), v.begin(), v.end());
+	} else if constexpr (!std::is_same_v<T, std::monostate> && std::is_trivially_copyable_v<T>) {
+		const auto *raw = reinterpret_cast<const uint8_t *>(&v);
+		aOut.insert(aOut.end(), raw, raw + sizeof(T));
+	}
+}
+
+template<typename T>
+bool fromBinaryAs(const uint8_t *aData, size_t aSize, BbValue &aOut)
+{
+	if constexpr (std::is_same_v<T, std::string>) {
+		aOut.emplace<std::string>(reinterpret_cast<const char *>(aData), aSize);
+		return true;
+	} else if constexpr (!std::is_same_v<T, std::monostate> && std::is_trivially_copyable_v<T>) {
+		if (aSize == sizeof(T)) {
+			T value;
+			std::memcpy(&value, aData, sizeof(T));
+			aOut.emplace<T>(value);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template<size_t... I>
+constexpr auto makeRegistry(std::index_sequence<I...>)
+{
+	return std::array<Serializer, sizeof...(I)>{Serializer{nameOf<std::variant_alternative_t<I, BbValue>>(),
+		&toJsonAs<std::variant_alternative_t<I, BbValue>>, &fromJsonAs<std::variant_alternative_t<I, BbValue>>,
+		&toBinaryAs<std::variant_alternative_t<I, BbValue>>, &fromBinaryAs<std::variant_alternative_t<I, BbValue>>,
+		&BbTypes::asNumber}...};
+}
+
+inline constexpr auto kRegistry = makeRegistry(std::make_index_sequence<std::variant_size_v<BbValue>>{});
+
+/// \brief Сериализатор значения
+inline const Serializer &of(const BbValue &aValue)
+{
+	return kRegistry[aValue.index()];
+}
+
+/// \brief Сериализатор по индексу альтернативы (тег файла состояния, BbKey::kIndex)
+/// \return nullptr если индекс вне BbValue
+inline const Serializer *at(size_t aIndex)
+{
+	return aIndex < kRegistry.size() ? &kRegistry[aIndex] : nullptr;
+}
+
+/// \brief Значение в JSON
+inline Json toJson(const BbValue &aValue)
+{
+	return of(aValue).toJson(aValue);
+}
+
+/// \brief JSON в значение типа альтернативы aIndex
+/// \return false если JSON не подходит под тип или тип не читается из JSON
+inline bool fromJson(size_t aIndex, const Json &aJson, BbValue &aOut)
+{
+	const Serializer *serializer = at(aIndex);
+	return serializer && serializer->fromJson(aJson, aOut);
+}
+
+/// \brief JSON в значение типа описанной записи
+inline bool fromJson(const BbKeyInfo &aKey, const Json &aJson, BbValue &aOut)
+{
+	return fromJson(aKey.index, aJson, aOut);
+}
+
+} // namespace BbSerializers
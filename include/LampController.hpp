@@ -14,24 +14,29 @@
 #include <core/Blackboard.hpp>
 #include <core/BlackboardEntry.hpp>
 #include <core/EventBus.hpp>
+#include <core/Scheduler.hpp>
 #include <memory>
-#include <thread>
+#include <mutex>
 
 /// \brief Контроллер лампы (освещения)
 class LampController : public AbstractEntryObserver {
 public:
-	LampController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus);
+	LampController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus, std::shared_ptr<Scheduler> aScheduler);
 	bool ready() const;
-	void process();
+
+	/// \brief Один шаг контроллера, вызывается планировщиком каждые 10 секунд
+	/// \return false если контроллер остановлен и задачу надо снять
+	bool process();
 	void start();
 	bool isStarted() const;
 
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view entry, const std::any &value) override;
+	void onEntryUpdated(std::string_view entry, const BbValue &value) override;
 
 private:
 	std::shared_ptr<Blackboard> bb;
 	std::shared_ptr<EventBus> bus;
+	std::shared_ptr<Scheduler> scheduler;
 
 	BlackboardEntry<bool> enabled;
 	BlackboardEntry<bool> state;
@@ -43,7 +48,6 @@ private:
 
 	std::chrono::milliseconds lastCheckTime;
 	std::mutex mutex;
-	std::thread thread;
 	bool started;
 
 	void sendCommand(bool aNewLampState);
@@ -59,10 +59,10 @@ public:
 	}
 
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view entry, const std::any &value) override
+	void onEntryUpdated(std::string_view entry, const BbValue &value) override
 	{
 		if (entry == inKeys.waterLevel.getName()) {
-			const float level = std::any_cast<float>(value);
+			const float level = std::get<float>(value);
 			const float litres = levelToLitres(level);
 			// Если сейчас идет осушение и все фитинги без воды - значит весь обьем находится в баке
 			if (inKeys.plainType() == PlainType::Drainage && inKeys.flowDetector() == false) {
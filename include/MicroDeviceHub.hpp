@@ -32,6 +32,7 @@ class MicroDeviceHub : public AbstractEntryObserver {
 
 public:
 	MicroDeviceHub(std::shared_ptr<Blackboard> aBb):
+		bb{aBb},
 		bridgeStatus{Names::kTelemBridgeStatus, aBb},
 		telemPipe{Names::kTelemPipe, aBb},
 		monitor{aBb}
@@ -46,7 +47,7 @@ public:
 		list.emplace(Temperature, UDevice{Names::kTemperatureDev, aBb});
 		list.emplace(UpperLevel, UDevice{Names::kUpperLevelDev, aBb});
 		list.emplace(System, UDevice{Names::kSystemDev, aBb});
-		list.emplace(FlowDetector, UDevice{Names::kFlowDetectorDev}, aBb);
+		list.emplace(FlowDetector, UDevice{Names::kFlowDetectorDev, aBb});
 
 		bridgeStatus.subscribe(this);
 		telemPipe.subscribe(this);
@@ -54,7 +55,7 @@ public:
 	}
 
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view aEntry, const std::any &aValue) override
+	void onEntryUpdated(std::string_view aEntry, const BbValue &aValue) override
 	{
 		if (aEntry == bridgeStatus.getName()) {
 			parseBridgeStatus(aValue);
@@ -66,7 +67,7 @@ public:
 	}
 
 private:
-	void parseBridgeStatus(const std::any & /*aValue*/)
+	void parseBridgeStatus(const BbValue & /*aValue*/)
 	{
 		const auto status = bridgeStatus();
 		std::string str;
@@ -87,24 +88,27 @@ private:
 		}
 
 		list.at(Bridge).updateValue<bool>(true);
-		list.at(Bridge).updateStatus(std::any_cast<DeviceStatus>(status));
+		list.at(Bridge).updateStatus(status);
 		list.at(Bridge).updateStatusStr(str);
 	}
 
-	void parseTelemPipe(const std::any &aValue)
+	void parseTelemPipe(const BbValue &aValue)
 	{
-		HydroRS::MultiControllerTelem telem = std::any_cast<HydroRS::MultiControllerTelem>(aValue);
-
-		list.at(Pump).updateValue<bool>(telem.pumpState);
-		list.at(Lamp).updateValue<bool>(telem.lampState);
-		list.at(WaterLevel).updateValue<float>(telem.waterLevel);
-		list.at(PHMeter).updateValue<float>(telem.ph);
-		list.at(PPMMeter).updateValue<float>(telem.ppm);
-		list.at(Turbidimeter).updateValue<float>(telem.turbidimeter);
-		list.at(UpperLevel).updateValue<bool>(telem.upperState);
-		list.at(Temperature).updateValue<float>(telem.temperature);
-		list.at(System).updateValue<bool>(true);
-		list.at(FlowDetector).updateValue<bool>(telem.flowDetector);
+		HydroRS::MultiControllerTelem telem = std::get<HydroRS::MultiControllerTelem>(aValue);
+
+		// Весь кадр телеметрии уходит в BB одним пакетом
+		auto batch = bb->batch();
+
+		list.at(Pump).updateValue<bool>(batch, telem.pumpState);
+		list.at(Lamp).updateValue<bool>(batch, telem.lampState);
+		list.at(WaterLevel).updateValue<float>(batch, telem.waterLevel);
+		list.at(PHMeter).updateValue<float>(batch, telem.ph);
+		list.at(PPMMeter).updateValue<float>(batch, telem.ppm);
+		list.at(Turbidimeter).updateValue<float>(batch, telem.turbidimeter);
+		list.at(UpperLevel).updateValue<bool>(batch, telem.upperState);
+		list.at(Temperature).updateValue<float>(batch, telem.temperature);
+		list.at(System).updateValue<bool>(batch, true);
+		list.at(FlowDetector).updateValue<bool>(batch, telem.flowDetector);
 
 		for (auto &dev : list) {
 			// Систему и бридж пропускаем, они работают по другому
@@ -115,12 +119,14 @@ private:
 			const auto flags = getDeviceFlags(dev.first, telem);
 			const auto tuple = getUDeviceStatus(dev.first, flags);
 
-			list.at(dev.first).updateStatus(std::get<0>(tuple));
-			list.at(dev.first).updateStatusStr(std::get<1>(tuple));
+			list.at(dev.first).updateStatus(batch, std::get<0>(tuple));
+			list.at(dev.first).updateStatusStr(batch, std::get<1>(tuple));
 		}
+
+		batch.commit();
 	}
 
-	void parseSystemFlags(const std::any & /*aValue*/)
+	void parseSystemFlags(const BbValue & /*aValue*/)
 	{
 		// Проще вытянуть флаги из самого монитора чем их парсить
 		bool working = true;
@@ -13,11 +13,11 @@
 #include "core/Blackboard.hpp"
 #include "core/MonitorEntry.hpp"
 #include "core/EventBus.hpp"
+#include "core/Scheduler.hpp"
 #include "core/Types.hpp"
 
 #include <chrono>
 #include <mutex>
-#include <thread>
 
 #include <bits/shared_ptr.h>
 
@@ -28,6 +28,7 @@ class PumpController : public AbstractEntryObserver {
 
 	std::shared_ptr<Blackboard> bb;
 	std::shared_ptr<EventBus> bus;
+	std::shared_ptr<Scheduler> scheduler;
 
 	MonitorEntry monitor;
 
@@ -59,18 +60,25 @@ class PumpController : public AbstractEntryObserver {
 
 	bool fillingCheckEn;
 	mutable std::mutex mutex;
-	std::thread thread;
 	bool startedFlag;
+	bool resumed; // Цикл из файла состояния уже продолжен
 
 public:
-	PumpController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus);
+	PumpController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus, std::shared_ptr<Scheduler> aScheduler);
 	bool ready() const;
-	void process();
-	void start();
+
+	/// \brief Один шаг контроллера, вызывается планировщиком каждые 200 мс
+	/// \return false если контроллер остановлен и задачу надо снять
+	bool process();
+
+	/// \brief Запустить контроллер, текущая фаза цикла продолжается по nextSwitchTime
+	/// \param aDowntime сколько прошло с сохранения восстановленного состояния, вычитается
+	/// из остатка фазы только при первом запуске
+	void start(std::chrono::milliseconds aDowntime = std::chrono::milliseconds{0});
 	bool isStarted() const;
 
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view entry, const std::any &value) override;
+	void onEntryUpdated(std::string_view entry, const BbValue &value) override;
 private:
 	void updateMode(PumpModes aNewMode);
 
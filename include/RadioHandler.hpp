@@ -5,6 +5,7 @@
 #include "core/BlackboardEntry.hpp"
 #include "core/EventBus.hpp"
 #include "core/RadioTypes.hpp"
+#include "core/Scheduler.hpp"
 #include "core/TimeWrapper.hpp"
 #include "drivers/SerialDriver.hpp"
 
@@ -17,6 +18,7 @@
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
@@ -31,24 +33,28 @@ class RadioHandler : public RS::DeviceHubObserver, public EventBusObserver {
 
 	std::shared_ptr<Blackboard> bb;
 	std::shared_ptr<EventBus> bus;
+	std::shared_ptr<Scheduler> scheduler;
 	SerialDriver driver;
 	SerialEspProxy proxy;
 
 	Hub hub;
+	// Хаб трогают поток приема, планировщик и диспетчер шины событий
+	std::mutex hubMutex;
 
 	BlackboardEntry<HydroRS::MultiControllerTelem> telemPipe;
 
 	std::thread receive;
-	std::thread transmit;
 
 public:
 	RadioHandler(std::string aSerial, RS::DeviceVersion &aHubVersion, std::shared_ptr<Blackboard> aBb,
-				 std::shared_ptr<EventBus> aEvBus);
+				 std::shared_ptr<EventBus> aEvBus, std::shared_ptr<Scheduler> aScheduler);
 
 	void start();
 	void receiveThread();
 	void probe();
-	void processThread();
+
+	/// \brief Обработка хаба: повторы, таймауты и расписание запросов, каждые 50 мс из планировщика
+	void process();
 
 	// DeviceHubObserver interface
 	void onAckNotReceivedEv(const std::string &aName, RS::MessageType) override;
@@ -62,7 +68,7 @@ public:
 	void deviceHealthReceivedEv(const std::string &aName, RS::Health aHealth, uint16_t aFlags) override;
 
 	// EventBusObserver interface
-	void handleEvent(EventType aEv, std::any &aValue) override;
+	void handleEvent(const BusEvent &aEvent) override;
 
 private:
 	void createSchedules();
@@ -5,6 +5,7 @@
 #include "core/BlackboardEntry.hpp"
 #include "core/Helpers.hpp"
 #include "core/InterfaceList.hpp"
+#include "core/Scheduler.hpp"
 #include "core/Types.hpp"
 
 //#include <EspNowUSBProto/Parser.hpp>
@@ -20,7 +21,6 @@
 #include <memory>
 #include <queue>
 #include <string>
-#include <thread>
 #include <unordered_map>
 
 /// \brief Класс связывающий UtilitaryRS, EspNowUsbProto и остальное приложение
@@ -34,8 +34,8 @@ class SerialEspProxy : public AbstractSerial {
 
 	std::chrono::time_point<std::chrono::steady_clock> lastHeartbeatTime;
 	std::chrono::time_point<std::chrono::steady_clock> lastMessageTimepoint;
+	std::chrono::time_point<std::chrono::steady_clock> retryTime; // До этого момента пропавший бридж не опрашивается
 
-	std::thread thread;
 	BlackboardEntry<DeviceStatus> bridgeStatus;
 	std::unordered_map<std::string, std::vector<uint8_t>> uidMap;
 
@@ -47,17 +47,18 @@ public:
 		inbox{},
 		lastHeartbeatTime{std::chrono::milliseconds{0}},
 		lastMessageTimepoint{std::chrono::milliseconds{0}},
-		thread{},
 		bridgeStatus{Names::kTelemBridgeStatus, bb},
 		uidMap{}
 	{
 		bridgeStatus.set(DeviceStatus::NotFound);
 	}
 
-	void start()
+	void start(Scheduler &aScheduler)
 	{
-		thread = std::thread(&SerialEspProxy::threadFunction, this);
-		thread.detach();
+		aScheduler.every("bridge", std::chrono::seconds{1}, [this]() {
+			process();
+			return true;
+		});
 	}
 
 	/// \brief Враппер для EspNow, оборачивает сообщение в контейнер с MAC
@@ -207,54 +208,59 @@ private:
 		return packet;
 	}
 
-	void threadFunction()
+	static constexpr std::chrono::milliseconds kMissingRetry{2500};
+
+	/// \brief Шаг наблюдения за бриджем, раз в секунду из планировщика
+	void process()
 	{
-		while (true) {
-			std::chrono::time_point<std::chrono::steady_clock> time = std::chrono::steady_clock::now();
-
-			// Проверим состояние бриджа как serial устройства
-			const bool alive = driver->ping();
-
-			if (!alive) {
-				// bridgeStatus = DeviceStatus::NotFound;
-				HYDRO_LOG_ERROR("Bridge serial device not found!");
-				std::this_thread::sleep_for(std::chrono::seconds{2});
-			} else if (bridgeStatus() == DeviceStatus::NotFound) {
-				bridgeStatus = DeviceStatus::Error;
-			}
+		std::chrono::time_point<std::chrono::steady_clock> time = std::chrono::steady_clock::now();
 
-			switch (bridgeStatus()) {
-				case DeviceStatus::NotFound :
-					// Ожидание serial устройства
-					break;
-
-				case DeviceStatus::Error: {
-					auto packet = createPingPacket();
-					driver->write(packet.data(), packet.size());
-					if (lastHeartbeatTime.time_since_epoch().count()
-						&& time - lastHeartbeatTime <= std::chrono::seconds{5}) {
-						bridgeStatus.set(DeviceStatus::Warning);
-					}
-				} break;
-			case DeviceStatus::Warning: {
-					auto packet = createPingPacket();
-					driver->write(packet.data(), packet.size());
-
-					if (time - lastMessageTimepoint <= std::chrono::seconds{5}) {
-						bridgeStatus.set(DeviceStatus::Working);
-					} else if (time - lastHeartbeatTime >= std::chrono::seconds{5}) {
-						bridgeStatus.set(DeviceStatus::Error);
-					}
-				} break;
-			case DeviceStatus::Working:
-					if (time - lastMessageTimepoint >= std::chrono::seconds{5}) {
-						lastHeartbeatTime = time;
-						bridgeStatus.set(DeviceStatus::Warning);
-					}
-					break;
-			}
+		// После пропажи serial устройства шаги пропускаются, как прежняя пауза в 2 с перед следующим циклом
+		if (time < retryTime) {
+			return;
+		}
+
+		// Проверим состояние бриджа как serial устройства
+		const bool alive = driver->ping();
 
-			std::this_thread::sleep_for(std::chrono::seconds{1});
+		if (!alive) {
+			// bridgeStatus = DeviceStatus::NotFound;
+			HYDRO_LOG_ERROR("Bridge serial device not found!");
+			// 2 с паузы и полшага запаса, чтобы задержка шага не сократила паузу на целый шаг
+			retryTime = time + kMissingRetry;
+		} else if (bridgeStatus() == DeviceStatus::NotFound) {
+			bridgeStatus = DeviceStatus::Error;
+		}
+
+		switch (bridgeStatus()) {
+			case DeviceStatus::NotFound :
+				// Ожидание serial устройства
+				break;
+
+			case DeviceStatus::Error: {
+				auto packet = createPingPacket();
+				driver->write(packet.data(), packet.size());
+				if (lastHeartbeatTime.time_since_epoch().count()
+					&& time - lastHeartbeatTime <= std::chrono::seconds{5}) {
+					bridgeStatus.set(DeviceStatus::Warning);
+				}
+			} break;
+		case DeviceStatus::Warning: {
+				auto packet = createPingPacket();
+				driver->write(packet.data(), packet.size());
+
+				if (time - lastMessageTimepoint <= std::chrono::seconds{5}) {
+					bridgeStatus.set(DeviceStatus::Working);
+				} else if (time - lastHeartbeatTime >= std::chrono::seconds{5}) {
+					bridgeStatus.set(DeviceStatus::Error);
+				}
+			} break;
+		case DeviceStatus::Working:
+				if (time - lastMessageTimepoint >= std::chrono::seconds{5}) {
+					lastHeartbeatTime = time;
+					bridgeStatus.set(DeviceStatus::Warning);
+				}
+				break;
 		}
 	}
 
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "core/BbKey.hpp"
 #include "core/Blackboard.hpp"
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -17,11 +21,31 @@ using json = nlohmann::json;
 enum class SettingType { BOOL, INT, FLOAT, STRING, SECONDS, MSECONDS};
 using SettingValue = std::variant<bool, int, float, std::string, std::chrono::seconds, std::chrono::milliseconds>;
 
+/// \brief Тип параметра по хранимому в BB типу
+template<typename T>
+inline constexpr SettingType kSettingType = [] {
+	if constexpr (std::is_same_v<T, bool>) {
+		return SettingType::BOOL;
+	} else if constexpr (std::is_same_v<T, int>) {
+		return SettingType::INT;
+	} else if constexpr (std::is_same_v<T, float>) {
+		return SettingType::FLOAT;
+	} else if constexpr (std::is_same_v<T, std::string>) {
+		return SettingType::STRING;
+	} else if constexpr (std::is_same_v<T, std::chrono::seconds>) {
+		return SettingType::SECONDS;
+	} else {
+		static_assert(std::is_same_v<T, std::chrono::milliseconds>, "Type can't be stored in config");
+		return SettingType::MSECONDS;
+	}
+}();
+
 struct SettingDefinition {
 	std::string key;
 	SettingType type;
 	SettingValue defaultValue;
 	std::string description;
+	std::string unit;
 };
 
 /* Таблица сериализации
@@ -42,7 +66,7 @@ class SettingsManager : public AbstractEntryObserver {
 	std::shared_ptr<Blackboard> blackboard;
 
 	bool autoSave;
-	bool initialized;
+	std::atomic<bool> initialized; // Читается из потока доставки оповещений BB
 
 public:
 	SettingsManager(std::shared_ptr<Blackboard> aBb,
@@ -59,7 +83,30 @@ public:
 	/// \param defaultValue Значение по умолчанию
 	/// \param desc Описание параметра
 	void registerSetting(const std::string &key, SettingType type,
-		SettingValue defaultValue, const std::string &desc = "");
+		SettingValue defaultValue, const std::string &desc = "", std::string_view unit = {});
+
+	/// \brief Регистрация параметра по описанию записи, тип и единица берутся из описания
+	/// \param aKey Описание записи
+	/// \param aDefault Значение по умолчанию
+	/// \param aDesc Описание параметра
+	template<typename T>
+	void registerSetting(const BbKey<T> &aKey, typename BbKey<T>::Stored aDefault, const std::string &aDesc = "")
+	{
+		registerSetting(aKey, std::string_view{}, std::move(aDefault), aDesc);
+	}
+
+	/// \brief Регистрация параметра из группы (bridge.config.mac.1...)
+	/// \param aKey Описание группы
+	/// \param aSuffix Окончание имени
+	/// \param aDefault Значение по умолчанию
+	/// \param aDesc Описание параметра
+	template<typename T>
+	void registerSetting(const BbKey<T> &aKey, std::string_view aSuffix, typename BbKey<T>::Stored aDefault,
+		const std::string &aDesc = "")
+	{
+		using Stored = typename BbKey<T>::Stored;
+		registerSetting(aKey + aSuffix, kSettingType<Stored>, SettingValue{std::move(aDefault)}, aDesc, aKey.unit);
+	}
 
 	/// \brief Загрузить параметры из файла
 	/// \return true если загрузка удачная, иначе false
@@ -70,7 +117,7 @@ public:
 	bool save();
 
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view entry, const std::any &value) override;
+	void onEntryUpdated(std::string_view entry, const BbValue &value) override;
 
 private:
 
@@ -0,0 +1,126 @@
+/*!
+@file
+@brief Типизированные описания записей Blackboard
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/BlackboardValue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// \brief Описание записи без типа, то что хранится в таблице ключей
+struct BbKeyInfo {
+	std::string_view name;
+	std::string_view unit;
+	size_t index;    // Индекс альтернативы в BbValue
+	bool family;     // name - префикс группы записей (name + "1", name + ".mac2"...)
+};
+
+/// \brief Описание записи BB: имя, тип значения и единица измерения
+/// Тип проверяется на этапе компиляции, а по индексу альтернативы выбирается сериализатор.
+/// Неявно приводится к std::string_view, поэтому подходит везде, где BB принимает имя
+/// \tparam T тип значения, енамы хранятся в BB как int
+template<typename T>
+struct BbKey {
+	using Type = T;
+	using Stored = std::conditional_t<std::is_enum_v<T>, int, T>;
+
+	static_assert(BbTypes::kSupported<Stored>, "Type is not supported by Blackboard, extend BbValue");
+	static constexpr size_t kIndex = BbTypes::kIndex<Stored>;
+
+	std::string_view name;
+	std::string_view unit{};
+	bool family = false;
+
+	constexpr operator std::string_view() const
+	{
+		return name;
+	}
+
+	constexpr BbKeyInfo info() const
+	{
+		return BbKeyInfo{name, unit, kIndex, family};
+	}
+
+	std::string str() const
+	{
+		return std::string{name};
+	}
+
+	/// \brief Имя записи из группы
+	friend std::string operator+(const BbKey &aKey, std::string_view aSuffix)
+	{
+		std::string result{aKey.name};
+		result += aSuffix;
+		return result;
+	}
+};
+
+/// \brief Описание записи из группы
+template<typename T>
+constexpr BbKey<T> bbFamily(std::string_view aPrefix, std::string_view aUnit = {})
+{
+	return BbKey<T>{aPrefix, aUnit, true};
+}
+
+/// \brief Таблица описаний, собирается на этапе компиляции
+/// Поиск - двоичный по отсортированным именам, для групп - по самому длинному префиксу
+template<size_t N>
+class BbKeyTable {
+public:
+	template<typename... Keys>
+	constexpr explicit BbKeyTable(const Keys &...aKeys) : keys{aKeys.info()...}
+	{
+		std::sort(keys.begin(), keys.end(), [](const BbKeyInfo &a, const BbKeyInfo &b) { return a.name < b.name; });
+	}
+
+	/// \brief Найти описание записи
+	/// \return nullptr если имя не описано
+	constexpr const BbKeyInfo *find(std::string_view aName) const
+	{
+		auto it = std::lower_bound(keys.begin(), keys.end(), aName,
+			[](const BbKeyInfo &info, std::string_view name) { return info.name < name; });
+		if (it != keys.end() && it->name == aName) {
+			return &*it;
+		}
+
+		// Групп единицы, их можно просто перебрать
+		const BbKeyInfo *best = nullptr;
+		for (const auto &info : keys) {
+			if (info.family && aName.starts_with(info.name) && (!best || info.name.size() > best->name.size())) {
+				best = &info;
+			}
+		}
+		return best;
+	}
+
+	constexpr size_t size() const
+	{
+		return N;
+	}
+
+	constexpr auto begin() const
+	{
+		return keys.begin();
+	}
+
+	constexpr auto end() const
+	{
+		return keys.end();
+	}
+
+private:
+	std::array<BbKeyInfo, N> keys;
+};
+
+template<typename... Keys>
+BbKeyTable(const Keys &...) -> BbKeyTable<sizeof...(Keys)>;
@@ -9,52 +9,230 @@
 
 #pragma once
 
+#include "core/BlackboardValue.hpp"
+#include "core/BlackboardObservers.hpp"
+#include "core/BlackboardSnapshot.hpp"
+#include "core/BlackboardStats.hpp"
+#include "core/ChangePolicy.hpp"
+#include "core/HistoryRing.hpp"
 #include "core/InterfaceList.hpp"
+#include "core/KeyPatternIndex.hpp"
+#include "core/ObserverDispatcher.hpp"
+#include "core/SeqLock.hpp"
 #include "HeteroLookup.hpp"
 #include "core/Types.hpp"
 #include "logger/Logger.hpp"
 
-#include <any>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <set>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <typeinfo>
 #include <unordered_map>
 #include <algorithm>
+#include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 #include <cstddef>
 #include <cstring>
 
-/// \brief Наблюдатель BB за отдельными entry
-class AbstractEntryObserver {
-public:
-	virtual ~AbstractEntryObserver() = default;
-	virtual void onEntryUpdated(std::string_view entry, const std::any &value) = 0;
+/// \brief Дескриптор записи BB, выдается один раз на имя и не меняется до конца жизни BB
+using KeyId = uint32_t;
+
+/// \brief Запись, измененная после заданного номера изменения
+struct BbDelta {
+	std::string_view key; // Валидно до конца жизни BB
+	BbValue value;        // monostate - запись удалена
+	uint64_t version;     // Сколько раз менялась запись
+	uint64_t seq;         // Номер последнего изменения записи
 };
 
-/// \brief Наблюдатель BB за entry по префиксу
-class AbstractPrefixObserver {
-public:
-	virtual ~AbstractPrefixObserver() = default;
-	virtual void onPrefixUpdated(std::string_view prefix, std::string_view entry, const std::any &value) = 0;
+/// \brief Результат Blackboard::changesSince
+struct BbChangeLog {
+	uint64_t sequence = 0; // Номер последнего изменения BB на момент запроса, следующий запрос делается от него
+	std::vector<BbDelta> entries; // От старых к новым, каждая запись не больше одного раза
+};
+
+/// \brief Результат Blackboard::history
+struct BbHistory {
+	bool enabled = false;      // Для записи ведется кольцо истории
+	int64_t coveredFromMs = 0; // С какого момента история в кольце полная, раньше - только БД
+	std::vector<HistorySample> samples; // По возрастанию времени
 };
 
 /// \brief Blackboard IPC класс
+/// Каждое имя регистрируется один раз и получает плотный целочисленный KeyId,
+/// горячие пути (BlackboardEntry, MonitorEntry) работают по KeyId без хеширования строк.
+/// Значения хранятся в закрытом variant (BbValue) inline, запись и чтение скалярных типов
+/// не обращаются к аллокатору, списки наблюдателей copy-on-write и не копируются при оповещении.
+///
+/// Конкурентность: писатели сериализуются эксклюзивным захватом shared_mutex, строковые запросы
+/// читают под разделяемым захватом. Тривиально копируемые значения дополнительно зеркалируются
+/// в seqlock ячейку слота, поэтому get/has по KeyId не берут мьютекс вообще.
+///
+/// Наблюдатели по умолчанию вызываются в потоке писателя. Медленные наблюдатели (диск, сеть)
+/// подписываются с Delivery::Async и получают оповещения из пула ObserverDispatcher
 class Blackboard {
+public:
+	static constexpr KeyId kInvalidKey = UINT32_MAX;
+
 private:
-	std::unordered_map<std::string, std::any, StrHash, StrEq> data;
-	std::unordered_map<std::string, std::unique_ptr<AbstractValidator>, StrHash, StrEq> validators;
+	using EntryObservers = std::vector<AbstractEntryObserver *>;
+	using PatternIndex = KeyPatternIndex<AbstractPrefixObserver>;
+	using PatternObservers = std::map<std::string, std::vector<AbstractPrefixObserver *>, std::less<>>;
+	using Writes = std::vector<std::pair<KeyId, BbValue>>;
+
+	static constexpr size_t kChunkSize = 256;
+	static constexpr size_t kMaxChunks = 256;
+
+	/// \brief Ячейка записи, живет до конца жизни BB и никогда не перемещается
+	struct Slot {
+		std::string name;
+		BbValue value; // monostate - записи нет (не создана или удалена)
+		// Общий буфер текущего значения разделяемого типа: строится при первом оповещении или срезе
+		// и отдается всем следующим, пока значение не сменится. Меняется под эксклюзивным захватом
+		// либо под разделяемым вместе с snapshotMutex
+		mutable BbShared shared;
+		SeqLockCell<BbTypes::kTrivialSize> mirror; // Копия тривиальных значений для чтения без блокировок
+		std::shared_ptr<const EntryObservers> observers;
+		std::vector<const AbstractValidator *> validators; // Цепочка валидаторов, привязывается при регистрации
+		const ChangePolicy *policy = nullptr; // Политика изменения числовых значений
+		ChangePolicy::Clock::time_point acceptedAt{}; // Когда принято текущее значение, только для политик с часами
+		uint64_t suppressed = 0; // Отсеяно политикой
+		std::atomic<HistoryRing *> history{nullptr}; // Кольцо истории, читается без мьютекса
+
+		uint64_t version = 0; // Счетчик изменений записи
+		uint64_t seq = 0;     // Глобальный номер последнего изменения, 0 - не менялась
+		KeyId older = kInvalidKey; // Соседи в списке записей, упорядоченном по seq
+		KeyId newer = kInvalidKey;
+
+#if HYDRO_BB_INSTRUMENTATION
+		// Меняются под эксклюзивным захватом, читаются под разделяемым
+		uint64_t writes = 0;
+		uint64_t changes = 0;
+		uint64_t rejected = 0;
+#endif
+	};
+
+	// Слоты выделяются чанками и не двигаются, поэтому читатель по KeyId обходится без мьютекса,
+	// а string_view на имена в index остаются валидными
+	std::array<std::atomic<Slot *>, kMaxChunks> chunks{};
+	std::atomic<KeyId> slotCount{0};
+	std::unordered_map<std::string_view, KeyId> index;
+	// Правила валидации: префикс имени и валидатор. Валидаторы живут до конца жизни BB,
+	// слоты держат на них сырые указатели
+	std::vector<std::pair<std::string, std::unique_ptr<AbstractValidator>>> validatorRules;
+	// Политики изменения: префикс имени и политика, действует последнее подходящее правило
+	std::vector<std::pair<std::string, std::unique_ptr<const ChangePolicy>>> policyRules;
+	std::atomic<uint64_t> suppressedWrites{0};
+	// Кольца истории: префикс имени и емкость. Кольца живут до конца жизни BB
+	std::vector<std::pair<std::string, size_t>> historyRules;
+	std::vector<std::unique_ptr<HistoryRing>> historyRings;
+
+	// Упорядоченные индексы существующих записей для перечисления по префиксу и сегменту
+	std::map<std::string_view, KeyId> sortedKeys;
+	std::unordered_map<std::string_view, std::set<std::string_view>> segmentKeys;
+
+	mutable std::shared_mutex mutex;
 
-	mutable std::recursive_mutex mutex;
+	// Глобальный номер изменения и интрузивный список записей по возрастанию seq,
+	// changesSince идет от хвоста и останавливается на первой старой записи
+	std::atomic<uint64_t> sequence{0};
+	// Писатели, уже получившие номер, но еще рассылающие оповещения, и последний номер, когда таких не было
+	std::atomic<size_t> notifying{0};
+	mutable std::atomic<uint64_t> settledSequence{0};
+	KeyId oldestChanged = kInvalidKey;
+	KeyId newestChanged = kInvalidKey;
 
-	std::unordered_map<std::string_view, std::vector<AbstractEntryObserver *>> keyObservers;
-	std::unordered_map<std::string_view, std::vector<AbstractPrefixObserver *>> prefixObservers;
+	// Последний снятый срез, переиспользуется пока BB не изменился и служит основой следующего.
+	// Набор записей меняется редко, его версия говорит, можно ли дополнить старый срез
+	uint64_t layoutVersion = 0;
+	mutable std::mutex snapshotMutex;
+	mutable std::shared_ptr<const BbSnapshot> snapshotCache;
+	mutable uint64_t snapshotLayout = 0;
+	mutable std::vector<uint32_t> snapshotPositions; // Позиция записи в срезе по KeyId
+
+	// Исходные подписки, владеют строками шаблонов. Записи не удаляются, чтобы string_view
+	// в ранее выданных снимках индекса оставались валидными
+	PatternObservers prefixSubscriptions;
+	PatternObservers segmentSubscriptions;
+	std::shared_ptr<const PatternIndex> patternIndex{std::make_shared<const PatternIndex>()};
+
+	ObserverDispatcher dispatcher;
+
+#if HYDRO_BB_INSTRUMENTATION
+	using Clock = std::chrono::steady_clock;
+
+	mutable LatencyHistogram exclusiveWait;
+	mutable LatencyHistogram sharedWait;
+	mutable BbInstrumentation::ObserverTimings observerTimings;
+#endif
 
 public:
+	Blackboard() = default;
+	Blackboard(const Blackboard &) = delete;
+	Blackboard &operator=(const Blackboard &) = delete;
+
+	~Blackboard()
+	{
+		// Сначала останавливаем асинхронную доставку, она ссылается на имена внутри слотов
+		dispatcher.stop();
+		for (auto &chunk : chunks) {
+			delete[] chunk.load(std::memory_order_relaxed);
+		}
+	}
+
+	/// \brief Зарегистрировать имя и получить его дескриптор
+	/// \param key Ключ
+	/// \return KeyId, повторный вызов с тем же именем вернет тот же KeyId
+	KeyId registerKey(std::string_view key)
+	{
+		{
+			auto lock = lockShared();
+			auto it = index.find(key);
+			if (it != index.end()) {
+				return it->second;
+			}
+		}
+
+		auto lock = lockExclusive();
+		return registerKeyLocked(key);
+	}
+
+	/// \brief Найти дескриптор по имени без регистрации
+	/// \param key Ключ
+	/// \return Optional с KeyId
+	std::optional<KeyId> findKey(std::string_view key) const
+	{
+		auto lock = lockShared();
+		auto it = index.find(key);
+		if (it != index.end()) {
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	/// \brief Получить имя по дескриптору
+	/// \param id Дескриптор
+	/// \return имя, валидно до конца жизни BB
+	std::string_view getName(KeyId id) const
+	{
+		return slotAt(id).name;
+	}
 
 	/// \brief Установка значения
 	/// \param key Ключ
@@ -63,65 +241,129 @@ public:
 	template<typename T>
 	bool set(std::string_view key, T&& value)
 	{
-		using V = std::decay_t<T>;
+		return set(registerKey(key), std::forward<T>(value));
+	}
 
-		bool changed = false;
+	/// \brief Установка значения по дескриптору
+	/// \param id Дескриптор
+	/// \param value rvalue значения
+	/// \return true если поле применено, false если запись не удалась
+	template<typename T>
+	bool set(KeyId id, T&& value)
+	{
+		using V = std::decay_t<T>;
+		static_assert(BbTypes::kSupported<V>, "Type is not supported by Blackboard, extend BbValue");
 
-		std::any anyVal = std::any(std::forward<T>(value));
-		std::any anyValSnap;
+		BbHeldValue valueSnap;
 		std::string_view keySnap;
+		uint64_t seqSnap;
+		std::shared_ptr<const EntryObservers> entryObs;
+		std::shared_ptr<const PatternIndex> patternObs;
 
 		{
-			std::lock_guard lock(mutex);
-			auto it = data.find(key);
-
-			// Если ключа нет - аллоцируем строку, кладем внутрь
-			if (it == data.end()) {
-				auto result = data.try_emplace(std::string(key), anyVal);
-				it = result.first;
-				changed = true;
-			// Если ключ есть - проверим, есть ли смысл вызывать обсерверы
-			} else {
-				// Но сначала посмотрим список валидаторов
-				for (const auto &[entry, validator] : validators) {
-					if (key.find(entry) != std::string::npos) {
-						if (validator) {
-							// Проверяем валидатором запись, если не соответствует - дропаем
-							if (!validator->isDataCorrect(anyVal)) {
-								return false;
-							}
-						}
-					}
-				}
+			auto lock = lockExclusive();
+			if (!applyLocked(id, std::forward<T>(value))) {
+				return false;
+			}
 
-				if (auto* old = std::any_cast<V>(&it->second)) {
-					// Если оператор сравнения есть - сравниваем
-					if constexpr (requires (const V& a, const V& b) { a == b; }) {
-						if (*old != value) {
-							it->second = anyVal;
-							changed = true;
-						}
-					// Если нет - считаем измененным
-					} else {
-						it->second = anyVal;
-						changed = true;
-					}
-				} else {
-					HYDRO_LOG_ERROR("Key" + std::string(key) + "trying to change his type, daga kotowaru!");
-					return false;
-				}
+			const Slot &slot = slotAt(id);
+			if (!slot.observers && patternIndex->empty()) {
+				return true;
 			}
 
-			if (changed) {
-				keySnap = it->first;
-				anyValSnap = it->second;
+			keySnap = slot.name;
+			valueSnap = holdLocked(slot);
+			seqSnap = slot.seq;
+			entryObs = slot.observers;
+			patternObs = patternIndex;
+			notifying.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		notifyObservers(keySnap, valueSnap, seqSnap, entryObs.get(), *patternObs);
+		notifying.fetch_sub(1, std::memory_order_release);
+		return true;
+	}
+
+	/// \brief Пакетная запись
+	/// Накапливает записи и применяет их за один эксклюзивный захват, наблюдатели префиксов
+	/// получают один onPrefixBatchUpdated на пакет. Каждая запись проходит те же проверки, что и set.
+	/// Не примененные явно записи применяются в деструкторе
+	class Batch {
+	public:
+		explicit Batch(Blackboard &aBb) : bb{aBb}
+		{
+		}
+
+		Batch(const Batch &) = delete;
+		Batch &operator=(const Batch &) = delete;
+
+		~Batch()
+		{
+			commit();
+		}
+
+		/// \brief Добавить запись в пакет
+		/// \param id Дескриптор
+		/// \param value значение
+		template<typename T>
+		Batch &set(KeyId id, T&& value)
+		{
+			using V = std::decay_t<T>;
+			static_assert(BbTypes::kSupported<V>, "Type is not supported by Blackboard, extend BbValue");
+
+			// Значение собирается сразу на месте, без временного BbValue
+			writes.emplace_back(std::piecewise_construct, std::forward_as_tuple(id),
+				std::forward_as_tuple(std::in_place_type<V>, std::forward<T>(value)));
+			return *this;
+		}
+
+		/// \brief Добавить запись в пакет
+		/// \param key Ключ
+		/// \param value значение
+		template<typename T>
+		Batch &set(std::string_view key, T&& value)
+		{
+			return set(bb.registerKey(key), std::forward<T>(value));
+		}
+
+		/// \brief Применить накопленные записи
+		/// \return количество измененных записей
+		size_t commit()
+		{
+			if (writes.empty()) {
+				return 0;
 			}
+
+			Writes pending = std::move(writes);
+			writes.clear();
+			return bb.applyBatch(pending);
 		}
 
-		if (changed) {
-			notifyObservers(keySnap, anyValSnap);
+	private:
+		Blackboard &bb;
+		Writes writes;
+	};
+
+	/// \brief Начать пакетную запись
+	Batch batch()
+	{
+		return Batch{*this};
+	}
+
+	/// \brief Записать несколько значений одним пакетом
+	/// \param values пары ключ - значение
+	/// \return количество измененных записей
+	size_t setMany(std::initializer_list<std::pair<std::string_view, BbValue>> values)
+	{
+		Writes writes;
+		writes.reserve(values.size());
+		for (const auto &[key, value] : values) {
+			if (BbTypes::hasValue(value)) {
+				writes.emplace_back(registerKey(key), value);
+			}
 		}
-		return changed;
+
+		return applyBatch(writes);
 	}
 
 	/// \brief Получить значение по ключу
@@ -130,50 +372,172 @@ public:
 	template<typename T>
 	std::optional<T> get(std::string_view key) const
 	{
-		std::lock_guard lock(mutex);
-		auto it = data.find(key);
-		if (it != data.end()) {
-			try {
-				return std::any_cast<T>(it->second);
-			} catch (const std::bad_any_cast &) {
-				return std::nullopt;
-			}
+		auto lock = lockShared();
+		auto it = index.find(key);
+		if (it != index.end() && BbTypes::hasValue(slotAt(it->second).value)) {
+			return getLocked<T>(it->second);
 		}
 		std::cerr << "Key " << key << " not found!" << std::endl;
 		return std::nullopt;
 	}
 
+	/// \brief Получить значение по дескриптору
+	/// Тривиально копируемые типы читаются из seqlock ячейки без мьютекса
+	/// \param id Дескриптор
+	/// \return Optional со значением
+	template<typename T>
+	std::optional<T> get(KeyId id) const
+	{
+		if constexpr (BbTypes::kLockFree<T>) {
+			std::array<std::byte, sizeof(T)> raw;
+			if (slotAt(id).mirror.load(static_cast<uint32_t>(BbTypes::kIndex<T>), raw.data(), raw.size())) {
+				return std::bit_cast<T>(raw);
+			}
+			return std::nullopt;
+		} else {
+			auto lock = lockShared();
+			return getLocked<T>(id);
+		}
+	}
+
 	/// \brief insertValidator
+	/// Валидатор сразу привязывается ко всем подходящим записям, а также к записям,
+	/// зарегистрированным позже. Несколько валидаторов на одну запись образуют цепочку
+	/// и вызываются в порядке добавления
 	/// \param aEntry Может быть и префиксом и именем
 	/// \param aValidator ожидается rvalue на валидатор
-	/// \return
+	/// \return true если валидатор добавлен
 	bool insertValidator(std::string_view aEntry, std::unique_ptr<AbstractValidator> aValidator)
 	{
-		if (validators.contains(aEntry)) {
-			HYDRO_LOG_ERROR("Validator already registered");
+		if (!aValidator) {
+			HYDRO_LOG_ERROR("Empty validator for " + std::string{aEntry});
 			return false;
 		}
 
-		std::string ent = std::string{aEntry};
+		auto lock = lockExclusive();
+		const AbstractValidator *validator = aValidator.get();
+		validatorRules.emplace_back(std::string{aEntry}, std::move(aValidator));
 
-		const auto result = validators.try_emplace(ent, std::move(aValidator));
-		return result.second;
+		const KeyId count = slotCount.load(std::memory_order_relaxed);
+		for (KeyId id = 0; id < count; ++id) {
+			Slot &slot = slotAt(id);
+			if (slot.name.starts_with(aEntry)) {
+				slot.validators.push_back(validator);
+			}
+		}
+
+		return true;
 	}
 
-	/// \brief Получить std::any по ключу
+	/// \brief Задать политику изменения числовых записей
+	/// Политика привязывается ко всем подходящим записям, в том числе зарегистрированным позже.
+	/// Для записи действует последняя заданная подходящая политика. На bool, строки и структуры не влияет
+	/// \param aEntry Может быть и префиксом и именем
+	/// \param aPolicy политика
+	void setChangePolicy(std::string_view aEntry, const ChangePolicy &aPolicy)
+	{
+		auto lock = lockExclusive();
+		policyRules.emplace_back(std::string{aEntry}, std::make_unique<const ChangePolicy>(aPolicy));
+		const ChangePolicy *policy = policyRules.back().second.get();
+
+		const KeyId count = slotCount.load(std::memory_order_relaxed);
+		for (KeyId id = 0; id < count; ++id) {
+			Slot &slot = slotAt(id);
+			if (slot.name.starts_with(aEntry)) {
+				slot.policy = policy;
+			}
+		}
+	}
+
+	/// \brief Сколько записей отсеяно политиками изменения
+	uint64_t suppressedCount() const
+	{
+		return suppressedWrites.load(std::memory_order_relaxed);
+	}
+
+	/// \brief Сколько записей в ключ отсеяно политикой изменения
 	/// \param key Ключ
-	/// \return Optional с std::any
-	const std::optional<std::any> getAny(std::string_view key)
+	uint64_t suppressedCount(std::string_view key) const
 	{
-		std::lock_guard lock(mutex);
-		auto it = data.find(key);
-		if (it != data.end()) {
-			return it->second;
+		auto lock = lockShared();
+		auto it = index.find(key);
+		return it != index.end() ? slotAt(it->second).suppressed : 0;
+	}
+
+	/// \brief Вести историю числовых записей в памяти
+	/// Каждая подходящая запись, в том числе зарегистрированная позже, получает свое кольцо
+	/// на aCapacity последних изменений. Текущее значение сразу попадает в кольцо первым отсчетом
+	/// \param aEntry Может быть и префиксом и именем
+	/// \param aCapacity емкость кольца, округляется до степени двойки
+	void enableHistory(std::string_view aEntry, size_t aCapacity)
+	{
+		auto lock = lockExclusive();
+		historyRules.emplace_back(std::string{aEntry}, aCapacity);
+
+		const KeyId count = slotCount.load(std::memory_order_relaxed);
+		for (KeyId id = 0; id < count; ++id) {
+			Slot &slot = slotAt(id);
+			if (slot.name.starts_with(aEntry)) {
+				attachHistoryLocked(slot, aCapacity);
+			}
+		}
+	}
+
+	/// \brief История записи из кольца в памяти, без блокировки писателей
+	/// \param key Ключ
+	/// \param fromMs начало интервала, Unix время в мс
+	/// \param toMs конец интервала включительно
+	/// \param limit не больше стольких последних отсчетов
+	BbHistory history(std::string_view key, int64_t fromMs, int64_t toMs, size_t limit = SIZE_MAX) const
+	{
+		const auto id = findKey(key);
+		if (!id) {
+			return {};
+		}
+
+		const HistoryRing *ring = slotAt(*id).history.load(std::memory_order_acquire);
+		if (!ring) {
+			return {};
+		}
+
+		BbHistory result;
+		result.enabled = true;
+		result.coveredFromMs = ring->coveredFromMs();
+		ring->read(fromMs, toMs, result.samples, limit);
+		return result;
+	}
+
+	/// \brief Получить значение записи как есть
+	/// \param key Ключ
+	/// \return Optional с BbValue
+	std::optional<BbValue> getValue(std::string_view key) const
+	{
+		auto lock = lockShared();
+		auto it = index.find(key);
+		if (it != index.end() && BbTypes::hasValue(slotAt(it->second).value)) {
+			return slotAt(it->second).value;
 		}
 
 		return std::nullopt;
 	}
 
+	/// \brief Записать значение как есть
+	/// \param key Ключ
+	/// \param value значение, тип записи определяется альтернативой
+	/// \return true если поле применено, false если значение пустое или запись не удалась
+	bool setValue(std::string_view key, const BbValue &value)
+	{
+		return std::visit(
+			[&](const auto &v) {
+				if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+					return false;
+				} else {
+					return set(key, v);
+				}
+			},
+			value);
+	}
+
 	/// \brief Получить или дефолтное значение
 	/// \param key Ключ
 	/// \param defaultValue Значение для возврата при неудачном чтении
@@ -190,12 +554,16 @@ public:
 	template<typename T>
 	bool isType(std::string_view key) const
 	{
-		std::lock_guard lock(mutex);
-		auto it = data.find(key);
-		if (it != data.end()) {
-			return it->second.type() == typeid(T);
+		if constexpr (!BbTypes::kSupported<T>) {
+			return false;
+		} else {
+			auto lock = lockShared();
+			auto it = index.find(key);
+			if (it != index.end()) {
+				return std::holds_alternative<T>(slotAt(it->second).value);
+			}
+			return false;
 		}
-		return false;
 	}
 
 	/// \brief Проверка наличия записи
@@ -203,111 +571,419 @@ public:
 	/// \return true если запись имеется
 	bool has(std::string_view key) const
 	{
-		std::lock_guard lock(mutex);
-		return data.find(key) != data.end();
+		auto lock = lockShared();
+		auto it = index.find(key);
+		return it != index.end() && BbTypes::hasValue(slotAt(it->second).value);
+	}
+
+	/// \brief Проверка наличия записи по дескриптору
+	/// \param id Дескриптор
+	/// \return true если запись имеется
+	bool has(KeyId id) const
+	{
+		return slotAt(id).mirror.currentTag() != 0;
 	}
 
 	/// \brief Удалить запись
+	/// Дескриптор остается зарегистрированным, последующий set создаст запись заново
 	/// \param key Ключ
 	/// \return true если удаление успешно
 	bool remove(std::string_view key)
 	{
-		bool existed = false;
-		std::any oldValue;
+		BbHeldValue oldValue;
+		std::string_view keySnap;
+		uint64_t seqSnap;
+		std::shared_ptr<const EntryObservers> entryObs;
+		std::shared_ptr<const PatternIndex> patternObs;
+
 		{
-			std::lock_guard lock(mutex);
-			auto it = data.find(key);
-			if (it != data.end()) {
-				oldValue = std::move(it->second);
-				data.erase(it);
-				existed = true;
+			auto lock = lockExclusive();
+			auto it = index.find(key);
+			if (it == index.end() || !BbTypes::hasValue(slotAt(it->second).value)) {
+				return false;
 			}
-		}
 
-		if (existed) {
-			notifyObservers(key, oldValue);
+			Slot &slot = slotAt(it->second);
+			keySnap = slot.name;
+			oldValue = slot.shared ? BbHeldValue{std::move(slot.shared)} : BbHeldValue::make(std::move(slot.value));
+			slot.shared.reset();
+			slot.value = std::monostate{};
+			publish(slot);
+			unindexKeyLocked(it->second);
+			touchLocked(it->second);
+			seqSnap = slot.seq;
+			entryObs = slot.observers;
+			patternObs = patternIndex;
+			notifying.fetch_add(1, std::memory_order_relaxed);
 		}
-		return existed;
+
+		notifyObservers(keySnap, oldValue, seqSnap, entryObs.get(), *patternObs, true);
+		notifying.fetch_sub(1, std::memory_order_release);
+		return true;
 	}
 
 	/// \brief Подписаться на обновление записи
 	/// \param key Ключ
 	/// \param observer Наблюдатель на обновление записи
-	void subscribe(std::string_view key, AbstractEntryObserver *observer)
+	/// \param options Параметры доставки
+	void subscribe(std::string_view key, AbstractEntryObserver *observer, const SubscribeOptions &options = {})
 	{
-		std::lock_guard lock(mutex);
-		keyObservers[key].push_back(observer);
+		subscribe(registerKey(key), observer, options);
+	}
+
+	/// \brief Подписаться на обновление записи по дескриптору
+	/// \param id Дескриптор
+	/// \param observer Наблюдатель на обновление записи
+	/// \param options Параметры доставки
+	void subscribe(KeyId id, AbstractEntryObserver *observer, const SubscribeOptions &options = {})
+	{
+		AbstractEntryObserver *target = resolve(observer, options);
+
+		auto lock = lockExclusive();
+		auto &observers = slotAt(id).observers;
+		auto updated = observers ? std::make_shared<EntryObservers>(*observers) : std::make_shared<EntryObservers>();
+		updated->push_back(target);
+		observers = std::move(updated);
 	}
 
 	/// \brief Отписаться от обновления
+	/// Для асинхронного наблюдателя дожидается доставки уже поставленных в очередь оповещений
 	/// \param key Ключ
 	/// \param observer Наблюдатель
 	void unsubscribe(std::string_view key, AbstractEntryObserver *observer)
 	{
-		std::lock_guard lock(mutex);
-		auto it = keyObservers.find(key);
-		if (it != keyObservers.end()) {
-			auto &observers = it->second;
-			observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+		const auto proxies = dispatcher.find(observer);
+		{
+			auto lock = lockExclusive();
+			auto it = index.find(key);
+			if (it != index.end()) {
+				eraseObserver(slotAt(it->second), observer, proxies);
+			}
 		}
+		quiesce(observer, proxies);
 	}
 
-	/// \brief Подписаться на обновление префикса
-	/// \param prefix Префикс (например telem.)
+	/// \brief Подписаться на обновление по префиксу имени
+	/// \param prefix Префикс, имя должно начинаться с него (например pump.config.)
 	/// \param observer Наблюдатель
-	void subscribeToPrefix(std::string_view prefix, AbstractPrefixObserver *observer)
+	/// \param options Параметры доставки
+	void subscribeToPrefix(std::string_view prefix, AbstractPrefixObserver *observer, const SubscribeOptions &options = {})
 	{
-		std::lock_guard lock(mutex);
-		prefixObservers[prefix].push_back(observer);
+		AbstractPrefixObserver *target = resolve(observer, options);
+
+		auto lock = lockExclusive();
+		addPatternLocked(prefixSubscriptions, prefix, target);
 	}
 
-	/// \brief Отписаться от обновление префикса
-	/// \param prefix Префикс (например telem.)
+	/// \brief Отписаться от обновления по префиксу
+	/// \param prefix Префикс
 	/// \param observer Наблюдатель
 	void unsubscribeFromPrefix(std::string_view prefix, AbstractPrefixObserver *observer)
 	{
-		std::lock_guard lock(mutex);
-		auto it = prefixObservers.find(prefix);
-		if (it != prefixObservers.end()) {
-			auto &observers = it->second;
-			observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+		const auto proxies = dispatcher.find(observer);
+		{
+			auto lock = lockExclusive();
+			removePatternLocked(prefixSubscriptions, prefix, observer, proxies);
+		}
+		quiesce(observer, proxies);
+	}
+
+	/// \brief Подписаться на обновление по сегменту имени
+	/// \param segment Сегмент (например telem или .telem), совпадает с целой компонентой имени
+	/// \param observer Наблюдатель
+	/// \param options Параметры доставки
+	void subscribeToSegment(std::string_view segment, AbstractPrefixObserver *observer, const SubscribeOptions &options = {})
+	{
+		AbstractPrefixObserver *target = resolve(observer, options);
+
+		auto lock = lockExclusive();
+		addPatternLocked(segmentSubscriptions, KeyPattern::normalizeSegment(segment), target);
+	}
+
+	/// \brief Отписаться от обновления по сегменту
+	/// \param segment Сегмент
+	/// \param observer Наблюдатель
+	void unsubscribeFromSegment(std::string_view segment, AbstractPrefixObserver *observer)
+	{
+		const auto proxies = dispatcher.find(observer);
+		{
+			auto lock = lockExclusive();
+			removePatternLocked(segmentSubscriptions, KeyPattern::normalizeSegment(segment), observer, proxies);
 		}
+		quiesce(observer, proxies);
 	}
 
 	/// \brief Убрать наблюдателя на запись из всех записей
+	/// Ящики его асинхронных подписок освобождаются, новая подписка начнет с новыми параметрами
 	/// \param observer Наблюдатель
 	void unsubscribeAll(AbstractEntryObserver *observer)
 	{
-		std::lock_guard lock(mutex);
-		for (auto &[key, observers] : keyObservers) {
-			observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+		const auto proxies = dispatcher.find(observer);
+		{
+			auto lock = lockExclusive();
+			const KeyId count = slotCount.load(std::memory_order_relaxed);
+			for (KeyId id = 0; id < count; ++id) {
+				eraseObserver(slotAt(id), observer, proxies);
+			}
 		}
+		quiesce(observer, proxies);
+		dispatcher.release(observer);
 	}
 
-	/// \brief Убрать наблюдателя на префикс из всех записей
+	/// \brief Убрать наблюдателя со всех префиксов и сегментов
 	/// \param observer Наблюдатель
 	void unsubscribeAll(AbstractPrefixObserver *observer)
 	{
-		std::lock_guard lock(mutex);
-		for (auto &[prefix, observers] : prefixObservers) {
-			observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+		const auto proxies = dispatcher.find(observer);
+		{
+			auto lock = lockExclusive();
+			for (auto *subscriptions : {&prefixSubscriptions, &segmentSubscriptions}) {
+				for (auto &[pattern, observers] : *subscriptions) {
+					observers.erase(std::remove_if(observers.begin(), observers.end(),
+						[&](AbstractPrefixObserver *o) { return isObserverOrProxy(o, observer, proxies); }), observers.end());
+				}
+			}
+			rebuildPatternIndexLocked();
+		}
+		quiesce(observer, proxies);
+		dispatcher.release(observer);
+	}
+
+	/// \brief Метрики асинхронной доставки оповещений
+	DispatchStats dispatchStats() const
+	{
+		return dispatcher.stats();
+	}
+
+	/// \brief Срез инструментирования
+	/// Без HYDRO_BB_INSTRUMENTATION возвращает пустой срез с enabled = false
+	BbStats stats() const
+	{
+		BbStats result;
+#if HYDRO_BB_INSTRUMENTATION
+		{
+			auto lock = lockShared();
+			const KeyId count = slotCount.load(std::memory_order_relaxed);
+			for (KeyId id = 0; id < count; ++id) {
+				const Slot &slot = slotAt(id);
+				if (slot.writes != 0) {
+					result.keys.push_back(BbKeyStats{slot.name, slot.writes, slot.changes, slot.rejected});
+				}
+			}
+		}
+
+		std::sort(result.keys.begin(), result.keys.end(),
+			[](const BbKeyStats &a, const BbKeyStats &b) { return a.writes > b.writes; });
+
+		observerTimings.collect(result.observers, false);
+		dispatcher.collectCallbackStats(result.observers);
+		result.exclusiveWait = exclusiveWait.snapshot();
+		result.sharedWait = sharedWait.snapshot();
+#endif
+		return result;
+	}
+
+	/// \brief Номер последнего изменения BB, растет с каждым set/remove, изменившим запись
+	uint64_t currentSequence() const
+	{
+		return sequence.load(std::memory_order_acquire);
+	}
+
+	/// \brief Номер изменения, до которого включительно наблюдатель получил все оповещения
+	/// Асинхронные подписки на разные префиксы сбрасываются независимо, поэтому наибольший пришедший
+	/// seq не годится для продолжения после разрыва: более старое изменение может еще ждать в ящике.
+	/// Вызванный из обработчика наблюдателя считает доставленным то, что обработчик сейчас получает
+	/// \param observer Наблюдатель
+	uint64_t deliveredSequence(AbstractPrefixObserver *observer) const
+	{
+		uint64_t handed;
+		{
+			// Под разделяемым захватом номер не растет, а все писатели с меньшими номерами учтены в notifying
+			auto lock = lockShared();
+			if (notifying.load(std::memory_order_acquire) == 0) {
+				handed = sequence.load(std::memory_order_relaxed);
+				settledSequence.store(handed, std::memory_order_relaxed);
+			} else {
+				handed = settledSequence.load(std::memory_order_relaxed);
+			}
+		}
+
+		const uint64_t oldest = dispatcher.oldestPending(dynamic_cast<const void *>(observer));
+		return oldest ? std::min(handed, oldest - 1) : handed;
+	}
+
+	/// \brief Версия записи - сколько раз она менялась
+	/// \param key Ключ
+	/// \return версия, 0 если запись не менялась ни разу
+	uint64_t getVersion(std::string_view key) const
+	{
+		auto lock = lockShared();
+		auto it = index.find(key);
+		return it != index.end() ? slotAt(it->second).version : 0;
+	}
+
+	/// \brief Неизменяемый срез всех записей на текущий момент
+	/// Пока BB не меняется, все вызывающие получают один и тот же срез без копирования.
+	/// Следующий срез строится из предыдущего: под захватом BB берутся только записи, измененные
+	/// после него, остальные значения переходят из старого среза без копирования строк и структур.
+	/// Полный обход нужен, только если с прошлого среза появились или удалились записи.
+	/// Срез читается без блокировок BB, поэтому подходит для долгих обходов (REST, сохранение
+	/// конфига, начальная синхронизация WS). Для части BB используйте BbSnapshot::byPrefix
+	/// \return разделяемый указатель на срез
+	std::shared_ptr<const BbSnapshot> snapshot() const
+	{
+		std::lock_guard cacheLock(snapshotMutex);
+		if (snapshotCache && snapshotCache->sequence() == sequence.load(std::memory_order_acquire)) {
+			return snapshotCache;
+		}
+
+		std::vector<std::pair<uint32_t, BbSnapshot::Entry>> changed;
+		std::vector<BbSnapshot::Entry> entries;
+		uint64_t seq;
+		bool rebuilt = false;
+		{
+			auto lock = lockShared();
+			seq = sequence.load(std::memory_order_relaxed);
+
+			if (snapshotCache && snapshotLayout == layoutVersion) {
+				const uint64_t since = snapshotCache->sequence();
+				for (KeyId id = newestChanged; id != kInvalidKey; id = slotAt(id).older) {
+					const Slot &slot = slotAt(id);
+					if (slot.seq <= since) {
+						break;
+					}
+					if (id >= snapshotPositions.size() || snapshotPositions[id] == UINT32_MAX) {
+						// Запись без места в срезе - набор все же изменился
+						changed.clear();
+						rebuildSnapshotLocked(entries);
+						rebuilt = true;
+						break;
+					}
+					changed.emplace_back(snapshotPositions[id], BbSnapshot::Entry{slot.name, holdLocked(slot), slot.version});
+				}
+			} else {
+				rebuildSnapshotLocked(entries);
+				rebuilt = true;
+			}
+		}
+
+		if (!rebuilt) {
+			const auto previous = snapshotCache->all();
+			entries.assign(previous.begin(), previous.end());
+			for (auto &[position, entry] : changed) {
+				entries[position] = std::move(entry);
+			}
+		}
+
+		snapshotCache = std::make_shared<const BbSnapshot>(seq, std::move(entries));
+		return snapshotCache;
+	}
+
+	/// \brief Записи, измененные после заданного номера изменения
+	/// Стоимость пропорциональна числу измененных записей, а не размеру BB. Удаленные записи
+	/// приходят со значением monostate. Запрос от 0 дает согласованный срез всех записей
+	/// \param since номер изменения, полученный ранее из BbChangeLog::sequence или BbChange::seq
+	/// \return изменения и текущий номер
+	BbChangeLog changesSince(uint64_t since) const
+	{
+		BbChangeLog result;
+		auto lock = lockShared();
+		result.sequence = sequence.load(std::memory_order_relaxed);
+
+		for (KeyId id = newestChanged; id != kInvalidKey; id = slotAt(id).older) {
+			const Slot &slot = slotAt(id);
+			if (slot.seq <= since) {
+				break;
+			}
+			result.entries.push_back(BbDelta{slot.name, slot.value, slot.version, slot.seq});
 		}
+
+		std::reverse(result.entries.begin(), result.entries.end());
+		return result;
 	}
 
-	/// \brief Получить вектор ключей по префиксу
+	/// \brief Получить ключи, начинающиеся с префикса
 	/// \param prefix Префикс
-	/// \return вектор с ключами
+	/// \return вектор с ключами в лексикографическом порядке
 	std::vector<std::string_view> getKeysByPrefix(std::string_view prefix) const
 	{
-		std::lock_guard lock(mutex);
+		auto lock = lockShared();
 		std::vector<std::string_view> result;
 
-		for (const auto &key : data) {
-			if (key.first.find(prefix) != std::string::npos) {
-				result.push_back(key.first);
+		for (auto it = sortedKeys.lower_bound(prefix); it != sortedKeys.end() && it->first.starts_with(prefix); ++it) {
+			result.push_back(it->first);
+		}
+
+		return result;
+	}
+
+	/// \brief Получить ключи, содержащие сегмент
+	/// \param segment Сегмент (например telem или .telem)
+	/// \return вектор с ключами в лексикографическом порядке
+	std::vector<std::string_view> getKeysBySegment(std::string_view segment) const
+	{
+		auto lock = lockShared();
+		auto it = segmentKeys.find(KeyPattern::normalizeSegment(segment));
+		if (it == segmentKeys.end()) {
+			return {};
+		}
+
+		return {it->second.begin(), it->second.end()};
+	}
+
+	/// \brief Записи, подходящие под маску, согласованно на момент вызова
+	/// Кандидаты берутся из индексов перечисления, срез BB не снимается: при литеральном начале
+	/// маски - диапазон отсортированных имен, иначе - имена с самым редким литеральным сегментом
+	/// \param mask маска имени, "*" заменяет один сегмент (например *.telem.status)
+	/// \return записи в лексикографическом порядке
+	std::vector<BbDelta> matching(std::string_view mask) const
+	{
+		std::vector<BbDelta> result;
+		const size_t star = mask.find('*');
+		const std::string_view prefix = star == std::string_view::npos ? mask : mask.substr(0, star);
+
+		auto lock = lockShared();
+		const auto add = [&](std::string_view name, KeyId id) {
+			if (KeyPattern::matchMask(name, mask)) {
+				const Slot &slot = slotAt(id);
+				result.push_back(BbDelta{slot.name, slot.value, slot.version, slot.seq});
+			}
+		};
+
+		if (!prefix.empty()) {
+			for (auto it = sortedKeys.lower_bound(prefix); it != sortedKeys.end() && it->first.starts_with(prefix); ++it) {
+				add(it->first, it->second);
 			}
+			return result;
 		}
 
+		const std::set<std::string_view> *candidates = nullptr;
+		bool absent = false;
+		KeyPattern::forEachSegment(mask, [&](std::string_view segment) {
+			if (segment == "*" || absent) {
+				return;
+			}
+			auto it = segmentKeys.find(segment);
+			if (it == segmentKeys.end()) {
+				absent = true;
+			} else if (!candidates || it->second.size() < candidates->size()) {
+				candidates = &it->second;
+			}
+		});
+
+		if (absent) {
+			return result;
+		}
+		if (!candidates) {
+			// Маска из одних звездочек
+			for (const auto &[name, id] : sortedKeys) {
+				add(name, id);
+			}
+			return result;
+		}
+		for (const std::string_view name : *candidates) {
+			add(name, index.find(name)->second);
+		}
 		return result;
 	}
 
@@ -316,10 +992,10 @@ public:
 	/// \return имя типа
 	std::string getTypeName(std::string_view key) const
 	{
-		std::lock_guard lock(mutex);
-		auto it = data.find(key);
-		if (it != data.end()) {
-			return it->second.type().name();
+		auto lock = lockShared();
+		auto it = index.find(key);
+		if (it != index.end() && BbTypes::hasValue(slotAt(it->second).value)) {
+			return std::visit([](const auto &v) { return typeid(v).name(); }, slotAt(it->second).value);
 		}
 		return "not_found";
 	}
@@ -327,45 +1003,580 @@ public:
 	/// \brief Распечатать все имеющиеся ключи
 	void printAllKeys()
 	{
+		auto lock = lockShared();
 		std::cout << "All BB keys:" << std::endl;
-		for (const auto &pos : data) {
-			std::cout << pos.first << std::endl;
+		const KeyId count = slotCount.load(std::memory_order_relaxed);
+		for (KeyId id = 0; id < count; ++id) {
+			if (BbTypes::hasValue(slotAt(id).value)) {
+				std::cout << slotAt(id).name << std::endl;
+			}
 		}
 		std::cout << "BB keys end" << std::endl;
 	}
 
 private:
 
-	/// \brief Оповестить все обсерверы
-	/// \param key Ключ
-	/// \param value any со значением
-	void notifyObservers(std::string_view key, const std::any &value)
+	/// \brief Эксклюзивный захват, с инструментированием учитывает время ожидания
+	std::unique_lock<std::shared_mutex> lockExclusive() const
 	{
-		std::vector<AbstractEntryObserver *> keyObserversCopy;
-		std::vector<std::pair<std::string_view, AbstractPrefixObserver *>> prefixObserversCopy;
+#if HYDRO_BB_INSTRUMENTATION
+		// Без конкуренции часы не читаются, в гистограмму идет нулевое ожидание
+		std::unique_lock lock(mutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			exclusiveWait.record(std::chrono::nanoseconds{0});
+		} else {
+			const auto start = Clock::now();
+			lock.lock();
+			exclusiveWait.record(Clock::now() - start);
+		}
+		return lock;
+#else
+		return std::unique_lock(mutex);
+#endif
+	}
 
-		{
-			std::lock_guard lock(mutex);
+	/// \brief Разделяемый захват, с инструментированием учитывает время ожидания
+	std::shared_lock<std::shared_mutex> lockShared() const
+	{
+#if HYDRO_BB_INSTRUMENTATION
+		std::shared_lock lock(mutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			sharedWait.record(std::chrono::nanoseconds{0});
+		} else {
+			const auto start = Clock::now();
+			lock.lock();
+			sharedWait.record(Clock::now() - start);
+		}
+		return lock;
+#else
+		return std::shared_lock(mutex);
+#endif
+	}
+
+	/// \brief Вызвать обработчик подписчика, с инструментированием замеряя его время
+	template<typename Observer, typename F>
+	void timed([[maybe_unused]] const Observer *observer, F &&call) const
+	{
+#if HYDRO_BB_INSTRUMENTATION
+		const auto start = Clock::now();
+		call();
+		observerTimings.of(observer).record(Clock::now() - start);
+#else
+		call();
+#endif
+	}
+
+	Slot &slotAt(KeyId id) const
+	{
+		return chunks[id / kChunkSize].load(std::memory_order_acquire)[id % kChunkSize];
+	}
 
-			auto keyIt = keyObservers.find(key);
-			if (keyIt != keyObservers.end()) {
-				keyObserversCopy = keyIt->second;
+	KeyId registerKeyLocked(std::string_view key)
+	{
+		auto it = index.find(key);
+		if (it != index.end()) {
+			return it->second;
+		}
+
+		const KeyId id = slotCount.load(std::memory_order_relaxed);
+		const size_t chunk = id / kChunkSize;
+		if (chunk >= kMaxChunks) {
+			throw std::length_error("Blackboard key limit reached");
+		}
+		if (!chunks[chunk].load(std::memory_order_relaxed)) {
+			chunks[chunk].store(new Slot[kChunkSize], std::memory_order_release);
+		}
+
+		Slot &slot = slotAt(id);
+		slot.name = std::string(key);
+		for (const auto &[entry, validator] : validatorRules) {
+			if (slot.name.starts_with(entry)) {
+				slot.validators.push_back(validator.get());
 			}
+		}
+		for (const auto &[entry, policy] : policyRules) {
+			if (slot.name.starts_with(entry)) {
+				slot.policy = policy.get();
+			}
+		}
+		for (const auto &[entry, capacity] : historyRules) {
+			if (slot.name.starts_with(entry)) {
+				attachHistoryLocked(slot, capacity);
+			}
+		}
+		index.emplace(slot.name, id);
+		slotCount.store(id + 1, std::memory_order_release);
+		return id;
+	}
 
-			for (const auto &[prefix, observers] : prefixObservers) {
-				if (key.find(prefix) != std::string::npos) {
-					for (auto *observer : observers) {
-						prefixObserversCopy.emplace_back(prefix, observer);
+	/// \brief Применить запись, вызывается под эксклюзивным захватом
+	/// \return true если значение изменилось
+	template<typename T>
+	bool applyLocked(KeyId id, T&& value)
+	{
+		using V = std::decay_t<T>;
+
+		Slot &slot = slotAt(id);
+#if HYDRO_BB_INSTRUMENTATION
+		++slot.writes;
+#endif
+
+		// Если записи нет - просто кладем значение
+		if (!BbTypes::hasValue(slot.value)) {
+			slot.value.emplace<V>(std::forward<T>(value));
+			slot.shared.reset();
+			indexKeyLocked(id);
+			if (slot.policy && slot.policy->timed()) {
+				slot.acceptedAt = ChangePolicy::Clock::now();
+			}
+		// Если запись есть - проверим, есть ли смысл вызывать обсерверы
+		} else {
+			V *old = std::get_if<V>(&slot.value);
+			if (!old) {
+				HYDRO_LOG_ERROR("Key" + slot.name + "trying to change his type, daga kotowaru!");
+#if HYDRO_BB_INSTRUMENTATION
+				++slot.rejected;
+#endif
+				return false;
+			}
+
+			// Но сначала прогоним цепочку валидаторов, привязанных к записи
+			if (!slot.validators.empty()) {
+				const BbValue candidate{std::in_place_type<V>, value};
+				for (const auto *validator : slot.validators) {
+					// Если запись не соответствует хоть одному валидатору - дропаем
+					if (!validator->isDataCorrect(candidate)) {
+#if HYDRO_BB_INSTRUMENTATION
+						++slot.rejected;
+#endif
+						return false;
 					}
 				}
 			}
+
+			// Если оператор сравнения есть - сравниваем, если нет - считаем измененным
+			bool same = false;
+			if constexpr (requires (const V& a, const V& b) { a == b; }) {
+				same = *old == value;
+			}
+
+			constexpr bool kNumeric = std::is_arithmetic_v<V> && !std::is_same_v<V, bool>;
+			if (same) {
+				// Стабильное числовое значение все равно переопубликуется раз в refresh
+				if constexpr (kNumeric) {
+					if (!slot.policy || !refreshDueLocked(slot)) {
+						return false;
+					}
+				} else {
+					return false;
+				}
+			} else {
+				// Шум числовых записей отсеивается до рассылки оповещений
+				if constexpr (kNumeric) {
+					if (slot.policy && !admitLocked(slot, static_cast<double>(*old), static_cast<double>(value))) {
+						return false;
+					}
+				}
+
+				*old = std::forward<T>(value);
+				slot.shared.reset();
+			}
+		}
+
+#if HYDRO_BB_INSTRUMENTATION
+		++slot.changes;
+#endif
+		publish(slot);
+		recordHistoryLocked(slot);
+		touchLocked(id);
+		return true;
+	}
+
+	/// \brief Завести кольцо истории для записи, если его еще нет
+	void attachHistoryLocked(Slot &slot, size_t capacity)
+	{
+		if (slot.history.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		HistoryRing *ring = historyRings.emplace_back(std::make_unique<HistoryRing>(capacity)).get();
+		slot.history.store(ring, std::memory_order_release);
+		recordHistoryLocked(slot);
+	}
+
+	/// \brief Добавить текущее значение в кольцо истории, вызывается под эксклюзивным захватом
+	static void recordHistoryLocked(Slot &slot)
+	{
+		HistoryRing *ring = slot.history.load(std::memory_order_relaxed);
+		if (!ring) {
+			return;
+		}
+
+		if (const auto number = BbTypes::asNumber(slot.value)) {
+			ring->push(HistoryRing::nowMs(), *number);
+		}
+	}
+
+	/// \brief Проверить изменение политикой записи, вызывается под эксклюзивным захватом
+	/// \return true если изменение значимо
+	bool admitLocked(Slot &slot, double accepted, double value)
+	{
+		const ChangePolicy &policy = *slot.policy;
+		const auto now = policy.timed() ? ChangePolicy::Clock::now() : ChangePolicy::Clock::time_point{};
+
+		if (!policy.admits(accepted, value, now - slot.acceptedAt)) {
+			++slot.suppressed;
+			suppressedWrites.fetch_add(1, std::memory_order_relaxed);
+			return false;
 		}
 
-		for (auto *observer : keyObserversCopy) {
-			observer->onEntryUpdated(key, value);
+		slot.acceptedAt = now;
+		return true;
+	}
+
+	/// \brief Подошло ли время принудительного обновления, вызывается под эксклюзивным захватом
+	/// \return true если с последнего принятия прошло не меньше refresh, время принятия при этом сдвигается
+	bool refreshDueLocked(Slot &slot)
+	{
+		const ChangePolicy &policy = *slot.policy;
+		if (policy.refresh.count() <= 0) {
+			return false;
+		}
+
+		const auto now = ChangePolicy::Clock::now();
+		if (now - slot.acceptedAt < policy.refresh) {
+			return false;
+		}
+
+		slot.acceptedAt = now;
+		return true;
+	}
+
+	/// \brief Отметить изменение записи: новый номер изменения и перенос в конец списка
+	void touchLocked(KeyId id)
+	{
+		Slot &slot = slotAt(id);
+		const uint64_t seq = sequence.load(std::memory_order_relaxed) + 1;
+		sequence.store(seq, std::memory_order_release);
+		++slot.version;
+		slot.seq = seq;
+
+		if (newestChanged == id) {
+			return;
+		}
+
+		// Вынуть из списка, если запись уже менялась
+		if (slot.older != kInvalidKey) {
+			slotAt(slot.older).newer = slot.newer;
+		} else if (oldestChanged == id) {
+			oldestChanged = slot.newer;
+		}
+		if (slot.newer != kInvalidKey) {
+			slotAt(slot.newer).older = slot.older;
 		}
-		for (auto &[prefix, observer] : prefixObserversCopy) {
-			observer->onPrefixUpdated(prefix, key, value);
+
+		slot.older = newestChanged;
+		slot.newer = kInvalidKey;
+		if (newestChanged != kInvalidKey) {
+			slotAt(newestChanged).newer = id;
+		}
+		newestChanged = id;
+		if (oldestChanged == kInvalidKey) {
+			oldestChanged = id;
+		}
+	}
+
+	template<typename T>
+	std::optional<T> getLocked(KeyId id) const
+	{
+		if constexpr (BbTypes::kSupported<T>) {
+			if (const T *value = std::get_if<T>(&slotAt(id).value)) {
+				return *value;
+			}
+		}
+		return std::nullopt;
+	}
+
+	/// \brief Удержать текущее значение записи для оповещения или среза
+	/// Разделяемые типы копируются в общий буфер один раз на значение, дальше раздается тот же буфер
+	static BbHeldValue holdLocked(const Slot &slot)
+	{
+		if (!BbTypes::isShared(slot.value)) {
+			return BbHeldValue{slot.value};
+		}
+		if (!slot.shared) {
+			slot.shared = std::make_shared<const BbValue>(slot.value);
+		}
+		return BbHeldValue{slot.shared};
+	}
+
+	/// \brief Обновить seqlock копию значения, вызывается под эксклюзивным захватом
+	/// \param slot Слот
+	static void publish(Slot &slot)
+	{
+		const auto tag = static_cast<uint32_t>(slot.value.index());
+
+		std::visit(
+			[&](const auto &v) {
+				using V = std::decay_t<decltype(v)>;
+				if constexpr (std::is_same_v<V, std::monostate>) {
+					slot.mirror.store(0, nullptr, 0);
+				} else if constexpr (std::is_trivially_copyable_v<V>) {
+					slot.mirror.store(tag, &v, sizeof(V));
+				} else {
+					// Нетривиальные типы читаются только под мьютексом, в ячейке лишь признак наличия
+					slot.mirror.store(tag, nullptr, 0);
+				}
+			},
+			slot.value);
+	}
+
+	/// \brief Изменение из пакета вместе со снимком наблюдателей записи
+	struct BatchChange {
+		KeyId id;
+		std::string_view key;
+		BbHeldValue value; // Пусто, если у записи нет наблюдателей
+		uint64_t seq;
+		std::shared_ptr<const EntryObservers> observers;
+	};
+
+	/// \brief Применить пакет записей под одним захватом и разослать оповещения
+	/// \return количество измененных записей
+	size_t applyBatch(Writes &writes)
+	{
+		std::vector<BatchChange> changes;
+		std::shared_ptr<const PatternIndex> patternObs;
+
+		{
+			auto lock = lockExclusive();
+			for (auto &[id, value] : writes) {
+				const bool changed = std::visit(
+					[&](auto &&v) {
+						if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+							return false;
+						} else {
+							return applyLocked(id, std::move(v));
+						}
+					},
+					std::move(value));
+
+				if (!changed) {
+					continue;
+				}
+
+				// Повторная запись того же ключа в пакете схлопывается в последнее значение
+				const Slot &slot = slotAt(id);
+				const bool observed = slot.observers || !patternIndex->empty();
+				BbHeldValue held = observed ? holdLocked(slot) : BbHeldValue{};
+				auto it = std::find_if(changes.begin(), changes.end(), [&](const BatchChange &c) { return c.id == id; });
+				if (it != changes.end()) {
+					it->value = std::move(held);
+					it->seq = slot.seq;
+				} else {
+					changes.push_back(BatchChange{id, slot.name, std::move(held), slot.seq, slot.observers});
+				}
+			}
+
+			patternObs = patternIndex;
+			notifying.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		notifyBatch(changes, *patternObs);
+		notifying.fetch_sub(1, std::memory_order_release);
+		return changes.size();
+	}
+
+	/// \brief Собрать срез заново после изменения набора записей, под разделяемым захватом
+	/// Значения, не менявшиеся с прошлого среза, берутся из него
+	void rebuildSnapshotLocked(std::vector<BbSnapshot::Entry> &entries) const
+	{
+		const std::span<const BbSnapshot::Entry> previous = snapshotCache ? snapshotCache->all() : std::span<const BbSnapshot::Entry>{};
+		const uint64_t since = snapshotCache ? snapshotCache->sequence() : 0;
+
+		std::vector<uint32_t> positions(slotCount.load(std::memory_order_relaxed), UINT32_MAX);
+		entries.reserve(sortedKeys.size());
+		for (const auto &[name, id] : sortedKeys) {
+			const Slot &slot = slotAt(id);
+			const uint32_t old = id < snapshotPositions.size() ? snapshotPositions[id] : UINT32_MAX;
+			if (old != UINT32_MAX && slot.seq <= since) {
+				entries.push_back(previous[old]);
+			} else {
+				entries.push_back(BbSnapshot::Entry{name, holdLocked(slot), slot.version});
+			}
+			positions[id] = static_cast<uint32_t>(entries.size() - 1);
+		}
+
+		snapshotPositions = std::move(positions);
+		snapshotLayout = layoutVersion;
+	}
+
+	/// \brief Добавить запись в индексы перечисления, при появлении значения
+	void indexKeyLocked(KeyId id)
+	{
+		const std::string_view name = slotAt(id).name;
+		sortedKeys.emplace(name, id);
+		++layoutVersion;
+		KeyPattern::forEachSegment(name, [&](std::string_view aSegment) { segmentKeys[aSegment].insert(name); });
+	}
+
+	/// \brief Убрать запись из индексов перечисления, при удалении значения
+	void unindexKeyLocked(KeyId id)
+	{
+		const std::string_view name = slotAt(id).name;
+		sortedKeys.erase(name);
+		++layoutVersion;
+		KeyPattern::forEachSegment(name, [&](std::string_view aSegment) {
+			auto it = segmentKeys.find(aSegment);
+			if (it != segmentKeys.end()) {
+				it->second.erase(name);
+				if (it->second.empty()) {
+					segmentKeys.erase(it);
+				}
+			}
+		});
+	}
+
+	void addPatternLocked(PatternObservers &subscriptions, std::string_view pattern, AbstractPrefixObserver *observer)
+	{
+		auto it = subscriptions.find(pattern);
+		if (it == subscriptions.end()) {
+			it = subscriptions.emplace(std::string(pattern), std::vector<AbstractPrefixObserver *>{}).first;
+		}
+		it->second.push_back(observer);
+		rebuildPatternIndexLocked();
+	}
+
+	void removePatternLocked(PatternObservers &subscriptions, std::string_view pattern, AbstractPrefixObserver *observer,
+		const std::vector<AbstractPrefixObserver *> &proxies)
+	{
+		auto it = subscriptions.find(pattern);
+		if (it == subscriptions.end()) {
+			return;
+		}
+
+		auto &observers = it->second;
+		observers.erase(std::remove_if(observers.begin(), observers.end(),
+			[&](AbstractPrefixObserver *o) { return isObserverOrProxy(o, observer, proxies); }), observers.end());
+		rebuildPatternIndexLocked();
+	}
+
+	/// \brief Наблюдатель, которого нужно положить в список подписчиков
+	/// \return сам наблюдатель для Inline или его прокси в диспетчере для Async
+	template<typename Observer>
+	Observer *resolve(Observer *observer, const SubscribeOptions &options)
+	{
+		if (options.isAsync()) {
+			return dispatcher.proxy(observer, options);
+		}
+		return observer;
+	}
+
+	/// \brief Дождаться доставки асинхронному наблюдателю, вызывается без захваченного мьютекса
+	template<typename Observer>
+	void quiesce(Observer *observer, const std::vector<Observer *> &proxies)
+	{
+		if (!proxies.empty()) {
+			dispatcher.quiesce(dynamic_cast<const void *>(observer));
+		}
+	}
+
+	/// \brief Элемент списка подписчиков - сам наблюдатель или один из его прокси
+	template<typename Observer>
+	static bool isObserverOrProxy(const Observer *o, const Observer *observer, const std::vector<Observer *> &proxies)
+	{
+		return o == observer || std::find(proxies.begin(), proxies.end(), o) != proxies.end();
+	}
+
+	/// \brief Пересобрать неизменяемый индекс подписок, старый снимок доживает у текущих оповещений
+	void rebuildPatternIndexLocked()
+	{
+		auto updated = std::make_shared<PatternIndex>();
+		for (const auto &[prefix, observers] : prefixSubscriptions) {
+			if (!observers.empty()) {
+				updated->addPrefix(prefix, observers);
+			}
+		}
+		for (const auto &[segment, observers] : segmentSubscriptions) {
+			if (!observers.empty()) {
+				updated->addSegment(segment, observers);
+			}
+		}
+		patternIndex = std::move(updated);
+	}
+
+	static void eraseObserver(Slot &slot, AbstractEntryObserver *observer, const std::vector<AbstractEntryObserver *> &proxies)
+	{
+		if (!slot.observers) {
+			return;
+		}
+
+		auto updated = std::make_shared<EntryObservers>(*slot.observers);
+		updated->erase(std::remove_if(updated->begin(), updated->end(),
+			[&](AbstractEntryObserver *o) { return isObserverOrProxy(o, observer, proxies); }), updated->end());
+		slot.observers = std::move(updated);
+	}
+
+	/// \brief Оповестить все обсерверы, вызывается без захваченного мьютекса
+	/// \param key Ключ
+	/// \param value значение
+	/// \param entryObs снимок наблюдателей записи, может быть nullptr
+	/// \param patternObs снимок индекса подписок по префиксам и сегментам
+	void notifyObservers(std::string_view key, const BbHeldValue &value, uint64_t seq, const EntryObservers *entryObs,
+		const PatternIndex &patternObs, bool removed = false) const
+	{
+		if (entryObs) {
+			for (auto *observer : *entryObs) {
+				timed(observer, [&]() { notifyEntry(observer, key, value); });
+			}
+		}
+
+		const BbShared *shared = value.handle() ? &value.handle() : nullptr;
+		patternObs.match(key, [&](std::string_view pattern, const PatternIndex::Observers &observers) {
+			for (auto *observer : observers) {
+				timed(observer, [&]() { observer->onPrefixChanged(BbChange{pattern, key, &value.get(), seq, shared, removed}); });
+			}
+		});
+	}
+
+	/// \brief Оповестить наблюдателя записи, разделяемые значения уходят вместе с буфером
+	static void notifyEntry(AbstractEntryObserver *observer, std::string_view key, const BbHeldValue &value)
+	{
+		if (value.handle()) {
+			observer->onEntryShared(key, value.handle());
+		} else {
+			observer->onEntryUpdated(key, value.get());
+		}
+	}
+
+	/// \brief Оповестить наблюдателей о пакете изменений
+	/// Наблюдатели записей получают по вызову на запись, наблюдатели префиксов - один вызов на пакет
+	/// \param changes изменения пакета
+	/// \param patternObs снимок индекса подписок по префиксам и сегментам
+	void notifyBatch(const std::vector<BatchChange> &changes, const PatternIndex &patternObs) const
+	{
+		std::vector<std::pair<AbstractPrefixObserver *, std::vector<BbChange>>> grouped;
+
+		for (const auto &change : changes) {
+			if (change.observers) {
+				for (auto *observer : *change.observers) {
+					timed(observer, [&]() { notifyEntry(observer, change.key, change.value); });
+				}
+			}
+
+			const BbShared *shared = change.value.handle() ? &change.value.handle() : nullptr;
+			patternObs.match(change.key, [&](std::string_view pattern, const PatternIndex::Observers &observers) {
+				for (auto *observer : observers) {
+					auto it = std::find_if(grouped.begin(), grouped.end(), [&](const auto &g) { return g.first == observer; });
+					if (it == grouped.end()) {
+						it = grouped.emplace(grouped.end(), observer, std::vector<BbChange>{});
+					}
+					it->second.push_back(BbChange{pattern, change.key, &change.value.get(), change.seq, shared});
+				}
+			});
+		}
+
+		for (auto &[observer, observerChanges] : grouped) {
+			timed(observer, [&]() { observer->onPrefixBatchUpdated(observerChanges); });
 		}
 	}
 };
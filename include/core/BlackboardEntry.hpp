@@ -1,18 +1,28 @@
 #ifndef BLACKBOARDENTRY_HPP
 #define BLACKBOARDENTRY_HPP
 
+#include <core/BbKey.hpp>
 #include <core/Blackboard.hpp>
 #include <memory>
 #include <type_traits>
 
 /// \brief Обертка над BB, описывающая одну запись
+/// Имя регистрируется в BB один раз при создании, дальше работа идет по KeyId
 template<typename T>
 class BlackboardEntry {
 public:
-	BlackboardEntry(std::string aName, std::shared_ptr<Blackboard> aBb) : name{aName}, bb{aBb}
+	BlackboardEntry(std::string_view aName, std::shared_ptr<Blackboard> aBb) :
+		bb{aBb},
+		key{bb->registerKey(aName)},
+		name{bb->getName(key)}
 	{
 	}
 
+	/// \brief Описание записи другого типа - ошибка компиляции, а не исключение при чтении
+	template<typename U>
+		requires(!std::is_same_v<U, T>)
+	BlackboardEntry(const BbKey<U> &aKey, std::shared_ptr<Blackboard> aBb) = delete;
+
 	/// \brief Установить значение
 	/// \param aValue значение типа T, если T это enum то записывается int
 	/// \return true если запись успешна
@@ -20,9 +30,21 @@ public:
 	{
 		if constexpr (std::is_enum_v<T>) {
 			int value = static_cast<int>(aValue);
-			return bb->set(name, value);
+			return bb->set(key, value);
 		} else {
-			return bb->set(name, aValue);
+			return bb->set(key, aValue);
+		}
+	}
+
+	/// \brief Добавить значение в пакетную запись
+	/// \param aBatch пакет
+	/// \param aValue значение типа T, если T это enum то записывается int
+	void set(Blackboard::Batch &aBatch, T aValue)
+	{
+		if constexpr (std::is_enum_v<T>) {
+			aBatch.set(key, static_cast<int>(aValue));
+		} else {
+			aBatch.set(key, std::move(aValue));
 		}
 	}
 
@@ -30,7 +52,7 @@ public:
 	/// \return true если есть
 	bool present() const
 	{
-		return bb->has(name);
+		return bb->has(key);
 	}
 
 	/// \brief Прочитать значение типа T (throwable!)
@@ -38,10 +60,10 @@ public:
 	T read() const
 	{
 		if constexpr (std::is_enum_v<T>) {
-			int value = bb->get<int>(name).value();
+			int value = bb->get<int>(key).value();
 			return static_cast<T>(value);
 		} else {
-			return bb->get<T>(name).value();
+			return bb->get<T>(key).value();
 		}
 	}
 
@@ -49,7 +71,7 @@ public:
 	/// \param aObs обсервер
 	void subscribe(AbstractEntryObserver *aObs)
 	{
-		return bb->subscribe(name, aObs);
+		return bb->subscribe(key, aObs);
 	}
 
 	auto operator=(T aValue)
@@ -67,9 +89,15 @@ public:
 		return name;
 	}
 
+	KeyId getKey() const
+	{
+		return key;
+	}
+
 private:
-	std::string name;
 	std::shared_ptr<Blackboard> bb;
+	KeyId key;
+	std::string_view name; // Указывает на имя внутри BB
 };
 
 #endif // BLACKBOARDENTRY_HPP
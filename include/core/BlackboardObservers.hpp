@@ -0,0 +1,62 @@
+/*!
+@file
+@brief Интерфейсы наблюдателей Blackboard
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/BlackboardValue.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// \brief Наблюдатель BB за отдельными entry
+class AbstractEntryObserver {
+public:
+	virtual ~AbstractEntryObserver() = default;
+	virtual void onEntryUpdated(std::string_view entry, const BbValue &value) = 0;
+
+	/// \brief Изменение строки или структуры вместе с общим буфером значения
+	/// Переопределяется теми, кто удерживает значение после вызова: буфер можно просто сохранить
+	virtual void onEntryShared(std::string_view entry, const BbShared &value)
+	{
+		onEntryUpdated(entry, *value);
+	}
+};
+
+/// \brief Изменение записи, ссылки валидны только на время оповещения
+struct BbChange {
+	std::string_view prefix; // Шаблон подписки, по которому пришло изменение
+	std::string_view entry;
+	const BbValue *value;
+	uint64_t seq = 0; // Глобальный номер изменения, см. Blackboard::changesSince
+	const BbShared *shared = nullptr; // Общий буфер *value, если значение разделяемое
+	bool removed = false; // Запись удалена, value - ее последнее значение
+};
+
+/// \brief Наблюдатель BB за entry по префиксу или сегменту имени
+class AbstractPrefixObserver {
+public:
+	virtual ~AbstractPrefixObserver() = default;
+	virtual void onPrefixUpdated(std::string_view prefix, std::string_view entry, const BbValue &value) = 0;
+
+	/// \brief Одиночное изменение вместе с номером изменения
+	/// По умолчанию сводится к onPrefixUpdated, переопределяется теми, кому нужен номер
+	virtual void onPrefixChanged(const BbChange &change)
+	{
+		onPrefixUpdated(change.prefix, change.entry, *change.value);
+	}
+
+	/// \brief Пакет изменений из Blackboard::Batch, приходит одним вызовом на наблюдателя
+	/// По умолчанию раскладывается на одиночные onPrefixChanged
+	virtual void onPrefixBatchUpdated(const std::vector<BbChange> &changes)
+	{
+		for (const auto &change : changes) {
+			onPrefixChanged(change);
+		}
+	}
+};
@@ -0,0 +1,124 @@
+/*!
+@file
+@brief Неизменяемый срез Blackboard на момент времени
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/BlackboardValue.hpp"
+#include "core/KeyPatternIndex.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// \brief Неизменяемый срез всех записей BB
+/// Снимается одним разделяемым захватом, дальше читается без блокировок из любого потока.
+/// Записи отсортированы по имени, поэтому поиск по имени - двоичный, а записи с общим префиксом
+/// лежат подряд. Имена указывают внутрь BB и валидны, пока жив BB.
+/// Строки и структуры лежат в общих буферах: следующий срез берет неизмененные значения
+/// у предыдущего и копирует только изменившиеся
+class BbSnapshot {
+public:
+	struct Entry {
+		std::string_view key;
+		BbHeldValue held;
+		uint64_t version;
+
+		const BbValue &value() const
+		{
+			return held.get();
+		}
+	};
+
+	BbSnapshot(uint64_t aSequence, std::vector<Entry> &&aEntries) : seq{aSequence}, entries{std::move(aEntries)}
+	{
+	}
+
+	/// \brief Номер последнего изменения BB, вошедшего в срез
+	uint64_t sequence() const
+	{
+		return seq;
+	}
+
+	/// \brief Все записи, отсортированы по имени
+	std::span<const Entry> all() const
+	{
+		return entries;
+	}
+
+	/// \brief Записи, имя которых начинается с префикса
+	std::span<const Entry> byPrefix(std::string_view aPrefix) const
+	{
+		auto begin = std::lower_bound(entries.begin(), entries.end(), aPrefix,
+			[](const Entry &aEntry, std::string_view aKey) { return aEntry.key < aKey; });
+		auto end = begin;
+		while (end != entries.end() && end->key.starts_with(aPrefix)) {
+			++end;
+		}
+		return {begin, end};
+	}
+
+	/// \brief Пройти по записям, содержащим сегмент
+	/// \param aSegment сегмент (например telem или .telem)
+	/// \param aCallback вызывается как aCallback(const Entry &)
+	template<typename F>
+	void forEachInSegment(std::string_view aSegment, F &&aCallback) const
+	{
+		const std::string_view segment = KeyPattern::normalizeSegment(aSegment);
+		for (const auto &entry : entries) {
+			if (KeyPattern::hasSegment(entry.key, segment)) {
+				aCallback(entry);
+			}
+		}
+	}
+
+	/// \brief Найти запись
+	/// \return указатель на запись или nullptr
+	const Entry *find(std::string_view aKey) const
+	{
+		auto it = std::lower_bound(entries.begin(), entries.end(), aKey,
+			[](const Entry &aEntry, std::string_view aName) { return aEntry.key < aName; });
+		return it != entries.end() && it->key == aKey ? &*it : nullptr;
+	}
+
+	bool has(std::string_view aKey) const
+	{
+		return find(aKey) != nullptr;
+	}
+
+	template<typename T>
+	bool isType(std::string_view aKey) const
+	{
+		if constexpr (!BbTypes::kSupported<T>) {
+			return false;
+		} else {
+			const Entry *entry = find(aKey);
+			return entry && std::holds_alternative<T>(entry->value());
+		}
+	}
+
+	template<typename T>
+	std::optional<T> get(std::string_view aKey) const
+	{
+		if constexpr (BbTypes::kSupported<T>) {
+			if (const Entry *entry = find(aKey)) {
+				if (const T *value = std::get_if<T>(&entry->value())) {
+					return *value;
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+private:
+	uint64_t seq;
+	std::vector<Entry> entries;
+};
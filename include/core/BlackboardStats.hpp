@@ -0,0 +1,177 @@
+/*!
+@file
+@brief Инструментирование Blackboard: счетчики записей, задержки подписчиков и ожидание мьютекса
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+// Включается опцией CMake HYDRO_BB_INSTRUMENTATION. В выключенном виде в BB не остается
+// ни полей, ни чтений часов, ни лишних ветвлений
+#ifndef HYDRO_BB_INSTRUMENTATION
+#define HYDRO_BB_INSTRUMENTATION 0
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+/// \brief Гистограмма задержек с логарифмическими корзинами
+/// Корзина 0 - меньше 1 мкс, корзина i - [2^(i-1), 2^i) мкс, последняя - все что дольше.
+/// Запись - несколько relaxed атомарных инкрементов, можно звать из любых потоков
+class LatencyHistogram {
+public:
+	static constexpr size_t kBuckets = 24;
+
+	struct Snapshot {
+		std::array<uint64_t, kBuckets> buckets{};
+		uint64_t count = 0;
+		uint64_t totalUs = 0;
+		uint64_t maxUs = 0;
+
+		/// \brief Верхняя граница корзины, в которую попал перцентиль
+		/// \param aPercentile от 0 до 100
+		/// \return микросекунды
+		uint64_t percentileUs(double aPercentile) const
+		{
+			if (count == 0) {
+				return 0;
+			}
+
+			// Ранг по методу ближайшего ранга, от 1
+			const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(static_cast<double>(count) * aPercentile / 100.0)));
+			uint64_t seen = 0;
+			for (size_t i = 0; i < kBuckets; ++i) {
+				seen += buckets[i];
+				if (seen >= rank) {
+					return std::min(upperBoundUs(i), maxUs);
+				}
+			}
+			return maxUs;
+		}
+	};
+
+	void record(std::chrono::nanoseconds aDuration)
+	{
+		const auto us = static_cast<uint64_t>(std::max<int64_t>(aDuration.count(), 0) / 1000);
+		const size_t bucket = std::min<size_t>(static_cast<size_t>(std::bit_width(us)), kBuckets - 1);
+
+		buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		totalUs.fetch_add(us, std::memory_order_relaxed);
+
+		uint64_t max = maxUs.load(std::memory_order_relaxed);
+		while (us > max && !maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+		}
+	}
+
+	Snapshot snapshot() const
+	{
+		Snapshot result;
+		for (size_t i = 0; i < kBuckets; ++i) {
+			result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+		}
+		result.count = count.load(std::memory_order_relaxed);
+		result.totalUs = totalUs.load(std::memory_order_relaxed);
+		result.maxUs = maxUs.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	static constexpr uint64_t upperBoundUs(size_t aBucket)
+	{
+		return aBucket == 0 ? 1 : uint64_t{1} << aBucket;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> totalUs{0};
+	std::atomic<uint64_t> maxUs{0};
+};
+
+/// \brief Счетчики записи
+struct BbKeyStats {
+	std::string key;
+	uint64_t writes = 0;   // Все попытки записи
+	uint64_t changes = 0;  // Записи, изменившие значение
+	uint64_t rejected = 0; // Отказы: смена типа или валидатор
+};
+
+/// \brief Время в обработчиках одного подписчика
+struct BbObserverStats {
+	std::string name; // Тип подписчика
+	bool async = false; // Время в пуле диспетчера, иначе в потоке писателя
+	LatencyHistogram::Snapshot latency;
+};
+
+/// \brief Срез инструментирования BB
+struct BbStats {
+	bool enabled = HYDRO_BB_INSTRUMENTATION;
+	std::vector<BbKeyStats> keys; // По убыванию числа записей
+	std::vector<BbObserverStats> observers;
+	LatencyHistogram::Snapshot exclusiveWait; // Ожидание мьютекса писателями
+	LatencyHistogram::Snapshot sharedWait;    // Ожидание мьютекса читателями
+};
+
+namespace BbInstrumentation {
+
+/// \brief Читаемое имя типа
+inline std::string typeName(const std::type_info &aType)
+{
+	int status = 0;
+	std::unique_ptr<char, void (*)(void *)> demangled{abi::__cxa_demangle(aType.name(), nullptr, nullptr, &status), std::free};
+	return status == 0 && demangled ? std::string{demangled.get()} : std::string{aType.name()};
+}
+
+/// \brief Гистограммы подписчиков, ключ - адрес объекта подписчика
+/// Гистограммы не удаляются, ссылки на них стабильны
+class ObserverTimings {
+public:
+	template<typename Observer>
+	LatencyHistogram &of(const Observer *aObserver)
+	{
+		const void *key = dynamic_cast<const void *>(aObserver);
+
+		std::lock_guard lock(mutex);
+		auto &entry = timings[key];
+		if (!entry) {
+			entry = std::make_unique<Entry>();
+			entry->name = typeName(typeid(*aObserver));
+		}
+		return entry->histogram;
+	}
+
+	void collect(std::vector<BbObserverStats> &aOut, bool aAsync) const
+	{
+		std::lock_guard lock(mutex);
+		for (const auto &[key, entry] : timings) {
+			aOut.push_back(BbObserverStats{entry->name, aAsync, entry->histogram.snapshot()});
+		}
+	}
+
+private:
+	struct Entry {
+		std::string name;
+		LatencyHistogram histogram;
+	};
+
+	mutable std::mutex mutex;
+	std::unordered_map<const void *, std::unique_ptr<Entry>> timings;
+};
+
+} // namespace BbInstrumentation
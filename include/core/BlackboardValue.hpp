@@ -0,0 +1,172 @@
+/*!
+@file
+@brief Закрытый набор типов, хранимых в Blackboard
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/RadioTypes.hpp"
+#include "core/Types.hpp"
+
+#include <UtilitaryRS/RsTypes.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+/// \brief Значение записи BB
+/// Хранится inline, без аллокаций для всех типов кроме std::string.
+/// std::monostate означает отсутствие значения.
+/// Енамы (PumpModes, PlainType...) хранятся как int, см. BlackboardEntry
+using BbValue = std::variant<
+	std::monostate,
+	bool,
+	int,
+	unsigned,
+	float,
+	std::string,
+	std::chrono::seconds,
+	std::chrono::milliseconds,
+	DeviceStatus,
+	HydroRS::MultiControllerTelem,
+	RS::DeviceVersion>;
+
+/// \brief Неизменяемое значение BB с общим владением
+using BbShared = std::shared_ptr<const BbValue>;
+
+namespace BbTypes {
+
+template<typename T, typename Variant>
+struct IsAlternative;
+
+template<typename T, typename... Ts>
+struct IsAlternative<T, std::variant<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)> {
+};
+
+template<typename T, typename Variant>
+struct IndexOf;
+
+template<typename T, typename... Ts>
+struct IndexOf<T, std::variant<Ts...>> {
+	static constexpr size_t value = []() {
+		constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+		size_t i = 0;
+		while (i < sizeof...(Ts) && !matches[i]) {
+			++i;
+		}
+		return i;
+	}();
+};
+
+template<typename Variant>
+struct MaxTrivialSize;
+
+template<typename... Ts>
+struct MaxTrivialSize<std::variant<Ts...>> {
+	static constexpr size_t value = std::max({(std::is_trivially_copyable_v<Ts> ? sizeof(Ts) : size_t{0})...});
+};
+
+/// \brief true если тип T может храниться в BB
+template<typename T>
+inline constexpr bool kSupported = IsAlternative<T, BbValue>::value && !std::is_same_v<T, std::monostate>;
+
+/// \brief Индекс альтернативы T в BbValue
+template<typename T>
+inline constexpr size_t kIndex = IndexOf<T, BbValue>::value;
+
+/// \brief Размер, достаточный для любого тривиально копируемого типа BbValue
+inline constexpr size_t kTrivialSize = MaxTrivialSize<BbValue>::value;
+
+/// \brief Тривиально копируемые типы читаются из BB без блокировок (через seqlock)
+template<typename T>
+inline constexpr bool kLockFree = kSupported<T> && std::is_trivially_copyable_v<T>;
+
+/// \brief Значения типа T при оповещении разделяются по ссылке, а не копируются
+/// Строку копировать дорого, структура телеметрии крупнее пары указателей
+template<typename T>
+inline constexpr bool kShared = !std::is_trivially_copyable_v<T> || sizeof(T) > 2 * sizeof(void *);
+
+/// \brief Разделяется ли значение при оповещении, см. kShared
+static inline bool isShared(const BbValue &aValue)
+{
+	return std::visit([](const auto &v) { return kShared<std::decay_t<decltype(v)>>; }, aValue);
+}
+
+/// \brief Проверка наличия значения
+static inline bool hasValue(const BbValue &aValue)
+{
+	return !std::holds_alternative<std::monostate>(aValue);
+}
+
+/// \brief Числовое представление значения для истории и графиков
+/// \return nullopt для строк, структур и пустого значения
+static inline std::optional<double> asNumber(const BbValue &aValue)
+{
+	return std::visit(
+		[](const auto &v) -> std::optional<double> {
+			using T = std::decay_t<decltype(v)>;
+			if constexpr (std::is_arithmetic_v<T>) {
+				return static_cast<double>(v);
+			} else if constexpr (std::is_same_v<T, std::chrono::seconds> || std::is_same_v<T, std::chrono::milliseconds>) {
+				return static_cast<double>(v.count());
+			} else if constexpr (std::is_enum_v<T>) {
+				return static_cast<double>(static_cast<int>(v));
+			} else {
+				return std::nullopt;
+			}
+		},
+		aValue);
+}
+
+} // namespace BbTypes
+
+/// \brief Значение, удерживаемое после оповещения: в очередях асинхронных подписчиков и в пакетах
+/// Мелкие тривиальные значения лежат inline, строки и структуры - в одном неизменяемом буфере,
+/// который получают все подписчики изменения без копирования
+class BbHeldValue {
+public:
+	BbHeldValue() = default;
+
+	explicit BbHeldValue(const BbValue &aValue) : inlineValue{aValue}
+	{
+	}
+
+	explicit BbHeldValue(BbShared aShared) : shared{std::move(aShared)}
+	{
+	}
+
+	/// \brief Удержать значение: разделяемые типы переносятся в общий буфер, остальные копируются
+	static BbHeldValue make(const BbValue &aValue)
+	{
+		return BbTypes::isShared(aValue) ? BbHeldValue{std::make_shared<const BbValue>(aValue)} : BbHeldValue{aValue};
+	}
+
+	static BbHeldValue make(BbValue &&aValue)
+	{
+		return BbTypes::isShared(aValue) ? BbHeldValue{std::make_shared<const BbValue>(std::move(aValue))}
+										 : BbHeldValue{aValue};
+	}
+
+	const BbValue &get() const
+	{
+		return shared ? *shared : inlineValue;
+	}
+
+	/// \brief Общий буфер, пустой для значений inline
+	const BbShared &handle() const
+	{
+		return shared;
+	}
+
+private:
+	BbValue inlineValue;
+	BbShared shared;
+};
@@ -0,0 +1,55 @@
+/*!
+@file
+@brief Политика изменения числовых записей: мертвая зона, минимальный интервал и принудительное обновление
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+/// \brief Политика изменения числовой записи
+/// Сравнение идет с последним принятым значением, а не с предыдущей записью, поэтому медленный
+/// дрейф накапливается и в итоге проходит, а шум вокруг одного уровня отсекается (гистерезис).
+/// Отсеянная запись не меняет значение в BB и не будит наблюдателей
+struct ChangePolicy {
+	using Clock = std::chrono::steady_clock;
+
+	double absolute = 0.0; // Мертвая зона в единицах записи
+	double relative = 0.0; // Мертвая зона в долях от принятого значения, 0.01 - 1%
+	std::chrono::milliseconds minInterval{0}; // Изменения чаще отсеиваются, 0 - без ограничения
+	std::chrono::milliseconds refresh{0};     // Через сколько принять любое изменение, 0 - никогда
+
+	/// \brief Нужны ли политике часы
+	bool timed() const
+	{
+		return minInterval.count() > 0 || refresh.count() > 0;
+	}
+
+	/// \brief Значимо ли изменение
+	/// \param aAccepted последнее принятое значение
+	/// \param aValue новое значение
+	/// \param aElapsed сколько прошло с принятия aAccepted
+	bool admits(double aAccepted, double aValue, Clock::duration aElapsed) const
+	{
+		if (refresh.count() > 0 && aElapsed >= refresh) {
+			return true;
+		}
+
+		if (minInterval.count() > 0 && aElapsed < minInterval) {
+			return false;
+		}
+
+		// NaN от датчика или выход из него - всегда изменение
+		if (std::isnan(aAccepted) || std::isnan(aValue)) {
+			return std::isnan(aAccepted) != std::isnan(aValue);
+		}
+
+		const double band = std::max(absolute, relative * std::abs(aAccepted));
+		return std::abs(aValue - aAccepted) > band;
+	}
+};
@@ -1,61 +1,552 @@
+/*!
+@file
+@brief Шина событий между подсистемами
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
 #pragma once
 
-#include <any>
+#include "core/BlackboardStats.hpp"
+#include "core/MpscQueue.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
 #include <mutex>
-#include <iostream>
-#include <queue>
 #include <string>
-#include <string_view>
+#include <thread>
 #include <unordered_map>
-#include <functional>
-#include <optional>
+#include <utility>
+#include <variant>
 #include <vector>
-#include <thread>
 
 enum class EventType : uint64_t {
 	PumpSetState,
 	LampSetState,
 };
 
+namespace Events {
+
+/// \brief Включить или выключить насос
+struct PumpSetState {
+	static constexpr EventType kType = EventType::PumpSetState;
+	bool enabled = false;
+
+	bool operator==(const PumpSetState &) const = default;
+};
+
+/// \brief Включить или выключить лампу
+struct LampSetState {
+	static constexpr EventType kType = EventType::LampSetState;
+	bool enabled = false;
+
+	bool operator==(const LampSetState &) const = default;
+};
+
+} // namespace Events
+
+/// \brief Нагрузка события любого типа, индекс альтернативы совпадает с EventType
+/// Лежит прямо в ячейке очереди, поэтому отправка не выделяет память. Новому типу нужны значение
+/// в EventType, структура в Events с kType и operator== (по нему отбрасываются повторы)
+using EventPayload = std::variant<Events::PumpSetState, Events::LampSetState>;
+
+inline constexpr size_t kEventTypes = std::variant_size_v<EventPayload>;
+
+static_assert([]<size_t... I>(std::index_sequence<I...>) {
+	return ((std::variant_alternative_t<I, EventPayload>::kType == static_cast<EventType>(I)) && ...);
+}(std::make_index_sequence<kEventTypes>{}), "EventPayload alternatives must follow EventType order");
+
+constexpr EventType typeOf(const EventPayload &aPayload)
+{
+	return static_cast<EventType>(aPayload.index());
+}
+
+/// \brief Склеиваются ли ожидающие события этого типа по умолчанию
+/// Команды состояния несут намерение целиком, пока команда ждет в очереди, важно только последнее
+constexpr bool coalescedByDefault(EventType aEv)
+{
+	switch (aEv) {
+		case EventType::PumpSetState:
+		case EventType::LampSetState:
+			return true;
+	}
+	return false;
+}
+
+/// \brief Событие, как его видят наблюдатели
+struct BusEvent {
+	EventPayload payload;
+	uint32_t target = 0;                            // Адресат команды
+	std::chrono::steady_clock::time_point enqueued; // Когда событие попало в очередь
+
+	EventType type() const
+	{
+		return typeOf(payload);
+	}
+
+	/// \return нагрузку, если событие этого типа, иначе nullptr
+	template<typename E>
+	const E *as() const
+	{
+		return std::get_if<E>(&payload);
+	}
+};
+
 class EventBusObserver {
 public:
-	virtual void handleEvent(EventType aEv, std::any &aValue) = 0;
+	virtual void handleEvent(const BusEvent &aEvent) = 0;
+};
+
+/// \brief Класс приоритета события, у каждого класса своя очередь
+/// Диспетчер всегда берет событие из самого приоритетного непустого класса, поэтому поток
+/// рутинных событий не задерживает команды безопасности и не вытесняет их при переполнении
+enum class EventPriority : uint8_t {
+	Safety,  // Аварийные команды (выключение насоса), обгоняют все остальное
+	Command, // Обычные команды исполнительным устройствам
+	Routine, // Калибровка, OTA, рассылка конфигурации
+};
+
+inline constexpr size_t kEventPriorities = 3;
+
+/// \brief Класс приоритета события по умолчанию, если отправитель не указал свой
+constexpr EventPriority defaultPriority(EventType aEv)
+{
+	switch (aEv) {
+		case EventType::PumpSetState:
+		case EventType::LampSetState:
+			return EventPriority::Command;
+	}
+	return EventPriority::Routine;
+}
+
+/// \brief Что делать с событием, если очередь заполнена
+enum class EventOverflow {
+	Drop,  // sendEvent возвращает false, событие считается в dropped. Отправитель не ждет никогда
+	Block, // Отправитель ждет, пока диспетчер освободит место
+};
+
+/// \brief Метрики одного класса приоритета
+struct EventLaneStats {
+	uint64_t sent = 0;
+	uint64_t dispatched = 0;
+	uint64_t dropped = 0;
+	uint64_t superseded = 0; // Метки склеенных событий, переставленные в более приоритетный класс
+	size_t depth = 0;
+	LatencyHistogram::Snapshot latency; // От постановки в очередь до рассылки
+};
+
+/// \brief Метрики шины, общие счетчики - суммы по классам
+struct EventBusStats {
+	uint64_t sent = 0;       // Принято в очередь
+	uint64_t dispatched = 0; // Разослано наблюдателям
+	uint64_t dropped = 0;    // Отброшено при переполнении или после остановки
+	uint64_t coalesced = 0;    // Заменили значение ожидающего события того же типа и адресата
+	uint64_t deduplicated = 0; // Совпали с ожидающим событием и отброшены
+	uint64_t lastLatencyUs = 0; // От постановки в очередь до рассылки
+	uint64_t maxLatencyUs = 0;
+	size_t depth = 0;
+	std::array<EventLaneStats, kEventPriorities> lanes;
+
+	const EventLaneStats &lane(EventPriority aPriority) const
+	{
+		return lanes[static_cast<size_t>(aPriority)];
+	}
 };
 
 /// \brief Шина событий для коммуникации подсистем
+/// Отправители (потоки насоса, лампы, REST) кладут событие в ограниченную MPSC очередь своего класса
+/// приоритета без блокировок, один поток диспетчера разбирает очереди строго по приоритету и рассылает
+/// наблюдателям, внутри класса - в порядке поступления. Рассылка не прерывается, поэтому задержка
+/// события Safety ограничена одной текущей рассылкой и событиями Safety перед ним.
+/// События склеиваемых типов держат не больше одного ожидающего значения на пару (тип, адресат):
+/// в очереди лежит только метка, новое значение заменяет ожидающее, а совпадающее отбрасывается.
+/// Повтор после рассылки снова уходит, контроллеры так повторяют потерянные радиокоманды.
+/// Наблюдатели подписываются на типы событий, рассылка идет только подписчикам типа.
+/// Пустая очередь не опрашивается: диспетчер спит на atomic::wait (futex), отправитель будит его
+/// только если он действительно уснул
 class EventBus {
+	using Clock = std::chrono::steady_clock;
+
 public:
-	void sendEvent(EventType aEv, std::any aValue)
+	/// \param aCapacity емкость очереди каждого класса, округляется до степени двойки
+	/// \param aOverflow политика переполнения. По умолчанию Drop: контроллеры повторяют команды сами
+	/// (см. validTime насоса), а ждать зависшее радио в их потоках нельзя
+	explicit EventBus(size_t aCapacity = 64, EventOverflow aOverflow = EventOverflow::Drop) :
+		lanes{Lane{aCapacity}, Lane{aCapacity}, Lane{aCapacity}},
+		overflow{aOverflow}
+	{
+		for (size_t i = 0; i < kEventTypes; ++i) {
+			coalescing[i].store(coalescedByDefault(static_cast<EventType>(i)), std::memory_order_relaxed);
+			observers[i] = std::make_shared<std::vector<EventBusObserver *>>();
+		}
+	}
+
+	EventBus(const EventBus &) = delete;
+	EventBus &operator=(const EventBus &) = delete;
+
+	~EventBus()
 	{
-		queue.push(std::make_pair(aEv, aValue));
+		stop();
+	}
+
+	/// \brief Отправить событие, из любого потока
+	/// До start события копятся в очереди, после stop не принимаются
+	/// \return true если событие принято в очередь, склеено или совпало с ожидающим
+	bool sendEvent(const EventPayload &aPayload)
+	{
+		return sendEvent(aPayload, defaultPriority(typeOf(aPayload)));
+	}
+
+	/// \brief Отправить событие с явным классом приоритета
+	/// \param aTarget адресат команды, склеиваются только события одного адресата
+	bool sendEvent(const EventPayload &aPayload, EventPriority aPriority, uint32_t aTarget = 0)
+	{
+		const BusEvent event{aPayload, aTarget, Clock::now()};
+
+		if (coalescing[aPayload.index()].load(std::memory_order_relaxed)) {
+			return sendCoalesced(event, aPriority);
+		}
+		return sendQueued(event, aPriority);
 	}
 
+	/// \brief Включить или выключить склейку событий типа, лучше до start
+	void setCoalescing(EventType aEv, bool aEnabled)
+	{
+		coalescing[static_cast<size_t>(aEv)].store(aEnabled, std::memory_order_relaxed);
+	}
+
+	/// \brief Запустить поток диспетчера
 	void start()
 	{
+		std::lock_guard lock(mutex);
+		if (thread.joinable()) {
+			return;
+		}
+		stopping.store(false, std::memory_order_release);
 		thread = std::thread(&EventBus::threadFunction, this);
-		thread.detach();
 	}
 
-	void registerObserver(EventBusObserver *aObs)
+	/// \brief Остановить диспетчер, недоставленные события отбрасываются
+	void stop()
+	{
+		std::lock_guard lock(mutex);
+		if (!thread.joinable()) {
+			return;
+		}
+
+		stopping.store(true, std::memory_order_release);
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		signal.notify_one();
+		space.fetch_add(1, std::memory_order_release);
+		space.notify_all();
+		thread.join();
+	}
+
+	/// \brief Подписать наблюдателя на события типа, можно и после start
+	void registerObserver(EventType aEv, EventBusObserver *aObs)
 	{
-		observers.push_back(aObs);
+		std::lock_guard lock(observersMutex);
+		auto &list = observers[static_cast<size_t>(aEv)];
+		auto updated = std::make_shared<std::vector<EventBusObserver *>>(*list);
+		updated->push_back(aObs);
+		list = std::move(updated);
+	}
+
+	EventBusStats stats() const
+	{
+		EventBusStats result;
+		for (size_t i = 0; i < kEventPriorities; ++i) {
+			const Lane &lane = lanes[i];
+			EventLaneStats &out = result.lanes[i];
+			out.sent = lane.sent.load(std::memory_order_relaxed);
+			out.dispatched = lane.dispatched.load(std::memory_order_relaxed);
+			out.dropped = lane.dropped.load(std::memory_order_relaxed);
+			out.superseded = lane.superseded.load(std::memory_order_relaxed);
+			out.depth = lane.queue.size();
+			out.latency = lane.latency.snapshot();
+
+			result.sent += out.sent;
+			result.dispatched += out.dispatched;
+			result.dropped += out.dropped;
+			result.depth += out.depth;
+		}
+		result.coalesced = coalesced.load(std::memory_order_relaxed);
+		result.deduplicated = deduplicated.load(std::memory_order_relaxed);
+		result.lastLatencyUs = lastLatencyUs.load(std::memory_order_relaxed);
+		result.maxLatencyUs = maxLatencyUs.load(std::memory_order_relaxed);
+		return result;
 	}
 
 private:
+	/// \brief Ожидающее значение склеиваемого события, в очереди лежит метка на него
+	struct Pending {
+		EventPayload value;
+		uint64_t generation = 0; // Номер действующей метки, остальные метки устарели
+		EventPriority priority{};
+		bool queued = false;
+	};
+
+	struct Event {
+		BusEvent event;
+		Pending *pending = nullptr; // Метка склеиваемого события, актуальная нагрузка лежит в Pending
+		uint64_t generation = 0;
+	};
+
+	/// \brief Очередь и счетчики одного класса приоритета
+	struct Lane {
+		explicit Lane(size_t aCapacity) : queue{aCapacity}
+		{
+		}
+
+		MpscQueue<Event> queue;
+		std::atomic<uint64_t> sent{0};
+		std::atomic<uint64_t> dispatched{0};
+		std::atomic<uint64_t> dropped{0};
+		std::atomic<uint64_t> superseded{0};
+		LatencyHistogram latency;
+	};
+
+	static_assert(kEventPriorities == 3, "Update lanes initialization in EventBus constructor");
+
+	std::array<Lane, kEventPriorities> lanes;
+	const EventOverflow overflow;
+
+	std::mutex mutex; // start/stop
 	std::thread thread;
+	std::mutex observersMutex; // Список copy-on-write, диспетчер держит мьютекс только на копирование указателя
+	std::array<std::shared_ptr<const std::vector<EventBusObserver *>>, kEventTypes> observers;
+
+	std::array<std::atomic<bool>, kEventTypes> coalescing;
+	std::mutex pendingMutex; // Ожидающие значения, отправитель и диспетчер держат его только на замену
+	std::unordered_map<uint64_t, Pending> pending; // Ключ - тип и адресат, узлы не переезжают
+
+	std::atomic<bool> stopping{false};
+	std::atomic<uint32_t> signal{0};  // Растет на каждое событие, на нем спит диспетчер
+	std::atomic<bool> sleeping{false};
+	std::atomic<uint32_t> space{0};   // Растет на каждое извлечение, на нем ждут отправители в режиме Block
+	std::atomic<uint32_t> blockedSenders{0};
+
+	std::atomic<uint64_t> coalesced{0};
+	std::atomic<uint64_t> deduplicated{0};
+	std::atomic<uint64_t> lastLatencyUs{0};
+	std::atomic<uint64_t> maxLatencyUs{0};
+
+	/// \brief Поставить событие в очередь как есть
+	bool sendQueued(const BusEvent &aEvent, EventPriority aPriority)
+	{
+		Lane &lane = lanes[static_cast<size_t>(aPriority)];
+
+		if (stopping.load(std::memory_order_acquire)) {
+			lane.dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		while (!lane.queue.tryPush(Event{aEvent})) {
+			if (overflow == EventOverflow::Drop || stopping.load(std::memory_order_acquire)) {
+				lane.dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			// Ждем, пока диспетчер заберет хоть одно событие
+			const uint32_t freed = space.load(std::memory_order_acquire);
+			blockedSenders.fetch_add(1, std::memory_order_seq_cst);
+			if (!lane.queue.tryPush(Event{aEvent})) {
+				space.wait(freed, std::memory_order_acquire);
+				blockedSenders.fetch_sub(1, std::memory_order_relaxed);
+				continue;
+			}
+			blockedSenders.fetch_sub(1, std::memory_order_relaxed);
+			break;
+		}
+
+		lane.sent.fetch_add(1, std::memory_order_relaxed);
+		wake();
+		return true;
+	}
+
+	/// \brief Склеить событие с ожидающим того же типа и адресата или поставить метку в очередь
+	bool sendCoalesced(const BusEvent &aEvent, EventPriority aPriority)
+	{
+		Lane &lane = lanes[static_cast<size_t>(aPriority)];
+		const uint64_t key = (static_cast<uint64_t>(aEvent.payload.index()) << 32) | aEvent.target;
+
+		while (true) {
+			if (stopping.load(std::memory_order_acquire)) {
+				lane.dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			const uint32_t freed = space.load(std::memory_order_acquire);
+			{
+				std::lock_guard lock(pendingMutex);
+				Pending &slot = pending[key];
+
+				if (slot.queued) {
+					const bool urgent = aPriority < slot.priority;
+					if (!urgent && slot.value == aEvent.payload) {
+						deduplicated.fetch_add(1, std::memory_order_relaxed);
+						return true;
+					}
+
+					slot.value = aEvent.payload;
+					coalesced.fetch_add(1, std::memory_order_relaxed);
+
+					// Более срочное значение не ждет в старом классе: новая метка, старая устареет.
+					// Если класс полон, значение уйдет по старой метке
+					if (urgent && lane.queue.tryPush(Event{aEvent, &slot, slot.generation + 1})) {
+						++slot.generation;
+						slot.priority = aPriority;
+						lane.sent.fetch_add(1, std::memory_order_relaxed);
+						wake();
+					}
+					return true;
+				}
+
+				if (lane.queue.tryPush(Event{aEvent, &slot, slot.generation + 1})) {
+					slot.value = aEvent.payload;
+					slot.priority = aPriority;
+					slot.queued = true;
+					++slot.generation;
+					lane.sent.fetch_add(1, std::memory_order_relaxed);
+					wake();
+					return true;
+				}
+			}
+
+			if (overflow == EventOverflow::Drop) {
+				lane.dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			// freed прочитан до попытки, поэтому извлечение после нее не будет пропущено
+			blockedSenders.fetch_add(1, std::memory_order_seq_cst);
+			space.wait(freed, std::memory_order_acquire);
+			blockedSenders.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	/// \brief Разбудить диспетчер, если он спит
+	void wake()
+	{
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_seq_cst)) {
+			signal.notify_one();
+		}
+	}
 
-	std::vector<EventBusObserver *> observers;
-	std::queue<std::pair<EventType, std::any>> queue;
+	/// \brief Забрать значение склеиваемого события по метке
+	/// \return false если метка устарела
+	bool claim(Event &aEvent)
+	{
+		if (!aEvent.pending) {
+			return true;
+		}
+
+		std::lock_guard lock(pendingMutex);
+		Pending &slot = *aEvent.pending;
+		if (!slot.queued || slot.generation != aEvent.generation) {
+			return false;
+		}
+
+		aEvent.event.payload = slot.value;
+		slot.queued = false;
+		return true;
+	}
 
 	void threadFunction()
 	{
-		if (!queue.empty()) {
-			auto event = queue.front();
-			queue.pop();
+		Event event;
+
+		while (true) {
+			const uint32_t seen = signal.load(std::memory_order_seq_cst);
 
-			for (auto &pos : observers) {
-				pos->handleEvent(event.first, event.second);
+			if (Lane *lane = popNext(event)) {
+				released();
+				if (claim(event)) {
+					dispatch(*lane, event);
+				} else {
+					lane->superseded.fetch_add(1, std::memory_order_relaxed);
+				}
+				continue;
 			}
+
+			if (stopping.load(std::memory_order_acquire)) {
+				break;
+			}
+
+			// Отправитель увеличивает signal после вставки, поэтому событие, не увиденное popNext,
+			// либо изменит signal до wait, либо застанет sleeping и разбудит
+			sleeping.store(true, std::memory_order_seq_cst);
+			signal.wait(seen, std::memory_order_seq_cst);
+			sleeping.store(false, std::memory_order_relaxed);
 		}
+
+		// Остаток после остановки не доставляется
+		while (Lane *lane = popNext(event)) {
+			released();
+			if (claim(event)) {
+				lane->dropped.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				lane->superseded.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// \brief Извлечь событие из самого приоритетного непустого класса
+	/// \return класс, из которого извлечено событие, nullptr если все пусты
+	Lane *popNext(Event &aEvent)
+	{
+		for (auto &lane : lanes) {
+			if (lane.queue.tryPop(aEvent)) {
+				return &lane;
+			}
+		}
+		return nullptr;
+	}
+
+	/// \brief Место в очереди освободилось, разбудить ждущих отправителей
+	void released()
+	{
+		space.fetch_add(1, std::memory_order_seq_cst);
+		if (blockedSenders.load(std::memory_order_seq_cst)) {
+			space.notify_all();
+		}
+	}
+
+	void dispatch(Lane &aLane, Event &aEvent)
+	{
+		const BusEvent &event = aEvent.event;
+		const auto waited = Clock::now() - event.enqueued;
+		aLane.latency.record(waited);
+
+		const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(waited);
+		const auto latencyUs = static_cast<uint64_t>(latency.count());
+		lastLatencyUs.store(latencyUs, std::memory_order_relaxed);
+		if (latencyUs > maxLatencyUs.load(std::memory_order_relaxed)) {
+			maxLatencyUs.store(latencyUs, std::memory_order_relaxed);
+		}
+
+		std::shared_ptr<const std::vector<EventBusObserver *>> current;
+		{
+			std::lock_guard lock(observersMutex);
+			current = observers[event.payload.index()];
+		}
+
+		for (auto *observer : *current) {
+			try {
+				observer->handleEvent(event);
+			} catch (const std::exception &e) {
+				HYDRO_LOG_ERROR("EventBus: observer failed on event " + std::to_string(event.payload.index()) + ": " + e.what());
+			}
+		}
+
+		aLane.dispatched.fetch_add(1, std::memory_order_relaxed);
 	}
 };
@@ -1,42 +1,88 @@
 #pragma once
 
 #include "core/InterfaceList.hpp"
-#include <any>
+#include <cctype>
+#include <regex>
 #include <string>
+#include <variant>
 
 class MacFieldValidator : public AbstractValidator {
 public:
 	// AbstractValidator interface
-	bool isDataCorrect(const std::any &aValue) const override
+	bool isDataCorrect(const BbValue &aValue) const override
 	{
-		try {
-			const std::string value = std::any_cast<std::string>(aValue);
+		const std::string *value = std::get_if<std::string>(&aValue);
+		if (!value) {
+			return false;
+		}
 
-			if (value.size() != 17) {
-				return false;
-			}
+		if (value->size() != 17) {
+			return false;
+		}
 
-			size_t colonCount = 0;
+		size_t colonCount = 0;
 
-			for (size_t i = 0; i < value.size(); ++i) {
-				if (value[i] == ':') {
-					++colonCount;
+		for (size_t i = 0; i < value->size(); ++i) {
+			if ((*value)[i] == ':') {
+				++colonCount;
 
-					if ((i % 3) != 2) {
-						return false;
-					}
+				if ((i % 3) != 2) {
+					return false;
 				}
-				else {
-					if (!std::isxdigit(static_cast<unsigned char>(value[i]))) {
-						return false;
-					}
+			}
+			else {
+				if (!std::isxdigit(static_cast<unsigned char>((*value)[i]))) {
+					return false;
 				}
 			}
+		}
 
-			return colonCount == 5;
+		return colonCount == 5;
+	}
+};
+
+/// \brief Проверка попадания значения в диапазон [min, max]
+template<typename T>
+class RangeValidator : public AbstractValidator {
+public:
+	RangeValidator(T aMin, T aMax) : min{aMin}, max{aMax}
+	{
+	}
+
+	// AbstractValidator interface
+	bool isDataCorrect(const BbValue &aValue) const override
+	{
+		const T *value = std::get_if<T>(&aValue);
+		if (!value) {
+			return false;
 		}
-		catch (...) {
+
+		return !(*value < min) && !(max < *value);
+	}
+
+private:
+	T min;
+	T max;
+};
+
+/// \brief Проверка строки регулярным выражением, строка должна совпасть целиком
+class RegexValidator : public AbstractValidator {
+public:
+	explicit RegexValidator(const std::string &aPattern) : pattern{aPattern, std::regex::ECMAScript | std::regex::optimize}
+	{
+	}
+
+	// AbstractValidator interface
+	bool isDataCorrect(const BbValue &aValue) const override
+	{
+		const std::string *value = std::get_if<std::string>(&aValue);
+		if (!value) {
 			return false;
 		}
+
+		return std::regex_match(*value, pattern);
 	}
+
+private:
+	std::regex pattern;
 };
@@ -0,0 +1,128 @@
+/*!
+@file
+@brief Кольцо последних отсчетов записи для графиков без обращения к БД
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \brief Отсчет истории
+struct HistorySample {
+	int64_t timestampMs; // Unix время, мс
+	double value;
+};
+
+/// \brief Кольцо отсчетов фиксированной емкости
+/// Писатель один (у BB он сериализован эксклюзивным захватом), читатели не блокируют ни его,
+/// ни друг друга. Отсчеты лежат в atomic полях, перезапись во время чтения обнаруживается
+/// по счетчику резерва, как в SeqLockCell, и такие отсчеты просто отбрасываются
+class HistoryRing {
+public:
+	using Clock = std::chrono::system_clock;
+
+	/// \param aCapacity емкость, округляется вверх до степени двойки
+	explicit HistoryRing(size_t aCapacity) :
+		cells(std::bit_ceil(std::max<size_t>(aCapacity, 1))),
+		mask{cells.size() - 1},
+		createdMs{nowMs()}
+	{
+	}
+
+	HistoryRing(const HistoryRing &) = delete;
+	HistoryRing &operator=(const HistoryRing &) = delete;
+
+	static int64_t nowMs()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	size_t capacity() const
+	{
+		return cells.size();
+	}
+
+	/// \brief Добавить отсчет, вызывается только одним писателем одновременно
+	void push(int64_t aTimestampMs, double aValue)
+	{
+		const uint64_t current = head.load(std::memory_order_relaxed);
+
+		// Сначала объявляем, какую ячейку трогаем, читатель по этому счетчику отбросит ее
+		reserved.store(current + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Cell &cell = cells[current & mask];
+		cell.timestampMs.store(aTimestampMs, std::memory_order_relaxed);
+		cell.value.store(aValue, std::memory_order_relaxed);
+
+		head.store(current + 1, std::memory_order_release);
+	}
+
+	/// \brief Отсчеты в интервале [aFromMs, aToMs] по возрастанию времени
+	/// \param aOut куда добавить
+	/// \param aLimit не больше стольких последних отсчетов
+	void read(int64_t aFromMs, int64_t aToMs, std::vector<HistorySample> &aOut, size_t aLimit = SIZE_MAX) const
+	{
+		const uint64_t end = head.load(std::memory_order_acquire);
+		const uint64_t begin = end > cells.size() ? end - cells.size() : 0;
+
+		std::vector<HistorySample> copy;
+		copy.reserve(end - begin);
+		for (uint64_t i = begin; i < end; ++i) {
+			const Cell &cell = cells[i & mask];
+			copy.push_back(HistorySample{cell.timestampMs.load(std::memory_order_relaxed),
+				cell.value.load(std::memory_order_relaxed)});
+		}
+
+		// Отсчеты, которые писатель мог перезаписать пока мы копировали, выбрасываем
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t touched = reserved.load(std::memory_order_relaxed);
+		const uint64_t firstValid = touched > cells.size() ? touched - cells.size() : 0;
+		const size_t skip = firstValid > begin ? static_cast<size_t>(std::min<uint64_t>(firstValid - begin, copy.size())) : 0;
+
+		auto first = std::lower_bound(copy.begin() + static_cast<std::ptrdiff_t>(skip), copy.end(), aFromMs,
+			[](const HistorySample &s, int64_t ts) { return s.timestampMs < ts; });
+		auto last = std::upper_bound(first, copy.end(), aToMs,
+			[](int64_t ts, const HistorySample &s) { return ts < s.timestampMs; });
+
+		if (static_cast<size_t>(last - first) > aLimit) {
+			first = last - static_cast<std::ptrdiff_t>(aLimit);
+		}
+		aOut.insert(aOut.end(), first, last);
+	}
+
+	/// \brief С какого момента кольцо хранит полную историю
+	/// Пока кольцо не заполнилось - с момента создания, потом - с самого старого отсчета
+	int64_t coveredFromMs() const
+	{
+		const uint64_t end = head.load(std::memory_order_acquire);
+		if (end < cells.size()) {
+			return createdMs;
+		}
+
+		// Самый старый отсчет может быть перезаписан прямо сейчас, следующий за ним - нет
+		return cells[(end + 1) & mask].timestampMs.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Cell {
+		std::atomic<int64_t> timestampMs{0};
+		std::atomic<double> value{0.0};
+	};
+
+	std::vector<Cell> cells;
+	const size_t mask;
+	const int64_t createdMs;
+
+	std::atomic<uint64_t> head{0};     // Сколько отсчетов опубликовано
+	std::atomic<uint64_t> reserved{0}; // Номер отсчета, который пишется или уже записан
+};
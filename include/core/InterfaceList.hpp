@@ -1,6 +1,7 @@
 #pragma once
 
-#include <any>
+#include "core/BlackboardValue.hpp"
+
 #include <cstddef>
 #include <cstdint>
 
@@ -17,5 +18,6 @@ public:
 
 class AbstractValidator {
 public:
-	virtual bool isDataCorrect(const std::any &aValue) const = 0;
+	virtual ~AbstractValidator() = default;
+	virtual bool isDataCorrect(const BbValue &aValue) const = 0;
 };
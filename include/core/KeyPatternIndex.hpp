@@ -0,0 +1,192 @@
+/*!
+@file
+@brief Скомпилированный индекс подписок Blackboard по префиксам и сегментам
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace KeyPattern {
+
+/*
+ * Семантика шаблонов:
+ * 1) Префикс - имя начинается с шаблона, посимвольно. "pump.config" совпадет с "pump.config.onTime"
+ *    и с "pump.configX", поэтому для точного совпадения по сегментам заканчивайте префикс точкой
+ * 2) Сегмент - одна компонента имени между точками. "telem" совпадет с "pump.telem.value",
+ *    но не с "pump.telemetry.value". Точки по краям игнорируются, ".telem" == "telem"
+ * 3) Маска - имя целиком по сегментам, "*" заменяет ровно один сегмент.
+ *    "*.telem.status" совпадет с "pump.telem.status" и "lamp.telem.status", но не с "pump.telem.status.raw"
+ */
+
+/// \brief Убрать точки по краям сегмента
+static inline std::string_view normalizeSegment(std::string_view aSegment)
+{
+	while (!aSegment.empty() && aSegment.front() == '.') {
+		aSegment.remove_prefix(1);
+	}
+	while (!aSegment.empty() && aSegment.back() == '.') {
+		aSegment.remove_suffix(1);
+	}
+	return aSegment;
+}
+
+/// \brief Пройти по всем сегментам имени
+/// \param aKey имя
+/// \param aCallback вызывается для каждого сегмента
+template<typename F>
+void forEachSegment(std::string_view aKey, F &&aCallback)
+{
+	size_t begin = 0;
+	while (begin <= aKey.size()) {
+		size_t end = aKey.find('.', begin);
+		if (end == std::string_view::npos) {
+			end = aKey.size();
+		}
+		if (end > begin) {
+			aCallback(aKey.substr(begin, end - begin));
+		}
+		begin = end + 1;
+	}
+}
+
+/// \brief Есть ли в имени сегмент
+static inline bool hasSegment(std::string_view aKey, std::string_view aSegment)
+{
+	bool found = false;
+	forEachSegment(aKey, [&](std::string_view aPart) { found = found || aPart == aSegment; });
+	return found;
+}
+
+/// \brief Совпадает ли имя с маской
+/// \param aKey имя
+/// \param aMask маска, "*" заменяет один сегмент
+static inline bool matchMask(std::string_view aKey, std::string_view aMask)
+{
+	while (true) {
+		const size_t keyEnd = aKey.find('.');
+		const size_t maskEnd = aMask.find('.');
+		const std::string_view keyPart = aKey.substr(0, keyEnd);
+		const std::string_view maskPart = aMask.substr(0, maskEnd);
+
+		if (maskPart != "*" && maskPart != keyPart) {
+			return false;
+		}
+		if (keyEnd == std::string_view::npos || maskEnd == std::string_view::npos) {
+			return keyEnd == maskEnd;
+		}
+
+		aKey.remove_prefix(keyEnd + 1);
+		aMask.remove_prefix(maskEnd + 1);
+	}
+}
+
+} // namespace KeyPattern
+
+/// \brief Неизменяемый индекс подписок, собирается заново при подписке или отписке
+/// Поиск подписчиков для имени стоит O(длина имени): проход по trie префиксов
+/// и по одной хеш-проверке на каждый сегмент имени.
+/// Строки шаблонов не копируются, владелец должен держать их живыми пока жив индекс
+template<typename Observer>
+class KeyPatternIndex {
+public:
+	using Observers = std::vector<Observer *>;
+
+	/// \brief Добавить подписку на префикс, только на этапе сборки
+	void addPrefix(std::string_view aPrefix, const Observers &aObservers)
+	{
+		uint32_t node = 0;
+		for (char c : aPrefix) {
+			auto &children = nodes[node].children;
+			auto it = std::lower_bound(children.begin(), children.end(), c,
+				[](const std::pair<char, uint32_t> &aChild, char aChar) { return aChild.first < aChar; });
+
+			if (it == children.end() || it->first != c) {
+				const auto next = static_cast<uint32_t>(nodes.size());
+				children.insert(it, {c, next});
+				// Ссылка children невалидна после emplace_back
+				nodes.emplace_back();
+				node = next;
+			} else {
+				node = it->second;
+			}
+		}
+
+		nodes[node].pattern = aPrefix;
+		nodes[node].observers.insert(nodes[node].observers.end(), aObservers.begin(), aObservers.end());
+	}
+
+	/// \brief Добавить подписку на сегмент, только на этапе сборки
+	void addSegment(std::string_view aSegment, const Observers &aObservers)
+	{
+		auto &observers = segments[aSegment];
+		observers.insert(observers.end(), aObservers.begin(), aObservers.end());
+	}
+
+	/// \brief Найти всех подписчиков имени
+	/// \param aKey имя
+	/// \param aCallback вызывается как aCallback(pattern, observers) для каждого совпавшего шаблона
+	template<typename F>
+	void match(std::string_view aKey, F &&aCallback) const
+	{
+		uint32_t node = 0;
+		size_t depth = 0;
+
+		while (true) {
+			const Node &current = nodes[node];
+			if (!current.observers.empty()) {
+				aCallback(current.pattern, current.observers);
+			}
+
+			if (depth == aKey.size()) {
+				break;
+			}
+
+			const char c = aKey[depth];
+			auto it = std::lower_bound(current.children.begin(), current.children.end(), c,
+				[](const std::pair<char, uint32_t> &aChild, char aChar) { return aChild.first < aChar; });
+
+			if (it == current.children.end() || it->first != c) {
+				break;
+			}
+
+			node = it->second;
+			++depth;
+		}
+
+		if (segments.empty()) {
+			return;
+		}
+
+		KeyPattern::forEachSegment(aKey, [&](std::string_view aSegment) {
+			auto it = segments.find(aSegment);
+			if (it != segments.end() && !it->second.empty()) {
+				aCallback(it->first, it->second);
+			}
+		});
+	}
+
+	/// \brief Нет ни одной подписки
+	bool empty() const
+	{
+		return nodes.size() == 1 && nodes.front().observers.empty() && segments.empty();
+	}
+
+private:
+	struct Node {
+		std::vector<std::pair<char, uint32_t>> children; // Отсортированы по символу
+		std::string_view pattern;
+		Observers observers;
+	};
+
+	std::vector<Node> nodes{1};
+	std::unordered_map<std::string_view, Observers> segments;
+};
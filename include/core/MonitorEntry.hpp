@@ -18,29 +18,29 @@ enum class MonitorFlags {
 class MonitorEntry {
 	static constexpr std::string kMonName = "DeviceFlags";
 public:
-	MonitorEntry(std::shared_ptr<Blackboard> aBb) : bb{aBb}
+	MonitorEntry(std::shared_ptr<Blackboard> aBb) : bb{aBb}, key{bb->registerKey(kMonName)}
 	{
 	}
 
 	void setFlag(MonitorFlags aFlag)
 	{
-		const uint32_t flags = bb->get<uint32_t>(kMonName).value();
+		const uint32_t flags = bb->get<uint32_t>(key).value();
 		const uint32_t newFlag = static_cast<uint32_t>(aFlag);
 		const uint32_t newFlags = flags | newFlag;
-		bb->set(kMonName, newFlags);
+		bb->set(key, newFlags);
 	}
 
 	void clearFlag(MonitorFlags aFlag)
 	{
-		const uint32_t flags = bb->get<uint32_t>(kMonName).value();
+		const uint32_t flags = bb->get<uint32_t>(key).value();
 		const uint32_t newFlag = static_cast<uint32_t>(aFlag);
 		const uint32_t newFlags = flags & ~newFlag;
-		bb->set(kMonName, newFlags);
+		bb->set(key, newFlags);
 	}
 
 	bool isFlagSet(MonitorFlags aFlag)
 	{
-		const uint32_t flags = bb->get<uint32_t>(kMonName).value();
+		const uint32_t flags = bb->get<uint32_t>(key).value();
 		return flags & static_cast<uint32_t>(aFlag);
 	}
 
@@ -51,20 +51,21 @@ public:
 
 	void subscribe(AbstractEntryObserver *aObs)
 	{
-		return bb->subscribe(kMonName, aObs);
+		return bb->subscribe(key, aObs);
 	}
 
 	void invoke()
 	{
 		uint32_t defaultValue = 0;
-		bb->set<uint32_t>(kMonName, std::move(defaultValue));
+		bb->set<uint32_t>(key, std::move(defaultValue));
 	}
 
 private:
 	std::shared_ptr<Blackboard> bb;
+	KeyId key;
 
 	bool present() const
 	{
-		return bb->has(kMonName);
+		return bb->has(key);
 	}
 };
@@ -0,0 +1,113 @@
+/*!
+@file
+@brief Ограниченная очередь без блокировок: много писателей, один читатель
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+/// \brief Ограниченная MPSC очередь на кольце ячеек с номерами (схема Вьюкова)
+/// Писатели резервируют позицию одним CAS и не ждут ни друг друга, ни читателя.
+/// Номер ячейки говорит, свободна она для позиции pos (== pos) или уже заполнена (== pos + 1),
+/// поэтому заполненность кольца видна без общего счетчика. Значения живут в ячейках,
+/// для тривиальных типов вставка и извлечение не обращаются к аллокатору
+template<typename T>
+class MpscQueue {
+public:
+	/// \param aCapacity емкость, округляется вверх до степени двойки
+	explicit MpscQueue(size_t aCapacity) :
+		capacityValue{std::bit_ceil(std::max<size_t>(aCapacity, 2))},
+		mask{capacityValue - 1},
+		cells{std::make_unique<Cell[]>(capacityValue)}
+	{
+		for (size_t i = 0; i < capacityValue; ++i) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	size_t capacity() const
+	{
+		return capacityValue;
+	}
+
+	/// \brief Положить значение, из любого потока
+	/// \return false если очередь заполнена, значение при этом не тронуто
+	template<typename U>
+	bool tryPush(U &&aValue)
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+
+		while (true) {
+			Cell &cell = cells[pos & mask];
+			const size_t seq = cell.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+			if (diff == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.value = std::forward<U>(aValue);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// Ячейку еще не освободил читатель - кольцо полное
+				return false;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// \brief Забрать значение, только из потока читателя
+	/// \return false если очередь пуста (или ближайшая ячейка еще дописывается)
+	bool tryPop(T &aOut)
+	{
+		const size_t pos = head.load(std::memory_order_relaxed);
+		Cell &cell = cells[pos & mask];
+
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+			return false;
+		}
+
+		aOut = std::move(cell.value);
+		cell.sequence.store(pos + capacityValue, std::memory_order_release);
+		head.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/// \brief Примерная глубина, для метрик
+	size_t size() const
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		const size_t t = tail.load(std::memory_order_relaxed);
+		return t > h ? std::min(t - h, capacityValue) : 0;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence{0};
+		T value{};
+	};
+
+	// Писатели и читатель трогают разные счетчики, держим их в разных линиях кеша
+	static constexpr size_t kCacheLine = 64;
+
+	const size_t capacityValue;
+	const size_t mask;
+	std::unique_ptr<Cell[]> cells;
+	alignas(kCacheLine) std::atomic<size_t> tail{0};
+	alignas(kCacheLine) std::atomic<size_t> head{0};
+};
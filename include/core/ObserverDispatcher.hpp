@@ -0,0 +1,885 @@
+/*!
+@file
+@brief Асинхронная доставка оповещений Blackboard
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/BlackboardObservers.hpp"
+#include "core/BlackboardStats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// \brief Способ доставки оповещений подписчику
+enum class Delivery {
+	Inline, // В потоке писателя, сразу после записи
+	Async,  // В пуле диспетчера, писатель не ждет подписчика
+};
+
+/// \brief Параметры подписки на BB
+struct SubscribeOptions {
+	Delivery delivery = Delivery::Inline;
+	size_t queueCapacity = 256; // Только для Async, при переполнении отбрасываются самые старые оповещения
+	// Не чаще одной доставки за интервал, промежуточные значения записи схлопываются до последнего.
+	// Ненулевой интервал включает асинхронную доставку, queueCapacity при этом не используется
+	std::chrono::milliseconds minInterval{0};
+
+	bool isAsync() const
+	{
+		return delivery == Delivery::Async || minInterval.count() > 0;
+	}
+};
+
+/// \brief Метрики асинхронной доставки
+struct DispatchStats {
+	uint64_t delivered = 0;
+	uint64_t dropped = 0;  // Отброшено при переполнении очереди
+	uint64_t coalesced = 0; // Значения, замененные более свежими до доставки
+	uint64_t lastLagUs = 0; // Задержка между записью и вызовом подписчика
+	uint64_t maxLagUs = 0;
+	size_t queued = 0;
+};
+
+/// \brief Диспетчер асинхронных подписчиков BB
+/// Каждая асинхронная подписка получает почтовый ящик - ограниченную очередь оповещений. Подписки
+/// одного подписчика с одинаковыми параметрами делят ящик, с разными - получают отдельные ящики.
+/// BB подписывает вместо него прокси, который только кладет оповещение в ящик, поэтому писатель
+/// (например поток радио) никогда не ждет диск или сеть. Ящики разбираются пулом потоков,
+/// ящик одновременно обрабатывается только одним потоком, так что порядок оповещений
+/// внутри ящика сохраняется.
+///
+/// Подписчик с ограничением частоты вместо очереди держит по одному последнему значению на пару
+/// (шаблон, запись): запись стоит O(1) и только заменяет значение. Накопленное доставляется
+/// одним пакетом не чаще раза в minInterval, досрочный сброс делает таймер пула.
+///
+/// В очереди хранятся string_view на имена записей и шаблоны подписок: BB держит их до конца своей жизни
+class ObserverDispatcher {
+	using Clock = std::chrono::steady_clock;
+
+	struct Notification {
+		std::string_view prefix; // Пусто для подписки на запись
+		std::string_view entry;
+		BbHeldValue value; // Строки и структуры - общий буфер изменения, один на все ящики
+		uint64_t seq = 0;
+		bool removed = false;
+
+		static Notification of(const BbChange &aChange)
+		{
+			return Notification{aChange.prefix, aChange.entry,
+				aChange.shared ? BbHeldValue{*aChange.shared} : BbHeldValue{*aChange.value}, aChange.seq, aChange.removed};
+		}
+
+		BbChange change() const
+		{
+			return BbChange{prefix, entry, &value.get(), seq, value.handle() ? &value.handle() : nullptr, removed};
+		}
+	};
+
+	struct Item {
+		enum class Kind { Entry, Prefix, Batch } kind = Kind::Entry;
+		Notification single;
+		std::vector<Notification> batch;
+		Clock::time_point enqueued;
+	};
+
+	/// \brief Ключ схлопывания: указатели на шаблон и имя записи, обе строки живут в BB
+	struct PendingKey {
+		const char *prefix;
+		const char *entry;
+
+		bool operator==(const PendingKey &aOther) const = default;
+	};
+
+	struct PendingKeyHash {
+		size_t operator()(const PendingKey &aKey) const
+		{
+			const size_t a = std::hash<const void *>{}(aKey.prefix);
+			const size_t b = std::hash<const void *>{}(aKey.entry);
+			return a ^ (b + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2));
+		}
+	};
+
+	/// \brief Подписчики, которым ящик доставляет оповещения
+	struct Targets {
+		AbstractEntryObserver *entry = nullptr;
+		AbstractPrefixObserver *prefix = nullptr;
+	};
+
+	/// \brief Почтовый ящик подписчика, он же прокси, подписываемый в BB
+	class Mailbox : public AbstractEntryObserver, public AbstractPrefixObserver {
+	public:
+		Mailbox(ObserverDispatcher &aOwner, const SubscribeOptions &aOptions) :
+			owner{aOwner},
+			ring(aOptions.minInterval.count() > 0 ? 1 : std::max<size_t>(aOptions.queueCapacity, 1)),
+			minInterval{aOptions.minInterval}
+		{
+		}
+
+		// Поля пула, защищены мьютексом пула
+		size_t pins = 0;       // Сколько потоков пула сейчас держат ящик
+		bool retiring = false; // Ящик освобожден, в запас уйдет после последнего потока
+
+		/// \brief Подходит ли ящик подписке с такими параметрами
+		bool serves(const SubscribeOptions &aOptions) const
+		{
+			return minInterval == aOptions.minInterval
+				&& (isCoalescing() || ring.size() == std::max<size_t>(aOptions.queueCapacity, 1));
+		}
+
+		void attach(AbstractEntryObserver *aObserver)
+		{
+			std::lock_guard lock(mutex);
+			targets.entry = aObserver;
+		}
+
+		void attach(AbstractPrefixObserver *aObserver)
+		{
+			std::lock_guard lock(mutex);
+			targets.prefix = aObserver;
+		}
+
+		/// \brief Отвязать подписчика, вызывается после quiesce
+		/// \return true если ящик больше никому не нужен, очередь при этом очищается
+		template<typename Observer>
+		bool detach(Observer *)
+		{
+			std::lock_guard lock(mutex);
+			if constexpr (std::is_same_v<Observer, AbstractEntryObserver>) {
+				targets.entry = nullptr;
+			} else {
+				targets.prefix = nullptr;
+			}
+			if (targets.entry || targets.prefix) {
+				return false;
+			}
+
+			// Запоздавший писатель со старым снимком подписок мог успеть положить оповещение
+			for (; count; --count, head = (head + 1) % ring.size()) {
+				ring[head] = Item{};
+			}
+			head = 0;
+			pending.clear();
+			pendingIndex.clear();
+			flushRequested = false;
+			scheduled = false;
+			idle.notify_all();
+			return true;
+		}
+
+		// AbstractEntryObserver interface
+		void onEntryUpdated(std::string_view aEntry, const BbValue &aValue) override
+		{
+			enqueueEntry(Notification{{}, aEntry, BbHeldValue{aValue}});
+		}
+
+		void onEntryShared(std::string_view aEntry, const BbShared &aValue) override
+		{
+			enqueueEntry(Notification{{}, aEntry, BbHeldValue{aValue}});
+		}
+
+		// AbstractPrefixObserver interface
+		void onPrefixUpdated(std::string_view aPrefix, std::string_view aEntry, const BbValue &aValue) override
+		{
+			onPrefixChanged(BbChange{aPrefix, aEntry, &aValue});
+		}
+
+		void onPrefixChanged(const BbChange &aChange) override
+		{
+			if (isCoalescing()) {
+				std::lock_guard lock(mutex);
+				if (!targets.prefix) {
+					return;
+				}
+				coalesce(Notification::of(aChange));
+				return;
+			}
+			push(Item{Item::Kind::Prefix, Notification::of(aChange), {}, Clock::now()});
+		}
+
+		void onPrefixBatchUpdated(const std::vector<BbChange> &aChanges) override
+		{
+			if (isCoalescing()) {
+				std::lock_guard lock(mutex);
+				if (!targets.prefix) {
+					return;
+				}
+				for (const auto &change : aChanges) {
+					coalesce(Notification::of(change));
+				}
+				return;
+			}
+
+			Item item{Item::Kind::Batch, {}, {}, Clock::now()};
+			item.batch.reserve(aChanges.size());
+			for (const auto &change : aChanges) {
+				item.batch.push_back(Notification::of(change));
+			}
+			push(std::move(item));
+		}
+
+		/// \brief Разобрать часть очереди, вызывается потоком пула
+		/// \return true если в ящике еще остались оповещения
+		bool drain(size_t aLimit)
+		{
+			if (isCoalescing()) {
+				flush();
+				return false;
+			}
+
+			for (size_t i = 0; i < aLimit; ++i) {
+				Item item;
+				Targets to;
+				{
+					std::lock_guard lock(mutex);
+					if (count == 0) {
+						scheduled = false;
+						idle.notify_all();
+						return false;
+					}
+
+					item = std::move(ring[head]);
+					head = (head + 1) % ring.size();
+					--count;
+					to = targets;
+					inFlight = item.kind == Item::Kind::Batch ? oldestOf(item.batch) : item.single.seq;
+				}
+
+				const auto lag = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - item.enqueued);
+				deliver(item, to);
+
+				std::lock_guard lock(mutex);
+				inFlight = 0;
+				++stats.delivered;
+				stats.lastLagUs = static_cast<uint64_t>(lag.count());
+				stats.maxLagUs = std::max(stats.maxLagUs, stats.lastLagUs);
+			}
+
+			return true;
+		}
+
+		/// \brief Дождаться, пока очередь ящика опустеет
+		void quiesce()
+		{
+			// Подписчик отписывается из собственного обработчика - ждать самого себя нельзя
+			if (current == this) {
+				return;
+			}
+
+			std::unique_lock lock(mutex);
+			if (isCoalescing() && scheduled && !pending.empty() && !flushRequested) {
+				// Не ждем конца интервала, накопленное уходит подписчику сразу
+				flushRequested = true;
+				lock.unlock();
+				owner.schedule(this);
+				lock.lock();
+			}
+			idle.wait(lock, [this]() { return !scheduled || aborted; });
+		}
+
+		/// \brief Пул остановлен, ждать опустошения больше незачем
+		void abort()
+		{
+			std::lock_guard lock(mutex);
+			aborted = true;
+			idle.notify_all();
+		}
+
+		/// \brief Самый старый номер изменения, еще не доставленный подписчику
+		/// Разбираемое вызывающим потоком не учитывается: он сам его и доставляет
+		/// \return 0 если ждущих оповещений с номером нет
+		uint64_t oldestSequence()
+		{
+			std::lock_guard lock(mutex);
+			uint64_t oldest = current == this ? 0 : inFlight;
+			const auto take = [&oldest](const Notification &aNotification) {
+				if (aNotification.seq && (!oldest || aNotification.seq < oldest)) {
+					oldest = aNotification.seq;
+				}
+			};
+
+			for (size_t i = 0; i < count; ++i) {
+				const Item &item = ring[(head + i) % ring.size()];
+				take(item.single);
+				for (const auto &notification : item.batch) {
+					take(notification);
+				}
+			}
+			for (const auto &notification : pending) {
+				take(notification);
+			}
+			return oldest;
+		}
+
+		DispatchStats getStats()
+		{
+			std::lock_guard lock(mutex);
+			DispatchStats result = stats;
+			result.queued = isCoalescing() ? pending.size() : count;
+			return result;
+		}
+
+		static inline thread_local const Mailbox *current = nullptr;
+
+	private:
+		ObserverDispatcher &owner;
+
+		std::mutex mutex;
+		std::condition_variable idle;
+		std::vector<Item> ring;
+		size_t head = 0;
+		size_t count = 0;
+		bool scheduled = false; // Ящик стоит в очереди пула или таймера, либо разбирается
+		bool aborted = false;
+		DispatchStats stats;
+		Targets targets;
+
+		// Режим с ограничением частоты
+		const std::chrono::milliseconds minInterval;
+		std::vector<Notification> pending; // Последние значения в порядке первого изменения
+		std::unordered_map<PendingKey, size_t, PendingKeyHash> pendingIndex;
+		Clock::time_point pendingSince;
+		Clock::time_point lastFlush;
+		bool delivering = false;
+		bool flushRequested = false;
+		uint64_t inFlight = 0; // Самый старый номер в разбираемом сейчас оповещении или пакете
+
+		static uint64_t oldestOf(const std::vector<Notification> &aBatch)
+		{
+			uint64_t oldest = 0;
+			for (const auto &notification : aBatch) {
+				if (notification.seq && (!oldest || notification.seq < oldest)) {
+					oldest = notification.seq;
+				}
+			}
+			return oldest;
+		}
+
+		bool isCoalescing() const
+		{
+			return minInterval.count() > 0;
+		}
+
+		/// \brief Положить значение поверх предыдущего для той же записи, вызывается под мьютексом
+		void coalesce(Notification &&aNotification)
+		{
+			const PendingKey key{aNotification.prefix.data(), aNotification.entry.data()};
+			auto [it, inserted] = pendingIndex.try_emplace(key, pending.size());
+
+			if (inserted) {
+				if (pending.empty()) {
+					pendingSince = Clock::now();
+				}
+				pending.push_back(std::move(aNotification));
+			} else {
+				pending[it->second] = std::move(aNotification);
+				++stats.coalesced;
+			}
+
+			if (scheduled) {
+				return;
+			}
+			scheduled = true;
+
+			// Порядок захвата всегда ящик -> пул, см. stats()
+			owner.arm(this, lastFlush + minInterval);
+		}
+
+		/// \brief Отдать накопленное подписчику, если интервал прошел
+		void flush()
+		{
+			std::unique_lock lock(mutex);
+			// Ящик мог попасть в очередь дважды (таймер и досрочный сброс), разбирает только один поток
+			if (delivering) {
+				return;
+			}
+
+			if (pending.empty()) {
+				scheduled = false;
+				idle.notify_all();
+				return;
+			}
+
+			const auto now = Clock::now();
+			if (!flushRequested && now < lastFlush + minInterval) {
+				owner.arm(this, lastFlush + minInterval);
+				return;
+			}
+
+			std::vector<Notification> batch;
+			batch.swap(pending);
+			pendingIndex.clear();
+			const auto lag = std::chrono::duration_cast<std::chrono::microseconds>(now - pendingSince);
+			lastFlush = now;
+			flushRequested = false;
+			delivering = true;
+			inFlight = oldestOf(batch);
+			const Targets to = targets;
+			lock.unlock();
+
+			deliverCoalesced(batch, to);
+
+			lock.lock();
+			delivering = false;
+			inFlight = 0;
+			stats.delivered += batch.size();
+			stats.lastLagUs = static_cast<uint64_t>(lag.count());
+			stats.maxLagUs = std::max(stats.maxLagUs, stats.lastLagUs);
+
+			if (pending.empty()) {
+				scheduled = false;
+				idle.notify_all();
+			} else {
+				owner.arm(this, flushRequested ? now : lastFlush + minInterval);
+			}
+		}
+
+		void deliverCoalesced(const std::vector<Notification> &aBatch, const Targets &aTo)
+		{
+			current = this;
+
+			std::vector<BbChange> changes;
+			for (const auto &notification : aBatch) {
+				if (notification.prefix.empty()) {
+					if (!aTo.entry) {
+						continue;
+					}
+					const auto start = HYDRO_BB_INSTRUMENTATION ? Clock::now() : Clock::time_point{};
+					deliverEntry(aTo.entry, notification);
+					record(aTo.entry, start);
+				} else if (aTo.prefix) {
+					changes.push_back(notification.change());
+				}
+			}
+
+			const auto start = HYDRO_BB_INSTRUMENTATION ? Clock::now() : Clock::time_point{};
+			if (changes.size() == 1) {
+				aTo.prefix->onPrefixChanged(changes.front());
+				record(aTo.prefix, start);
+			} else if (!changes.empty()) {
+				aTo.prefix->onPrefixBatchUpdated(changes);
+				record(aTo.prefix, start);
+			}
+
+			current = nullptr;
+		}
+
+		void enqueueEntry(Notification &&aNotification)
+		{
+			if (isCoalescing()) {
+				std::lock_guard lock(mutex);
+				if (!targets.entry) {
+					return;
+				}
+				coalesce(std::move(aNotification));
+				return;
+			}
+			push(Item{Item::Kind::Entry, std::move(aNotification), {}, Clock::now()});
+		}
+
+		/// \brief Отдать подписчику записи, общий буфер передается дальше как есть
+		static void deliverEntry(AbstractEntryObserver *aTarget, const Notification &aNotification)
+		{
+			if (aNotification.value.handle()) {
+				aTarget->onEntryShared(aNotification.entry, aNotification.value.handle());
+			} else {
+				aTarget->onEntryUpdated(aNotification.entry, aNotification.value.get());
+			}
+		}
+
+		void push(Item &&aItem)
+		{
+			{
+				std::lock_guard lock(mutex);
+				// Ящик отвязан, а писатель пришел со старым снимком подписок
+				if (!(aItem.kind == Item::Kind::Entry ? targets.entry != nullptr : targets.prefix != nullptr)) {
+					return;
+				}
+				if (count == ring.size()) {
+					head = (head + 1) % ring.size();
+					--count;
+					++stats.dropped;
+				}
+
+				ring[(head + count) % ring.size()] = std::move(aItem);
+				++count;
+
+				if (scheduled) {
+					return;
+				}
+				scheduled = true;
+			}
+
+			owner.schedule(this);
+		}
+
+		/// \brief Время обработчика подписчика, только с инструментированием
+		template<typename Observer>
+		void record([[maybe_unused]] const Observer *aTarget, [[maybe_unused]] Clock::time_point aStart)
+		{
+#if HYDRO_BB_INSTRUMENTATION
+			owner.callbackTimings.of(aTarget).record(Clock::now() - aStart);
+#endif
+		}
+
+		void deliver(const Item &aItem, const Targets &aTo)
+		{
+			if (aItem.kind == Item::Kind::Entry ? !aTo.entry : !aTo.prefix) {
+				return;
+			}
+
+			current = this;
+			const auto start = HYDRO_BB_INSTRUMENTATION ? Clock::now() : Clock::time_point{};
+
+			switch (aItem.kind) {
+				case Item::Kind::Entry:
+					deliverEntry(aTo.entry, aItem.single);
+					record(aTo.entry, start);
+					break;
+				case Item::Kind::Prefix:
+					aTo.prefix->onPrefixChanged(aItem.single.change());
+					record(aTo.prefix, start);
+					break;
+				case Item::Kind::Batch: {
+					std::vector<BbChange> changes;
+					changes.reserve(aItem.batch.size());
+					for (const auto &notification : aItem.batch) {
+						changes.push_back(notification.change());
+					}
+					aTo.prefix->onPrefixBatchUpdated(changes);
+					record(aTo.prefix, start);
+					break;
+				}
+			}
+
+			current = nullptr;
+		}
+	};
+
+public:
+	/// \brief Конструктор
+	/// \param aThreads количество потоков пула, потоки запускаются при первой асинхронной подписке
+	explicit ObserverDispatcher(size_t aThreads = 2) : threadCount{std::max<size_t>(aThreads, 1)}
+	{
+	}
+
+	ObserverDispatcher(const ObserverDispatcher &) = delete;
+	ObserverDispatcher &operator=(const ObserverDispatcher &) = delete;
+
+	~ObserverDispatcher()
+	{
+		stop();
+	}
+
+	/// \brief Получить прокси для асинхронной подписки
+	/// Подписки одного объекта с одинаковыми параметрами делят ящик, с разными - получают свои
+	/// \param aObserver подписчик записи или префикса
+	/// \param aOptions параметры подписки
+	template<typename Observer>
+	Observer *proxy(Observer *aObserver, const SubscribeOptions &aOptions)
+	{
+		Mailbox *mailbox = mailboxFor(dynamic_cast<const void *>(aObserver), aOptions);
+		mailbox->attach(aObserver);
+		return mailbox;
+	}
+
+	/// \brief Найти прокси подписчика
+	/// \return прокси всех асинхронных подписок объекта, пусто если их нет
+	template<typename Observer>
+	std::vector<Observer *> find(Observer *aObserver) const
+	{
+		std::vector<Observer *> result;
+		std::lock_guard lock(mutex);
+		if (auto it = mailboxes.find(dynamic_cast<const void *>(aObserver)); it != mailboxes.end()) {
+			result.assign(it->second.begin(), it->second.end());
+		}
+		return result;
+	}
+
+	/// \brief Дождаться доставки всех оповещений подписчику
+	/// Нельзя вызывать под мьютексом BB, обработчик подписчика сам может обращаться к BB
+	/// \param aObserver подписчик (объект целиком)
+	void quiesce(const void *aObserver)
+	{
+		for (Mailbox *mailbox : mailboxesOf(aObserver)) {
+			mailbox->quiesce();
+		}
+	}
+
+	/// \brief Самый старый номер изменения, ждущий доставки подписчику в любом из его ящиков
+	/// Вызванный из обработчика подписчика не учитывает то, что этот обработчик сейчас получает
+	/// \param aObserver подписчик (объект целиком)
+	/// \return 0 если ничего не ждет
+	uint64_t oldestPending(const void *aObserver) const
+	{
+		uint64_t oldest = 0;
+		for (Mailbox *mailbox : mailboxesOf(aObserver)) {
+			const uint64_t one = mailbox->oldestSequence();
+			if (one && (!oldest || one < oldest)) {
+				oldest = one;
+			}
+		}
+		return oldest;
+	}
+
+	/// \brief Отвязать подписчика от его ящиков после снятия всех подписок этого вида
+	/// Ящики, которые больше никому не нужны, убираются из таблицы: новый подписчик по тому же
+	/// адресу не унаследует их параметры. Память ящика переиспользуется, а не освобождается -
+	/// писатель со старым снимком подписок еще может обратиться к прокси
+	/// \param aObserver подписчик, вызывается после quiesce
+	template<typename Observer>
+	void release(Observer *aObserver)
+	{
+		std::lock_guard config(configMutex);
+		const void *key = dynamic_cast<const void *>(aObserver);
+
+		std::vector<Mailbox *> unused;
+		for (Mailbox *mailbox : mailboxesOf(key)) {
+			// Отписка из собственного обработчика: ящик еще разбирается этим потоком
+			if (Mailbox::current != mailbox && mailbox->detach(aObserver)) {
+				unused.push_back(mailbox);
+			}
+		}
+		if (unused.empty()) {
+			return;
+		}
+
+		std::lock_guard lock(mutex);
+		auto &owned = mailboxes[key];
+		for (Mailbox *mailbox : unused) {
+			owned.erase(std::remove(owned.begin(), owned.end(), mailbox), owned.end());
+			ready.erase(std::remove(ready.begin(), ready.end(), mailbox), ready.end());
+			for (auto it = timers.begin(); it != timers.end();) {
+				it = it->second == mailbox ? timers.erase(it) : std::next(it);
+			}
+
+			if (mailbox->pins) {
+				mailbox->retiring = true;
+			} else {
+				spare.push_back(mailbox);
+			}
+		}
+		if (owned.empty()) {
+			mailboxes.erase(key);
+		}
+	}
+
+	/// \brief Суммарные метрики по всем асинхронным подписчикам
+	DispatchStats stats() const
+	{
+		// Ящики не освобождаются, поэтому их можно опрашивать после снятия мьютекса пула.
+		// Под мьютексом пула мьютекс ящика не берется: ящик сам обращается к пулу под своим.
+		// Освобожденные ящики тоже учитываются, счетчики не идут назад
+		std::vector<Mailbox *> all;
+		{
+			std::lock_guard lock(mutex);
+			for (const auto &mailbox : storage) {
+				all.push_back(mailbox.get());
+			}
+		}
+
+		DispatchStats result;
+		for (auto *mailbox : all) {
+			const DispatchStats one = mailbox->getStats();
+			result.delivered += one.delivered;
+			result.dropped += one.dropped;
+			result.coalesced += one.coalesced;
+			result.queued += one.queued;
+			result.maxLagUs = std::max(result.maxLagUs, one.maxLagUs);
+			result.lastLagUs = std::max(result.lastLagUs, one.lastLagUs);
+		}
+		return result;
+	}
+
+#if HYDRO_BB_INSTRUMENTATION
+	/// \brief Время обработчиков асинхронных подписчиков
+	void collectCallbackStats(std::vector<BbObserverStats> &aOut) const
+	{
+		callbackTimings.collect(aOut, true);
+	}
+#endif
+
+	/// \brief Остановить пул, недоставленные оповещения отбрасываются
+	void stop()
+	{
+		{
+			std::lock_guard lock(mutex);
+			if (stopping) {
+				return;
+			}
+			stopping = true;
+		}
+
+		wakeup.notify_all();
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		threads.clear();
+
+		// Разбудить тех, кто ждет опустошения ящиков
+		std::vector<Mailbox *> all;
+		{
+			std::lock_guard lock(mutex);
+			for (const auto &mailbox : storage) {
+				all.push_back(mailbox.get());
+			}
+		}
+		for (auto *mailbox : all) {
+			mailbox->abort();
+		}
+	}
+
+private:
+	static constexpr size_t kDrainBurst = 32; // Сколько оповещений разобрать подряд, прежде чем уступить другим ящикам
+
+	const size_t threadCount;
+
+	std::mutex configMutex; // Создание и освобождение ящиков
+	mutable std::mutex mutex;
+	std::condition_variable wakeup;
+	std::vector<std::unique_ptr<Mailbox>> storage; // Все ящики, живут до конца диспетчера
+	std::unordered_map<const void *, std::vector<Mailbox *>> mailboxes; // Ящики подписок объекта
+	std::vector<Mailbox *> spare; // Освобожденные ящики для новых подписок
+	std::deque<Mailbox *> ready;
+	std::multimap<Clock::time_point, Mailbox *> timers; // Отложенные сбросы ящиков с ограничением частоты
+	std::vector<std::thread> threads;
+	bool stopping = false;
+
+#if HYDRO_BB_INSTRUMENTATION
+	mutable BbInstrumentation::ObserverTimings callbackTimings;
+#endif
+
+	Mailbox *mailboxFor(const void *aObserver, const SubscribeOptions &aOptions)
+	{
+		std::lock_guard config(configMutex);
+		std::lock_guard lock(mutex);
+
+		auto &owned = mailboxes[aObserver];
+		auto it = std::find_if(owned.begin(), owned.end(), [&](const Mailbox *m) { return m->serves(aOptions); });
+		if (it != owned.end()) {
+			return *it;
+		}
+
+		Mailbox *mailbox = nullptr;
+		if (auto reuse = std::find_if(spare.begin(), spare.end(), [&](const Mailbox *m) { return m->serves(aOptions); });
+			reuse != spare.end()) {
+			mailbox = *reuse;
+			spare.erase(reuse);
+		} else {
+			mailbox = storage.emplace_back(std::make_unique<Mailbox>(*this, aOptions)).get();
+		}
+		owned.push_back(mailbox);
+
+		if (threads.empty() && !stopping) {
+			for (size_t i = 0; i < threadCount; ++i) {
+				threads.emplace_back([this]() { workerThread(); });
+			}
+		}
+
+		return mailbox;
+	}
+
+	std::vector<Mailbox *> mailboxesOf(const void *aObserver) const
+	{
+		std::lock_guard lock(mutex);
+		auto it = mailboxes.find(aObserver);
+		return it != mailboxes.end() ? it->second : std::vector<Mailbox *>{};
+	}
+
+	void schedule(Mailbox *aMailbox)
+	{
+		{
+			std::lock_guard lock(mutex);
+			if (stopping) {
+				return;
+			}
+			ready.push_back(aMailbox);
+		}
+		wakeup.notify_one();
+	}
+
+	/// \brief Поставить ящик в очередь пула не раньше указанного момента
+	void arm(Mailbox *aMailbox, Clock::time_point aDue)
+	{
+		if (aDue <= Clock::now()) {
+			schedule(aMailbox);
+			return;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			if (stopping) {
+				return;
+			}
+			timers.emplace(aDue, aMailbox);
+		}
+		// Спящий поток пересчитает срок ожидания
+		wakeup.notify_one();
+	}
+
+	void workerThread()
+	{
+		while (true) {
+			Mailbox *mailbox = nullptr;
+			{
+				std::unique_lock lock(mutex);
+				while (!stopping) {
+					const auto now = Clock::now();
+					while (!timers.empty() && timers.begin()->first <= now) {
+						ready.push_back(timers.begin()->second);
+						timers.erase(timers.begin());
+					}
+
+					if (!ready.empty()) {
+						break;
+					}
+
+					if (timers.empty()) {
+						wakeup.wait(lock);
+					} else {
+						wakeup.wait_until(lock, timers.begin()->first);
+					}
+				}
+
+				if (stopping) {
+					return;
+				}
+
+				mailbox = ready.front();
+				ready.pop_front();
+				++mailbox->pins;
+			}
+
+			// Ящик с остатком встает в конец очереди, чтобы один подписчик не занимал поток
+			const bool more = mailbox->drain(kDrainBurst);
+
+			std::lock_guard lock(mutex);
+			--mailbox->pins;
+			if (mailbox->retiring) {
+				if (!mailbox->pins) {
+					mailbox->retiring = false;
+					spare.push_back(mailbox);
+				}
+			} else if (more) {
+				ready.push_back(mailbox);
+			}
+		}
+	}
+};
@@ -4,6 +4,7 @@
 namespace Options {
 
 static constexpr size_t kCalibTableSize = 10;
+static constexpr size_t kHistoryCapacity = 2048; // Отсчетов в кольце истории на запись
 
 }
 
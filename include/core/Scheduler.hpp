@@ -0,0 +1,462 @@
+/*!
+@file
+@brief Планировщик периодических и разовых задач на иерархическом колесе таймеров
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// \brief Метрики планировщика
+struct SchedulerStats {
+	size_t tasks = 0;       // Задач в расписании
+	uint64_t wakeups = 0;   // Пробуждений потока
+	uint64_t fired = 0;     // Вызовов задач
+	uint64_t overruns = 0;  // Пропущенных периодов: задача или соседи по потоку работали дольше периода
+	uint64_t maxLateUs = 0; // Наибольшее опоздание вызова относительно срока
+};
+
+/// \brief Планировщик задач для подсистем вместо собственных потоков со sleep_for
+/// Один поток спит ровно до ближайшего срока и вызывает созревшие задачи по очереди, без мьютекса
+/// колеса. Поэтому задачи должны быть короткими: долгая задача задерживает остальные. Медленная работа
+/// (файлы, fsync) регистрируется через background и выполняется отдельным рабочим потоком.
+/// Колесо - kLevels уровней по kSlots ячеек, ячейка уровня L покрывает kSlots^L тиков. Вставка O(1),
+/// задача с дальним сроком спускается на нижний уровень, когда до срока остается один оборот нижнего.
+/// Периодическая задача идет по сетке от первого срока, время выполнения не копит дрейф
+class Scheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+	using TaskId = uint64_t;
+
+	static constexpr size_t kSlotBits = 6;
+	static constexpr size_t kSlots = size_t{1} << kSlotBits;
+	static constexpr size_t kLevels = 4;
+
+	/// \param aTick разрешение таймеров, сроки округляются вверх до тика
+	explicit Scheduler(Clock::duration aTick = std::chrono::milliseconds{10}) :
+		tick{std::max(aTick, Clock::duration{1})},
+		origin{Clock::now()}
+	{
+	}
+
+	Scheduler(const Scheduler &) = delete;
+	Scheduler &operator=(const Scheduler &) = delete;
+
+	~Scheduler()
+	{
+		stop();
+	}
+
+	/// \brief Разовая задача через aDelay
+	TaskId after(std::string aName, Clock::duration aDelay, std::function<void()> aTask)
+	{
+		return add(std::move(aName), aDelay, 0, [task = std::move(aTask)]() {
+			task();
+			return false;
+		});
+	}
+
+	/// \brief Периодическая задача, первый вызов через период
+	/// \param aTask возвращает false, чтобы снять себя с расписания
+	TaskId every(std::string aName, Clock::duration aPeriod, std::function<bool()> aTask)
+	{
+		return every(std::move(aName), aPeriod, std::move(aTask), aPeriod);
+	}
+
+	/// \brief Периодическая задача с отдельной задержкой первого вызова
+	TaskId every(std::string aName, Clock::duration aPeriod, std::function<bool()> aTask, Clock::duration aFirst)
+	{
+		return add(std::move(aName), aFirst, std::max<uint64_t>(1, ticksOf(aPeriod)), std::move(aTask));
+	}
+
+	/// \brief Периодическая задача на рабочем потоке, не задерживает остальные задачи
+	/// Следующий вызов не начнется, пока не закончился предыдущий, пропущенный срок считается в overruns
+	/// \param aTask возвращает false, чтобы снять себя с расписания
+	TaskId background(std::string aName, Clock::duration aPeriod, std::function<bool()> aTask)
+	{
+		return add(std::move(aName), aPeriod, std::max<uint64_t>(1, ticksOf(aPeriod)), std::move(aTask), true);
+	}
+
+	/// \brief Снять задачу с расписания, выполняющийся сейчас вызов доработает
+	/// \return false если задачи уже нет
+	bool cancel(TaskId aId)
+	{
+		std::lock_guard lock(mutex);
+		// Номер остается в ячейке колеса и будет пропущен при обходе
+		return tasks.erase(aId) > 0;
+	}
+
+	/// \brief Запустить поток планировщика и рабочий поток
+	void start()
+	{
+		std::lock_guard control(controlMutex);
+		if (thread.joinable()) {
+			return;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			stopping = false;
+		}
+		thread = std::thread(&Scheduler::threadFunction, this);
+		worker = std::thread(&Scheduler::workerFunction, this);
+	}
+
+	/// \brief Остановить потоки, задачи остаются в расписании до следующего start
+	/// Выполняющийся на рабочем потоке вызов дорабатывает, не начатые отбрасываются
+	void stop()
+	{
+		std::lock_guard control(controlMutex);
+		if (!thread.joinable()) {
+			return;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		wakeup.notify_one();
+		workerWakeup.notify_one();
+		thread.join();
+		worker.join();
+
+		std::lock_guard lock(mutex);
+		for (TaskId id : backlog) {
+			if (auto it = tasks.find(id); it != tasks.end()) {
+				it->second.running = false;
+			}
+		}
+		backlog.clear();
+	}
+
+	SchedulerStats stats() const
+	{
+		std::lock_guard lock(mutex);
+		SchedulerStats result = counters;
+		result.tasks = tasks.size();
+		return result;
+	}
+
+private:
+	struct Task {
+		std::string name;
+		std::function<bool()> function;
+		uint64_t expiry = 0; // Тик срока
+		uint64_t period = 0; // Тиков, 0 - разовая
+		bool background = false; // Выполняется рабочим потоком
+		bool running = false;    // Вызов в очереди рабочего потока или выполняется
+	};
+
+	static constexpr uint64_t kNever = UINT64_MAX;
+
+	const Clock::duration tick;
+	const Clock::time_point origin;
+
+	std::mutex controlMutex; // start/stop
+	std::thread thread;
+	std::thread worker;
+
+	mutable std::mutex mutex; // Колесо, задачи и счетчики
+	std::condition_variable wakeup;
+	std::condition_variable workerWakeup;
+	bool stopping = false;
+
+	std::unordered_map<TaskId, Task> tasks;
+	std::array<std::array<std::vector<TaskId>, kSlots>, kLevels> wheel;
+	std::array<uint64_t, kLevels> occupied{}; // Битовые маски непустых ячеек
+	std::vector<TaskId> spare;                // Для разбора ячейки без выделения памяти
+	std::deque<TaskId> backlog;               // Очередь рабочего потока
+	uint64_t current = 0;                     // Последний обработанный тик
+	TaskId lastId = 0;
+	SchedulerStats counters;
+
+	uint64_t ticksOf(Clock::duration aDuration) const
+	{
+		if (aDuration <= Clock::duration::zero()) {
+			return 0;
+		}
+		return static_cast<uint64_t>((aDuration.count() + tick.count() - 1) / tick.count());
+	}
+
+	uint64_t tickAt(Clock::time_point aTime) const
+	{
+		return aTime <= origin ? 0 : static_cast<uint64_t>((aTime - origin) / tick);
+	}
+
+	/// \brief Первая граница тика не раньше aTime
+	uint64_t tickAfter(Clock::time_point aTime) const
+	{
+		return aTime <= origin ? 0 : ticksOf(aTime - origin);
+	}
+
+	Clock::time_point timeOf(uint64_t aTick) const
+	{
+		return origin + tick * static_cast<Clock::rep>(aTick);
+	}
+
+	TaskId add(std::string aName, Clock::duration aDelay, uint64_t aPeriod, std::function<bool()> aTask,
+		bool aBackground = false)
+	{
+		std::unique_lock lock(mutex);
+		const TaskId id = ++lastId;
+		// Отсчет от следующей границы тика: от текущей задача сработала бы до истечения задержки
+		const uint64_t base = std::max(current, tickAfter(Clock::now()));
+		const uint64_t expiry = base + std::max<uint64_t>(1, ticksOf(aDelay));
+
+		tasks.emplace(id, Task{std::move(aName), std::move(aTask), expiry, aPeriod, aBackground});
+		insertLocked(id, expiry);
+		lock.unlock();
+
+		// Поток мог уснуть до более позднего срока
+		wakeup.notify_one();
+		return id;
+	}
+
+	/// \brief Положить задачу в ячейку по расстоянию до срока
+	void insertLocked(TaskId aId, uint64_t aExpiry)
+	{
+		const uint64_t delta = aExpiry > current ? aExpiry - current : 0;
+
+		size_t level = 0;
+		while (level + 1 < kLevels && delta >= (uint64_t{1} << (kSlotBits * (level + 1)))) {
+			++level;
+		}
+
+		// Срок дальше всего колеса: в самую дальнюю ячейку, при спуске срок пересчитается
+		constexpr uint64_t kSpan = uint64_t{1} << (kSlotBits * kLevels);
+		const uint64_t at = delta >= kSpan ? current + kSpan - 1 : aExpiry;
+
+		const size_t slot = static_cast<size_t>(at >> (kSlotBits * level)) & (kSlots - 1);
+		wheel[level][slot].push_back(aId);
+		occupied[level] |= uint64_t{1} << slot;
+	}
+
+	/// \brief Забрать содержимое ячейки, ее буфер уходит в spare
+	std::vector<TaskId> &takeSlotLocked(size_t aLevel, size_t aSlot)
+	{
+		spare.clear();
+		spare.swap(wheel[aLevel][aSlot]);
+		occupied[aLevel] &= ~(uint64_t{1} << aSlot);
+		return spare;
+	}
+
+	/// \brief Продвинуть колесо на один тик и собрать созревшие задачи
+	void advanceLocked(std::vector<TaskId> &aDue)
+	{
+		++current;
+
+		// Нижний уровень закончил оборот: ячейки старших уровней раздают задачи вниз, начиная с верхнего
+		size_t top = 0;
+		while (top + 1 < kLevels && (current & ((uint64_t{1} << (kSlotBits * (top + 1))) - 1)) == 0) {
+			++top;
+		}
+		for (size_t level = top; level > 0; --level) {
+			const size_t slot = static_cast<size_t>(current >> (kSlotBits * level)) & (kSlots - 1);
+			auto &ids = takeSlotLocked(level, slot);
+			for (TaskId id : ids) {
+				if (auto it = tasks.find(id); it != tasks.end()) {
+					insertLocked(id, it->second.expiry);
+				}
+			}
+		}
+
+		auto &ids = takeSlotLocked(0, static_cast<size_t>(current) & (kSlots - 1));
+		for (TaskId id : ids) {
+			if (tasks.count(id)) {
+				aDue.push_back(id);
+			}
+		}
+	}
+
+	/// \brief Ближайший тик, на котором в колесе что-то произойдет
+	uint64_t nextTickLocked() const
+	{
+		if (tasks.empty()) {
+			return kNever;
+		}
+
+		uint64_t best = kNever;
+		for (size_t level = 0; level < kLevels; ++level) {
+			const uint64_t bits = occupied[level];
+			if (!bits) {
+				continue;
+			}
+
+			// Ближайшая занятая ячейка после текущей, по кругу; сама текущая - через полный оборот
+			const size_t shift = kSlotBits * level;
+			const uint64_t position = current >> shift;
+			const auto index = static_cast<int>(position & (kSlots - 1));
+			const uint64_t distance = static_cast<uint64_t>(std::countr_zero(std::rotr(bits, (index + 1) % static_cast<int>(kSlots)))) + 1;
+			best = std::min(best, (position + distance) << shift);
+		}
+		return best;
+	}
+
+	void threadFunction()
+	{
+		std::vector<TaskId> due;
+		std::unique_lock lock(mutex);
+
+		while (!stopping) {
+			const uint64_t target = tickAt(Clock::now());
+			while (due.empty() && current < target) {
+				if (tasks.empty()) {
+					current = target;
+					break;
+				}
+				advanceLocked(due);
+			}
+
+			if (!due.empty()) {
+				runLocked(due, lock);
+				due.clear();
+				continue;
+			}
+
+			const uint64_t next = nextTickLocked();
+			if (next == kNever) {
+				wakeup.wait(lock);
+			} else {
+				wakeup.wait_until(lock, timeOf(next));
+			}
+			++counters.wakeups;
+		}
+	}
+
+	/// \brief Вызвать созревшие задачи без мьютекса и вернуть периодические в колесо
+	void runLocked(const std::vector<TaskId> &aDue, std::unique_lock<std::mutex> &aLock)
+	{
+		for (TaskId id : aDue) {
+			auto it = tasks.find(id);
+			if (it == tasks.end()) {
+				continue;
+			}
+
+			// Фоновую задачу отдаем рабочему потоку и сразу ставим следующий срок
+			if (it->second.background) {
+				Task &task = it->second;
+				if (task.running) {
+					++counters.overruns;
+				} else {
+					noteFiredLocked(task);
+					task.running = true;
+					backlog.push_back(id);
+					workerWakeup.notify_one();
+				}
+				rescheduleLocked(id, task);
+				continue;
+			}
+
+			// Функцию забираем на время вызова: задачу могут снять, пока она выполняется
+			std::function<bool()> function = std::move(it->second.function);
+			noteFiredLocked(it->second);
+			const bool again = invokeUnlocked(id, function, aLock);
+
+			it = tasks.find(id);
+			if (it == tasks.end()) {
+				continue;
+			}
+			if (!again || it->second.period == 0) {
+				tasks.erase(it);
+				continue;
+			}
+
+			it->second.function = std::move(function);
+			rescheduleLocked(id, it->second);
+		}
+	}
+
+	void workerFunction()
+	{
+		std::unique_lock lock(mutex);
+
+		while (true) {
+			workerWakeup.wait(lock, [this]() { return stopping || !backlog.empty(); });
+			if (stopping) {
+				return;
+			}
+
+			const TaskId id = backlog.front();
+			backlog.pop_front();
+			auto it = tasks.find(id);
+			if (it == tasks.end()) {
+				continue;
+			}
+
+			std::function<bool()> function = std::move(it->second.function);
+			const bool again = invokeUnlocked(id, function, lock);
+
+			it = tasks.find(id);
+			if (it == tasks.end()) {
+				continue;
+			}
+			if (!again) {
+				tasks.erase(it);
+				continue;
+			}
+
+			// Срок уже стоит в колесе, возвращаем только функцию
+			it->second.function = std::move(function);
+			it->second.running = false;
+		}
+	}
+
+	/// \brief Учесть вызов задачи в счетчиках
+	void noteFiredLocked(const Task &aTask)
+	{
+		const auto late = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - timeOf(aTask.expiry));
+		counters.maxLateUs = std::max(counters.maxLateUs, static_cast<uint64_t>(std::max<int64_t>(late.count(), 0)));
+		++counters.fired;
+	}
+
+	/// \brief Вызвать задачу без мьютекса
+	/// \return false если задача просит снять ее с расписания, исключение задачу не снимает
+	bool invokeUnlocked(TaskId aId, const std::function<bool()> &aFunction, std::unique_lock<std::mutex> &aLock)
+	{
+		aLock.unlock();
+		bool again = true;
+		std::string error;
+		try {
+			again = aFunction();
+		} catch (const std::exception &e) {
+			error = e.what();
+		}
+		aLock.lock();
+
+		if (auto it = tasks.find(aId); !error.empty() && it != tasks.end()) {
+			HYDRO_LOG_ERROR("Scheduler: task " + it->second.name + " failed: " + error);
+		}
+		return again;
+	}
+
+	/// \brief Следующий срок по сетке, пропущенные из-за долгих вызовов периоды не догоняем
+	void rescheduleLocked(TaskId aId, Task &aTask)
+	{
+		aTask.expiry += aTask.period;
+		const uint64_t now = std::max(current, tickAt(Clock::now()));
+		if (aTask.expiry <= now) {
+			const uint64_t missed = (now - aTask.expiry) / aTask.period + 1;
+			counters.overruns += missed;
+			aTask.expiry += missed * aTask.period;
+		}
+		insertLocked(aId, aTask.expiry);
+	}
+};
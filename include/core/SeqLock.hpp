@@ -0,0 +1,121 @@
+/*!
+@file
+@brief Ячейка с seqlock для чтения без блокировок
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+/// \brief Ячейка тривиально копируемого значения под seqlock
+/// Писатель один (снаружи сериализуется мьютексом), читателей сколько угодно, читатели не блокируют
+/// ни писателя, ни друг друга. Полезная нагрузка лежит в atomic словах, поэтому гонки данных нет
+/// даже при чтении во время записи - такое чтение просто повторяется.
+/// Тег описывает что лежит в ячейке (у BB это индекс альтернативы BbValue), 0 - пусто
+template<size_t Capacity>
+class SeqLockCell {
+	static constexpr size_t kWords = (Capacity + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<uint32_t> seq{0};
+	std::atomic<uint32_t> tag{0};
+	std::array<std::atomic<uint64_t>, kWords> words{};
+
+public:
+	static constexpr size_t kCapacity = Capacity;
+
+	/// \brief Записать значение, вызывается только одним писателем одновременно
+	/// \param aTag тег значения
+	/// \param aData данные, может быть nullptr если aSize == 0
+	/// \param aSize размер данных, не больше Capacity
+	void store(uint32_t aTag, const void *aData, size_t aSize)
+	{
+		std::array<uint64_t, kWords> buffer{};
+		if (aSize) {
+			std::memcpy(buffer.data(), aData, aSize);
+		}
+
+		const uint32_t current = seq.load(std::memory_order_relaxed);
+		seq.store(current + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < kWords; ++i) {
+			words[i].store(buffer[i], std::memory_order_relaxed);
+		}
+		tag.store(aTag, std::memory_order_relaxed);
+
+		seq.store(current + 2, std::memory_order_release);
+	}
+
+	/// \brief Прочитать значение
+	/// \param aTag ожидаемый тег
+	/// \param aOut куда копировать
+	/// \param aSize размер значения
+	/// \return true если в ячейке лежит значение с ожидаемым тегом
+	bool load(uint32_t aTag, void *aOut, size_t aSize) const
+	{
+		std::array<uint64_t, kWords> buffer;
+		uint32_t currentTag;
+
+		while (!tryCopy(buffer, currentTag)) {
+		}
+
+		if (currentTag != aTag) {
+			return false;
+		}
+
+		std::memcpy(aOut, buffer.data(), aSize);
+		return true;
+	}
+
+	/// \brief Прочитать значение с любым тегом за ограниченное число попыток
+	/// Для читателей из другого процесса: писатель может умереть посреди записи
+	/// \param aOut куда копировать
+	/// \param aSize размер копируемых данных, не больше Capacity
+	/// \param aAttempts сколько раз пытаться
+	/// \return тег значения или nullopt, если согласованно прочитать не удалось
+	std::optional<uint32_t> tryLoad(void *aOut, size_t aSize, size_t aAttempts) const
+	{
+		std::array<uint64_t, kWords> buffer;
+		uint32_t currentTag;
+
+		for (size_t i = 0; i < aAttempts; ++i) {
+			if (tryCopy(buffer, currentTag)) {
+				std::memcpy(aOut, buffer.data(), aSize);
+				return currentTag;
+			}
+		}
+		return std::nullopt;
+	}
+
+	/// \brief Текущий тег
+	uint32_t currentTag() const
+	{
+		return tag.load(std::memory_order_acquire);
+	}
+
+private:
+	/// \brief Одна попытка согласованно скопировать ячейку
+	bool tryCopy(std::array<uint64_t, kWords> &aBuffer, uint32_t &aTag) const
+	{
+		const uint32_t before = seq.load(std::memory_order_acquire);
+		if (before & 1) {
+			return false;
+		}
+
+		aTag = tag.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < kWords; ++i) {
+			aBuffer[i] = words[i].load(std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return seq.load(std::memory_order_relaxed) == before;
+	}
+};
@@ -0,0 +1,105 @@
+/*!
+@file
+@brief Набор Blackboard, по одному на установку
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/Blackboard.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using InstallationId = uint8_t;
+
+/// \brief Шардированный BB для нескольких установок
+/// Каждая установка получает собственный Blackboard со своим хранилищем, мьютексом, таблицами
+/// подписчиков и доставкой, поэтому телеметрия одной грядки не конкурирует с другой.
+/// Имена внутри шарда те же, что и для одиночной установки (pump.telem.status), номер установки
+/// в имя не входит. Шарды создаются в конструкторе и живут до конца жизни объекта, поэтому
+/// доступ к шарду по номеру не требует блокировок.
+/// Приложение пока обслуживает одну установку и создает один шард: номер установки не приходит
+/// из радио, маршрутизация кадров по шардам появится вместе с ним
+class ShardedBlackboard {
+public:
+	static constexpr size_t kMaxInstallations = 255;
+	static constexpr InstallationId kLocalInstallation = 0;
+
+	/// \brief Результат запроса по всем установкам
+	struct Match {
+		InstallationId installation;
+		std::string_view key; // Указывает внутрь шарда, валиден пока жив ShardedBlackboard
+		BbValue value;
+	};
+
+	/// \param aInstallations количество установок, не больше kMaxInstallations
+	explicit ShardedBlackboard(size_t aInstallations = kMaxInstallations)
+	{
+		shards.resize(std::min(aInstallations, kMaxInstallations));
+		for (auto &shard : shards) {
+			shard = std::make_shared<Blackboard>();
+		}
+	}
+
+	ShardedBlackboard(const ShardedBlackboard &) = delete;
+	ShardedBlackboard &operator=(const ShardedBlackboard &) = delete;
+
+	size_t size() const
+	{
+		return shards.size();
+	}
+
+	/// \brief BB установки
+	/// \return шард или nullptr, если установки с таким номером нет
+	std::shared_ptr<Blackboard> shard(InstallationId aInstallation) const
+	{
+		return aInstallation < shards.size() ? shards[aInstallation] : nullptr;
+	}
+
+	/// \brief Пройти по всем шардам
+	/// \param aCallback вызывается как aCallback(InstallationId, Blackboard &)
+	template<typename F>
+	void forEachShard(F &&aCallback) const
+	{
+		for (size_t i = 0; i < shards.size(); ++i) {
+			aCallback(static_cast<InstallationId>(i), *shards[i]);
+		}
+	}
+
+	/// \brief Пройти по записям всех установок, подходящим под маску
+	/// Каждый шард отвечает согласованно внутри установки, но не между установками.
+	/// Шард держит разделяемый захват только на время выборки кандидатов из своих индексов,
+	/// обработчик вызывается без захватов
+	/// \param aMask маска имени, "*" заменяет один сегмент (например *.telem.status)
+	/// \param aCallback вызывается как aCallback(InstallationId, const BbDelta &)
+	template<typename F>
+	void forEachMatch(std::string_view aMask, F &&aCallback) const
+	{
+		for (size_t i = 0; i < shards.size(); ++i) {
+			for (const auto &entry : shards[i]->matching(aMask)) {
+				aCallback(static_cast<InstallationId>(i), entry);
+			}
+		}
+	}
+
+	/// \brief Собрать записи всех установок, подходящие под маску
+	/// \param aMask маска имени, "*" заменяет один сегмент
+	std::vector<Match> query(std::string_view aMask) const
+	{
+		std::vector<Match> result;
+		forEachMatch(aMask, [&](InstallationId aInstallation, const BbDelta &aEntry) {
+			result.push_back({aInstallation, aEntry.key, aEntry.value});
+		});
+		return result;
+	}
+
+private:
+	std::vector<std::shared_ptr<Blackboard>> shards;
+};
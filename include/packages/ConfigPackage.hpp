@@ -7,6 +7,7 @@
 #include "core/Helpers.hpp"
 #include "core/InterfaceList.hpp"
 #include "core/Options.hpp"
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -19,32 +20,35 @@ struct ConfigPackage {
 	{
 		registerSettings();
 		generateValidators();
+		generateChangePolicies();
+		generateHistory();
 	}
 
+	/// \brief Тип и единица каждого параметра берутся из описания записи в BbNames
 	void registerSettings()
 	{
-		manager.registerSetting(Names::kLampEnabled, SettingType::BOOL, true, "Enable lamp");
-		manager.registerSetting(Names::kLampOnTime, SettingType::INT, 0, "Lamp on time in minutes");
-		manager.registerSetting(Names::kLampOffTime, SettingType::INT, 0, "Lamp off time in minutes");
+		manager.registerSetting(Names::kLampEnabled, true, "Enable lamp");
+		manager.registerSetting(Names::kLampOnTime, 0, "Lamp on time in minutes");
+		manager.registerSetting(Names::kLampOffTime, 0, "Lamp off time in minutes");
 
-		manager.registerSetting(Names::kPumpEnabled, SettingType::BOOL, true, "Enable pump");
-		manager.registerSetting(Names::kPumpMode, SettingType::INT, 0, "Pump mode");
+		manager.registerSetting(Names::kPumpEnabled, true, "Enable pump");
+		manager.registerSetting(Names::kPumpMode, 0, "Pump mode");
 
-		manager.registerSetting(Names::kPumpOnTime, SettingType::SECONDS, 15, "Pump on time in seconds");
-		manager.registerSetting(Names::kPumpOffTime, SettingType::SECONDS, 30, "Pump off time in seconds");
-		manager.registerSetting(Names::kPumpSwingTime, SettingType::SECONDS, 8, "Pump swing time in seconds");
-		manager.registerSetting(Names::kPumpValidTime, SettingType::SECONDS, 50, "Upper validation time in seconds");
-		manager.registerSetting(Names::kPumpMaxFloodTime, SettingType::SECONDS, 180, "Max time for tank flooding in secs");
+		manager.registerSetting(Names::kPumpOnTime, std::chrono::seconds{15}, "Pump on time in seconds");
+		manager.registerSetting(Names::kPumpOffTime, std::chrono::seconds{30}, "Pump off time in seconds");
+		manager.registerSetting(Names::kPumpSwingTime, std::chrono::seconds{8}, "Pump swing time in seconds");
+		manager.registerSetting(Names::kPumpValidTime, std::chrono::seconds{50}, "Upper validation time in seconds");
+		manager.registerSetting(Names::kPumpMaxFloodTime, std::chrono::seconds{180}, "Max time for tank flooding in secs");
 
-		manager.registerSetting(Names::kWaterLevelMinLevel, SettingType::FLOAT, 0.f, "Minimal water level in percent for pump operation");
+		manager.registerSetting(Names::kWaterLevelMinLevel, 0.f, "Minimal water level in percent for pump operation");
 
-		manager.registerSetting(Names::kSystemMaintance, SettingType::BOOL, false, "System maintance mode");
-		manager.registerSetting(Names::kBridgeMacs + ".1", SettingType::STRING, "E8:31:CD:D6:D1:B4", "MAC1");
-		manager.registerSetting(Names::kBridgeMacs + ".2", SettingType::STRING, "", "MAC2");
-		manager.registerSetting(Names::kBridgeMacs + ".3", SettingType::STRING, "", "MAC3");
-		manager.registerSetting(Names::kBridgeMacs + ".4", SettingType::STRING, "", "MAC4");
-		manager.registerSetting(Names::kBridgeMacs + ".5", SettingType::STRING, "", "MAC5");
-		manager.registerSetting(Names::kBridgeMacs + ".6", SettingType::STRING, "", "MAC6");
+		manager.registerSetting(Names::kSystemMaintance, false, "System maintance mode");
+		manager.registerSetting(Names::kBridgeMacs, ".1", "E8:31:CD:D6:D1:B4", "MAC1");
+		manager.registerSetting(Names::kBridgeMacs, ".2", "", "MAC2");
+		manager.registerSetting(Names::kBridgeMacs, ".3", "", "MAC3");
+		manager.registerSetting(Names::kBridgeMacs, ".4", "", "MAC4");
+		manager.registerSetting(Names::kBridgeMacs, ".5", "", "MAC5");
+		manager.registerSetting(Names::kBridgeMacs, ".6", "", "MAC6");
 
 		// Генерация таблицы калибровки бака
 		// Дефолтным значением будет калибровка на емкость 30 литров
@@ -52,8 +56,8 @@ struct ConfigPackage {
 			const float level = static_cast<float>(i * 10);
 			const float litre = static_cast<float>(i * 3);
 			const std::string number = std::to_string(i);
-			manager.registerSetting(Names::kLitreMeterCalibLev + number, SettingType::FLOAT, level, "Calibration point #" + number + " water level");
-			manager.registerSetting(Names::kLitreMeterCalibLit + number, SettingType::FLOAT, litre, "Calibration point #" + number + " litres");
+			manager.registerSetting(Names::kLitreMeterCalibLev, number, level, "Calibration point #" + number + " water level");
+			manager.registerSetting(Names::kLitreMeterCalibLit, number, litre, "Calibration point #" + number + " litres");
 		}
 	}
 
@@ -61,6 +65,33 @@ struct ConfigPackage {
 	{
 		std::unique_ptr<AbstractValidator> macVal = std::make_unique<MacFieldValidator>();
 		bb->insertValidator(Names::kBridgeMacs, std::move(macVal));
+
+		bb->insertValidator(Names::kPumpMode, std::make_unique<RangeValidator<int>>(static_cast<int>(PumpModes::EBBNormal),
+			static_cast<int>(PumpModes::Dripping)));
+		bb->insertValidator(Names::kWaterLevelMinLevel, std::make_unique<RangeValidator<float>>(0.f, 100.f));
+	}
+
+	/// \brief Отсечение шума датчиков, значения приходят с каждым кадром телеметрии
+	/// Раз в минуту значение принимается в любом случае, чтобы BB не застревал на краю мертвой зоны
+	void generateChangePolicies()
+	{
+		static constexpr std::chrono::seconds kRefresh{60};
+
+		bb->setChangePolicy(Names::getValueNameByDevice(Names::kWaterLevelDev), ChangePolicy{.absolute = 0.5, .refresh = kRefresh});
+		bb->setChangePolicy(Names::getValueNameByDevice(Names::kPHMeterDev), ChangePolicy{.absolute = 0.02, .refresh = kRefresh});
+		bb->setChangePolicy(Names::getValueNameByDevice(Names::kPPMMeterDev), ChangePolicy{.relative = 0.01, .refresh = kRefresh});
+		bb->setChangePolicy(Names::getValueNameByDevice(Names::kTemperatureDev), ChangePolicy{.absolute = 0.1, .refresh = kRefresh});
+		bb->setChangePolicy(Names::getValueNameByDevice(Names::kTurbidimeterDev), ChangePolicy{.relative = 0.02, .refresh = kRefresh});
+	}
+
+	/// \brief Кольца истории для графиков, последние изменения отдаются без SQLite
+	void generateHistory()
+	{
+		for (const auto &device : {Names::kWaterLevelDev, Names::kPHMeterDev, Names::kPPMMeterDev, Names::kTemperatureDev,
+				 Names::kTurbidimeterDev, Names::kPumpDev, Names::kLampDev}) {
+			bb->enableHistory(Names::getValueNameByDevice(device), Options::kHistoryCapacity);
+		}
+		bb->enableHistory(Names::kLitreMeterTankVal, Options::kHistoryCapacity);
 	}
 
 	bool load()
@@ -7,7 +7,9 @@
 
 struct DatabasePackage {
 	DatabasePackage(std::shared_ptr<Blackboard> aBb, std::shared_ptr<Database> aDb) :
-		pumpState{"pump.state", aBb, aDb}, waterLevel{"pump.waterLevel", aBb, aDb}
+		pumpState{"pump.state", aBb, aDb},
+		// Уровень меняется каждый кадр, для истории достаточно отсчета раз в 10 секунд
+		waterLevel{"pump.waterLevel", aBb, aDb, std::chrono::seconds{10}}
 	{
 	}
 
@@ -0,0 +1,83 @@
+/*!
+@file
+@brief Раскладка сегмента разделяемой памяти с зеркалом Blackboard
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/SeqLock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/// \brief Общая для писателя и читателей раскладка сегмента
+/// Сегмент: заголовок, затем capacity слотов фиксированного размера. Слот - запись каталога ключей
+/// (имя пишется один раз, до публикации слота счетчиком used) и seqlock ячейка со значением.
+/// Заголовок не зависит от BbValue, поэтому читатель собирается без ядра BB: значение отдается
+/// как тег (индекс альтернативы BbValue) и байты в представлении BbSerializers::toBinary
+namespace BbShm {
+
+static constexpr uint32_t kMagic = 0x4D534248; // "HBSM"
+static constexpr uint16_t kVersion = 2;
+static constexpr const char *kDefaultName = "/pihydrowave-bb";
+static constexpr uint32_t kDefaultCapacity = 256;
+
+static constexpr size_t kKeySize = 64;   // С нулевым байтом, длинные имена не зеркалируются
+static constexpr size_t kValueSize = 60; // Длинные строки обрезаются
+
+/// \brief Признаки значения в ячейке слота
+enum PayloadFlags : uint32_t {
+	kRemoved = 1u << 0,   // Запись удалена из BB, тег 0 и данных нет
+	kTruncated = 1u << 1, // Значение длиннее kValueSize, в data только начало
+};
+
+/// \brief Значение в ячейке слота
+struct Payload {
+	uint32_t size;
+	uint32_t flags; // PayloadFlags
+	uint8_t data[kValueSize];
+};
+
+struct Header {
+	std::atomic<uint32_t> magic; // Пишется последним, 0 - сегмент еще размечается
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t capacity; // Слотов в сегменте
+	uint32_t slotSize; // Защита от читателя другой сборки
+	std::atomic<uint32_t> used;      // Опубликовано слотов в каталоге
+	std::atomic<uint32_t> writerPid; // Процесс-писатель, 0 - писатель завершился
+	std::atomic<uint64_t> sequence;  // Последний номер изменения BB, попавший в сегмент
+};
+
+struct Slot {
+	char key[kKeySize];
+	std::atomic<uint64_t> changeSeq; // Номер изменения BB, последним записанный в слот
+	SeqLockCell<sizeof(Payload)> cell;
+};
+
+static_assert(std::is_trivially_copyable_v<Payload>);
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+	"Shared memory atomics must be address-free");
+
+/// \brief Размер сегмента на aCapacity слотов
+constexpr size_t segmentSize(uint32_t aCapacity)
+{
+	return sizeof(Header) + static_cast<size_t>(aCapacity) * sizeof(Slot);
+}
+
+inline Slot *slotAt(void *aBase, uint32_t aIndex)
+{
+	return reinterpret_cast<Slot *>(static_cast<uint8_t *>(aBase) + sizeof(Header)) + aIndex;
+}
+
+inline const Slot *slotAt(const void *aBase, uint32_t aIndex)
+{
+	return reinterpret_cast<const Slot *>(static_cast<const uint8_t *>(aBase) + sizeof(Header)) + aIndex;
+}
+
+} // namespace BbShm
@@ -0,0 +1,71 @@
+/*!
+@file
+@brief Зеркало выбранных записей Blackboard в разделяемой памяти
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/Blackboard.hpp"
+#include "core/HeteroLookup.hpp"
+#include "shm/BbShmLayout.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// \brief Зеркало BB для сторонних процессов (аналитика, второй UI) без нагрузки на REST
+/// Подписывается на префиксы inline и на каждое изменение делает одну seqlock запись в сегмент
+/// POSIX shm, без системных вызовов и аллокаций после прогрева. Новая запись получает следующий
+/// свободный слот каталога, слоты не освобождаются: удаленная запись остается в слоте с признаком
+/// kRemoved, строка длиннее kValueSize - с признаком kTruncated. Читать сегмент - BbShmReader.
+/// Сегмент создается заново при каждом запуске и удаляется при остановке
+class BbShmMirror : public AbstractPrefixObserver {
+public:
+	/// \param aBb BB
+	/// \param aPrefixes какие префиксы зеркалировать
+	/// \param aName имя сегмента для shm_open
+	/// \param aCapacity слотов в сегменте, записи сверх емкости не зеркалируются
+	BbShmMirror(std::shared_ptr<Blackboard> aBb, std::vector<std::string> aPrefixes, std::string aName = BbShm::kDefaultName,
+		uint32_t aCapacity = BbShm::kDefaultCapacity);
+	~BbShmMirror() override;
+
+	BbShmMirror(const BbShmMirror &) = delete;
+	BbShmMirror &operator=(const BbShmMirror &) = delete;
+
+	/// \brief Удалось ли создать сегмент
+	bool isOpen() const
+	{
+		return header != nullptr;
+	}
+
+	// AbstractPrefixObserver interface
+	void onPrefixUpdated(std::string_view aPrefix, std::string_view aEntry, const BbValue &aValue) override;
+	void onPrefixChanged(const BbChange &aChange) override;
+	void onPrefixBatchUpdated(const std::vector<BbChange> &aChanges) override;
+
+private:
+	std::shared_ptr<Blackboard> bb;
+	std::vector<std::string> prefixes;
+	std::string name;
+	uint32_t capacity;
+
+	BbShm::Header *header = nullptr;
+	size_t mappedSize = 0;
+
+	// Писатели BB оповещают из своих потоков, ячейки seqlock допускают одного писателя
+	std::mutex mutex;
+	std::unordered_map<std::string, uint32_t, StrHash, StrEq> slots;
+	std::vector<uint64_t> slotSeq; // Последний записанный номер изменения, старые оповещения отбрасываются
+	std::vector<uint8_t> scratch;
+	bool overflowReported = false;
+
+	bool createSegment();
+	void storeLocked(std::string_view aKey, const BbValue &aValue, uint64_t aSeq, bool aRemoved = false);
+	BbShm::Slot *slotLocked(std::string_view aKey, uint32_t &aIndex);
+};
@@ -0,0 +1,195 @@
+/*!
+@file
+@brief Читатель зеркала Blackboard в разделяемой памяти для сторонних процессов
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "shm/BbShmLayout.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// \brief Читатель зеркала BB
+/// Отображает сегмент только на чтение, после open() чтение не делает ни одного системного вызова
+/// и никак не задерживает процесс-контроллер. Слоты не удаляются и не переезжают, поэтому индекс
+/// слота, найденный один раз через find(), можно опрашивать сколько угодно.
+/// Зависит только от раскладки сегмента, значение разбирается через BbSerializers::at(tag)->fromBinary
+class BbShmReader {
+public:
+	/// \brief Значение слота
+	struct Value {
+		uint32_t tag = 0; // Индекс альтернативы BbValue, 0 - значения нет
+		uint64_t seq = 0; // Номер изменения BB
+		BbShm::Payload payload{};
+
+		std::string_view bytes() const
+		{
+			return {reinterpret_cast<const char *>(payload.data), payload.size};
+		}
+
+		/// \brief Запись удалена из BB, последнее значение больше не действительно
+		bool removed() const
+		{
+			return payload.flags & BbShm::kRemoved;
+		}
+
+		/// \brief В слот поместилось только начало значения, разбирать его как целое нельзя
+		bool truncated() const
+		{
+			return payload.flags & BbShm::kTruncated;
+		}
+	};
+
+	explicit BbShmReader(std::string aName = BbShm::kDefaultName) : name{std::move(aName)}
+	{
+	}
+
+	BbShmReader(const BbShmReader &) = delete;
+	BbShmReader &operator=(const BbShmReader &) = delete;
+
+	~BbShmReader()
+	{
+		close();
+	}
+
+	/// \brief Отобразить сегмент
+	/// \return false если сегмента нет, он еще размечается или записан другой версией
+	bool open()
+	{
+		close();
+
+		const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(BbShm::Header)) {
+			::close(fd);
+			return false;
+		}
+
+		void *mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+
+		base = mapped;
+		mappedSize = static_cast<size_t>(st.st_size);
+
+		const BbShm::Header &h = header();
+		if (h.magic.load(std::memory_order_acquire) != BbShm::kMagic || h.version != BbShm::kVersion
+			|| h.slotSize != sizeof(BbShm::Slot) || BbShm::segmentSize(h.capacity) > mappedSize) {
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void close()
+	{
+		if (base) {
+			::munmap(base, mappedSize);
+			base = nullptr;
+			mappedSize = 0;
+		}
+	}
+
+	bool isOpen() const
+	{
+		return base != nullptr;
+	}
+
+	/// \brief Жив ли писатель
+	/// Перезапущенный контроллер создает новый сегмент, старый после этого надо переоткрыть.
+	/// Делает системный вызов, для периодической проверки, а не для каждого чтения
+	bool writerAlive() const
+	{
+		if (!isOpen()) {
+			return false;
+		}
+
+		const auto pid = static_cast<pid_t>(header().writerPid.load(std::memory_order_acquire));
+		return pid != 0 && (::kill(pid, 0) == 0 || errno == EPERM);
+	}
+
+	/// \brief Номер последнего изменения BB в сегменте, дешевая проверка "что-то поменялось"
+	uint64_t sequence() const
+	{
+		return isOpen() ? header().sequence.load(std::memory_order_acquire) : 0;
+	}
+
+	/// \brief Сколько записей в каталоге
+	size_t size() const
+	{
+		return isOpen() ? header().used.load(std::memory_order_acquire) : 0;
+	}
+
+	/// \brief Имя записи слота
+	std::string_view key(size_t aIndex) const
+	{
+		const char *key = slot(aIndex).key;
+		return {key, ::strnlen(key, BbShm::kKeySize)};
+	}
+
+	/// \brief Найти слот записи
+	/// \return индекс слота или nullopt, если запись не зеркалируется (или еще не появилась)
+	std::optional<size_t> find(std::string_view aKey) const
+	{
+		const size_t count = size();
+		for (size_t i = 0; i < count; ++i) {
+			if (key(i) == aKey) {
+				return i;
+			}
+		}
+		return std::nullopt;
+	}
+
+	/// \brief Прочитать значение слота
+	/// \return false если значение не удалось прочитать согласованно (писатель упал посреди записи)
+	bool read(size_t aIndex, Value &aOut) const
+	{
+		const BbShm::Slot &s = slot(aIndex);
+		aOut.seq = s.changeSeq.load(std::memory_order_acquire);
+
+		const auto tag = s.cell.tryLoad(&aOut.payload, sizeof(aOut.payload), kReadAttempts);
+		if (!tag || aOut.payload.size > BbShm::kValueSize) {
+			return false;
+		}
+
+		aOut.tag = *tag;
+		return true;
+	}
+
+private:
+	static constexpr size_t kReadAttempts = 1000;
+
+	std::string name;
+	void *base = nullptr;
+	size_t mappedSize = 0;
+
+	const BbShm::Header &header() const
+	{
+		return *static_cast<const BbShm::Header *>(base);
+	}
+
+	const BbShm::Slot &slot(size_t aIndex) const
+	{
+		return *BbShm::slotAt(base, static_cast<uint32_t>(aIndex));
+	}
+};
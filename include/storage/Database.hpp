@@ -1,19 +1,21 @@
 #pragma once
 
+#include "core/BlackboardValue.hpp"
+
 #include <drogon/orm/DbClient.h>
 #include <filesystem>
 #include <iostream>
-#include <any>
 #include <string>
 
 class Database {
+public:
 	struct TelemetryValue {
 		std::string type;
 		double value;
 	};
-public:
+
 	explicit Database(const std::string &dbPath);
-	void insertAny(const std::string &key, const std::any &value);
+	void insertValue(const std::string &key, const BbValue &value);
 	void insertText(unsigned level, const std::string &msg);
 
 	std::vector<std::tuple<std::string, std::string, double, std::string>>
@@ -22,12 +24,14 @@ public:
 				 const std::string &toTs,
 				 size_t limit = 1000);
 
+	/// \brief Представление значения BB для таблицы telemetry
+	static TelemetryValue convertValue(const BbValue &a);
+
 private:
 	drogon::orm::DbClientPtr dbClient;
 	std::string dbFilePath;
 
 
 
-	TelemetryValue convertAny(const std::any &a);
 	void initSchema();
 };
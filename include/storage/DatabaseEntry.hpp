@@ -2,24 +2,37 @@
 
 #include "storage/Database.hpp"
 #include "core/Blackboard.hpp"
+#include <chrono>
 #include <memory>
 #include <string>
 
 class DatabaseEntry : public AbstractEntryObserver {
 public:
-	DatabaseEntry(std::string aName, std::shared_ptr<Blackboard> aBb, std::shared_ptr<Database> aDb):
+	/// \param aMinInterval не чаще одной записи в БД за интервал, 0 - каждое изменение
+	DatabaseEntry(std::string aName, std::shared_ptr<Blackboard> aBb, std::shared_ptr<Database> aDb,
+		std::chrono::milliseconds aMinInterval = std::chrono::milliseconds{0}):
 		name{aName},
 		bb{aBb},
 		db{aDb}
 	{
-		bb->subscribe(name, this);
+		// Запись в БД синхронная, поэтому писатель BB ее не ждет
+		bb->subscribe(name, this, {Delivery::Async, 256, aMinInterval});
 	}
 
+	~DatabaseEntry()
+	{
+		// Отложенное значение досылается сейчас, пока объект еще жив, а не потоком BB после разрушения
+		bb->unsubscribeAll(this);
+	}
+
+	DatabaseEntry(const DatabaseEntry &) = delete;
+	DatabaseEntry &operator=(const DatabaseEntry &) = delete;
+
 	// AbstractEntryObserver interface
-	void onEntryUpdated(std::string_view aEntry, const std::any &aValue) override
+	void onEntryUpdated(std::string_view aEntry, const BbValue &aValue) override
 	{
 		std::string entry = std::string(aEntry);
-		db->insertAny(entry, aValue);
+		db->insertValue(entry, aValue);
 	}
 
 private:
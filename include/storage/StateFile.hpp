@@ -0,0 +1,90 @@
+/*!
+@file
+@brief Бинарный файл состояния BB для теплого рестарта
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/Blackboard.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// \brief Файл состояния для теплого рестарта
+/// Сохраняет записи BB с выбранными префиксами (например pump.int.) в компактный бинарный файл.
+/// Запись атомарная: пишется временный файл, fsync, затем rename поверх старого, поэтому
+/// после падения на диске всегда целый файл. При старте файл отображается в память и
+/// применяется к BB одним пакетом.
+///
+/// Формат (little-endian, как у целевой платформы):
+/// заголовок {magic, версия формата, число записей, время сохранения, контрольная сумма записей},
+/// затем записи {длина имени u16, тег типа u8, резерв u8, длина значения u32, имя, значение}.
+/// Тег типа - индекс альтернативы BbValue, тривиальные типы хранятся побайтово, строки - как есть
+class StateFile {
+public:
+	/// \param aPath путь до файла
+	/// \param aBb BB
+	/// \param aPrefixes какие префиксы сохранять
+	/// \param aMaxAge состояние старше этого не восстанавливается
+	/// \param aSaveInterval минимальный интервал между сохранениями, бережем SD карту
+	StateFile(std::string aPath, std::shared_ptr<Blackboard> aBb, std::vector<std::string> aPrefixes,
+		std::chrono::seconds aMaxAge = std::chrono::minutes{30}, std::chrono::seconds aSaveInterval = std::chrono::seconds{30});
+
+	/// \brief Сохранить состояние, если BB изменился с прошлого сохранения
+	/// \param aForce сохранить не дожидаясь интервала (например при остановке)
+	/// \return true если файл записан или уже актуален
+	bool save(bool aForce = false);
+
+	/// \brief Восстановить состояние из файла
+	/// \return количество восстановленных записей
+	size_t restore();
+
+	/// \brief Сколько прошло с сохранения восстановленного состояния
+	/// Остатки таймеров в файле верны на момент сохранения, владелец вычитает из них это время
+	/// \return 0 если состояние не восстанавливалось
+	std::chrono::milliseconds restoredAge() const;
+
+private:
+	static constexpr uint32_t kMagic = 0x54535748; // "HWST"
+	static constexpr uint16_t kFormatVersion = 1;
+
+#pragma pack(push, 1)
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t variantSize; // Число альтернатив BbValue, защита от смены набора типов
+		uint32_t count;
+		int64_t savedAt;      // Секунды unix времени
+		uint64_t checksum;    // FNV-1a по записям
+	};
+
+	struct RecordHeader {
+		uint16_t keyLength;
+		uint8_t tag;
+		uint8_t reserved;
+		uint32_t valueLength;
+	};
+#pragma pack(pop)
+
+	std::string path;
+	std::shared_ptr<Blackboard> bb;
+	std::vector<std::string> prefixes;
+	std::chrono::seconds maxAge;
+	std::chrono::seconds saveInterval;
+	std::chrono::steady_clock::time_point lastSave;
+	uint64_t savedSequence;
+	std::optional<std::chrono::system_clock::time_point> restoredSavedAt;
+
+	static void appendValue(std::vector<uint8_t> &aOut, const BbValue &aValue);
+	static bool decodeValue(uint8_t aTag, const uint8_t *aData, size_t aSize, BbValue &aOut);
+	static uint64_t checksum(const uint8_t *aData, size_t aSize);
+	bool writeAtomically(const std::vector<uint8_t> &aData) const;
+};
@@ -0,0 +1,52 @@
+/*!
+@file
+@brief История записи из двух уровней: кольца в памяти BB и таблица telemetry
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#pragma once
+
+#include "core/Blackboard.hpp"
+#include "core/HistoryRing.hpp"
+#include "storage/Database.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \brief Единый запрос истории
+/// Последние минуты отдаются из кольца BB (Blackboard::enableHistory) без обращения к SQLite,
+/// в БД идет только часть интервала раньше того, что покрывает кольцо. Для записей без кольца
+/// запрос целиком уходит в БД. БД необязательна, без нее доступна только история в памяти
+class TelemetryHistory {
+public:
+	struct Result {
+		std::string type; // Тип значения как в таблице telemetry, пусто если неизвестен
+		std::vector<HistorySample> samples; // По возрастанию времени
+		size_t fromMemory = 0; // Сколько отсчетов пришло из кольца
+	};
+
+	TelemetryHistory(std::shared_ptr<Blackboard> aBb, std::shared_ptr<Database> aDb);
+
+	/// \brief История записи в интервале [aFromMs, aToMs]
+	/// \param aKey Ключ
+	/// \param aFromMs начало, Unix время в мс
+	/// \param aToMs конец включительно
+	/// \param aLimit не больше стольких первых отсчетов, как и у Database::queryHistory
+	Result query(const std::string &aKey, int64_t aFromMs, int64_t aToMs, size_t aLimit = 1000) const;
+
+	/// \brief Время из таблицы telemetry (UTC, "YYYY-MM-DD HH:MM:SS") в мс
+	/// \return -1 если строка не разобрана
+	static int64_t parseTimestamp(const std::string &aTimestamp);
+
+	/// \brief Время в мс в формат таблицы telemetry, доли секунды отбрасываются
+	static std::string formatTimestamp(int64_t aTimestampMs);
+
+private:
+	std::shared_ptr<Blackboard> bb;
+	std::shared_ptr<Database> db;
+};
@@ -10,7 +10,7 @@
 /// \brief Абстрактный микродевайс
 class UDevice {
 	std::shared_ptr<Blackboard> bb;
-	std::string valueName;
+	KeyId valueKey;
 
 	BlackboardEntry<DeviceStatus> status;
 	BlackboardEntry<std::string> statusStr;
@@ -18,7 +18,7 @@ class UDevice {
 public:
 	UDevice(const std::string &aName, std::shared_ptr<Blackboard> aBb):
 		bb{aBb},
-		valueName{Names::getValueNameByDevice(aName)},
+		valueKey{aBb->registerKey(Names::getValueNameByDevice(aName))},
 
 		status{Names::getStatusNameByDevice(aName), aBb},
 		statusStr{Names::getStatusStrByDevice(aName), aBb}
@@ -29,7 +29,7 @@ public:
 	template<typename T>
 	void updateValue(T aValue)
 	{
-		bb->set<T>(valueName, std::move(aValue));
+		bb->set<T>(valueKey, std::move(aValue));
 	}
 
 	void updateStatus(DeviceStatus aStatus)
@@ -41,4 +41,20 @@ public:
 	{
 		statusStr = aStr;
 	}
+
+	template<typename T>
+	void updateValue(Blackboard::Batch &aBatch, T aValue)
+	{
+		aBatch.set<T>(valueKey, std::move(aValue));
+	}
+
+	void updateStatus(Blackboard::Batch &aBatch, DeviceStatus aStatus)
+	{
+		status.set(aBatch, aStatus);
+	}
+
+	void updateStatusStr(Blackboard::Batch &aBatch, const std::string &aStr)
+	{
+		statusStr.set(aBatch, aStr);
+	}
 };
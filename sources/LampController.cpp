@@ -10,16 +10,16 @@
 #include "LampController.hpp"
 #include "core/Types.hpp"
 #include "logger/Logger.hpp"
-#include <any>
 #include <chrono>
 #include <ctime>
-#include <thread>
 
 using namespace std::chrono;
 
-LampController::LampController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus) :
+LampController::LampController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus,
+	std::shared_ptr<Scheduler> aScheduler) :
 	bb{aBb},
 	bus{aEvBus},
+	scheduler{aScheduler},
 
 	enabled{Names::kLampEnabled, aBb},
 	state{Names::getValueNameByDevice(Names::kLampDev), aBb},
@@ -65,8 +65,7 @@ bool LampController::ready() const
 void LampController::start()
 {
 	started = true;
-	thread = std::thread(&LampController::process, this);
-	thread.detach();
+	scheduler->every("lamp", std::chrono::seconds{10}, [this]() { return process(); }, std::chrono::milliseconds{0});
 }
 
 bool LampController::isStarted() const
@@ -74,7 +73,7 @@ bool LampController::isStarted() const
 	return started;
 }
 
-void LampController::onEntryUpdated(std::string_view entry, const std::any &)
+void LampController::onEntryUpdated(std::string_view entry, const BbValue &)
 {
 	if (entry == status.getName()) {
 		if (status() != DeviceStatus::NotFound) {
@@ -83,36 +82,32 @@ void LampController::onEntryUpdated(std::string_view entry, const std::any &)
 	}
 }
 
-void LampController::process()
+bool LampController::process()
 {
-	while(started) {
-		const bool desiredLampState = isTimeForLampActive();
+	const bool desiredLampState = isTimeForLampActive();
 
-		if (maintance()) {
-			std::this_thread::sleep_for(std::chrono::seconds{1});
-			continue;
-		}
-
-		// Выключение потока
-		if (status() == DeviceStatus::NotFound) {
-			monitor.setFlag(MonitorFlags::LampControllerLost);
-			started = false;
-			break;
-		}
+	if (maintance()) {
+		return true;
+	}
 
-		if (state() != desiredLampState) {
-			sendCommand(desiredLampState);
-		}
+	// Выключение контроллера
+	if (status() == DeviceStatus::NotFound) {
+		monitor.setFlag(MonitorFlags::LampControllerLost);
+		started = false;
+		HYDRO_LOG_ERROR("Lamp controller stopped by error!");
+		return false;
+	}
 
-		std::this_thread::sleep_for(std::chrono::seconds{10});
+	if (state() != desiredLampState) {
+		sendCommand(desiredLampState);
 	}
 
-	HYDRO_LOG_ERROR("Lamp controller stopped by error!");
+	return true;
 }
 
 void LampController::sendCommand(bool aNewLampState)
 {
-	bus->sendEvent(EventType::LampSetState, aNewLampState);
+	bus->sendEvent(Events::LampSetState{aNewLampState});
 }
 
 bool LampController::isTimeForLampActive()
@@ -12,15 +12,16 @@
 #include "core/MonitorEntry.hpp"
 #include "core/Types.hpp"
 #include "logger/Logger.hpp"
-#include <any>
+#include <algorithm>
 #include <chrono>
 #include <mutex>
 #include <string>
-#include <thread>
 
-PumpController::PumpController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus) :
+PumpController::PumpController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus,
+	std::shared_ptr<Scheduler> aScheduler) :
 	bb{aBb},
 	bus{aEvBus},
+	scheduler{aScheduler},
 	monitor{aBb},
 
 	enabled{Names::kPumpEnabled, aBb},
@@ -50,7 +51,8 @@ PumpController::PumpController(std::shared_ptr<Blackboard> aBb, std::shared_ptr<
 	lastTelemetryTime{0},
 	fillingCheckEn{false},
 
-	startedFlag{false}
+	startedFlag{false},
+	resumed{false}
 {
 	mode.subscribe(this);
 	upperStatus.subscribe(this);
@@ -95,11 +97,30 @@ bool PumpController::ready() const
 	}
 }
 
-void PumpController::start()
+void PumpController::start(std::chrono::milliseconds aDowntime)
 {
+	// Продолжаем текущий цикл с того места, где он был прерван: после теплого рестарта
+	// nextSwitchTime и plainType восстановлены из файла состояния, а пока процесс не работал,
+	// фаза шла дальше - простой вычитается из остатка
+	{
+		std::lock_guard lock(mutex);
+		const auto now = std::chrono::duration_cast<milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+		const milliseconds actionTime = plainType() == PlainType::Irrigation ? pumpOnTime() : pumpOffTime();
+		const milliseconds downtime = resumed ? milliseconds{0} : std::max(aDowntime, milliseconds{0});
+		const milliseconds remaining = nextSwitchTime() - downtime;
+		resumed = true;
+
+		if (remaining > milliseconds{0} && remaining < actionTime) {
+			lastActionTime = now - (actionTime - remaining);
+		} else if (downtime > milliseconds{0} && remaining <= milliseconds{0}) {
+			// Фаза закончилась за время простоя, переключаемся на первом шаге
+			HYDRO_LOG_INFO("Pump Controller: phase expired during downtime, switching now");
+			lastActionTime = milliseconds{0};
+		}
+	}
+
 	startedFlag = true;
-	thread = std::thread(&PumpController::process, this);
-	thread.detach();
+	scheduler->every("pump", std::chrono::milliseconds{200}, [this]() { return process(); }, std::chrono::milliseconds{0});
 
 	HYDRO_LOG_INFO("Pump Controller started!");
 }
@@ -109,7 +130,7 @@ bool PumpController::isStarted() const
 	return startedFlag;
 }
 
-void PumpController::onEntryUpdated(std::string_view entry, const std::any &)
+void PumpController::onEntryUpdated(std::string_view entry, const BbValue &)
 {
 	if (entry == mode.getName()) {
 		std::lock_guard lock(mutex);
@@ -125,65 +146,62 @@ void PumpController::onEntryUpdated(std::string_view entry, const std::any &)
 	}
 }
 
-void PumpController::process()
+bool PumpController::process()
 {
-	while (startedFlag) {
-		auto now = std::chrono::steady_clock::now();
-		std::chrono::milliseconds time = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-
-		if (maintance()) {
-			std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-			continue;
-		}
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::milliseconds time = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
 
-		std::lock_guard lock(mutex);
+	if (maintance()) {
+		return true;
+	}
 
-		if (pumpStatus() == DeviceStatus::NotFound) {
-			if (enabled()) {
-				monitor.setFlag(MonitorFlags::PumpControllerLost);
-			}
+	std::lock_guard lock(mutex);
 
-			std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-			startedFlag = false;
-			break;
+	if (pumpStatus() == DeviceStatus::NotFound) {
+		if (enabled()) {
+			monitor.setFlag(MonitorFlags::PumpControllerLost);
 		}
 
-		switch (mode()) {
-			case PumpModes::EBBNormal:
-				processEBBNormalMode(time);
-				break;
-			case PumpModes::EBBSwing:
-				processEBBSwingMode(time);
-				break;
-			case PumpModes::Dripping:
-				processDripMode(time);
-				break;
-			default:
-				break;
-		}
+		startedFlag = false;
+		HYDRO_LOG_ERROR("Pump controller stopped due an error!");
+		return false;
+	}
+
+	switch (mode()) {
+		case PumpModes::EBBNormal:
+			processEBBNormalMode(time);
+			break;
+		case PumpModes::EBBSwing:
+			processEBBSwingMode(time);
+			break;
+		case PumpModes::Dripping:
+			processDripMode(time);
+			break;
+		default:
+			break;
+	}
 
-		// Вывод доп информации
-		if (time > lastTelemetryTime + std::chrono::milliseconds{200}) {
-			lastTelemetryTime = time;
+	// Вывод доп информации
+	if (time >= lastTelemetryTime + std::chrono::milliseconds{200}) {
+		lastTelemetryTime = time;
 
-			const milliseconds elapsed = time - lastActionTime;
-			const milliseconds actionTime = plainType() == PlainType::Irrigation ? pumpOnTime() : pumpOffTime();
-			nextSwitchTime = std::chrono::duration_cast<seconds>(actionTime - elapsed);
-		}
+		const milliseconds elapsed = time - lastActionTime;
+		const milliseconds actionTime = plainType() == PlainType::Irrigation ? pumpOnTime() : pumpOffTime();
+		nextSwitchTime = std::chrono::duration_cast<seconds>(actionTime - elapsed);
+	}
 
-		// Обработка требуемого состояния насоса
-		if (time > lastValidatorTime + validTime()) {
-			lastValidatorTime = time;
+	// Обработка требуемого состояния насоса
+	if (time > lastValidatorTime + validTime()) {
+		lastValidatorTime = time;
 
-			if (state() != desiredState()) {
-				bus->sendEvent(EventType::PumpSetState, desiredState());
-			}
+		if (state() != desiredState()) {
+			// Выключение насоса - команда безопасности, она не должна ждать рутинные события
+			const bool desired = desiredState();
+			bus->sendEvent(Events::PumpSetState{desired}, desired ? EventPriority::Command : EventPriority::Safety);
 		}
-
-		std::this_thread::sleep_for(std::chrono::milliseconds{200});
 	}
 
-	HYDRO_LOG_ERROR("Pump controller stopped due an error!");
+	return true;
 }
 
 void PumpController::updateMode(PumpModes)
@@ -5,9 +5,11 @@
 
 using namespace HydroRS;
 
-RadioHandler::RadioHandler(std::string aSerial, RS::DeviceVersion &aHubVersion, std::shared_ptr<Blackboard> aBb, std::shared_ptr<EventBus> aEvBus) :
+RadioHandler::RadioHandler(std::string aSerial, RS::DeviceVersion &aHubVersion, std::shared_ptr<Blackboard> aBb,
+	std::shared_ptr<EventBus> aEvBus, std::shared_ptr<Scheduler> aScheduler) :
 	bb{aBb},
 	bus{aEvBus},
+	scheduler{aScheduler},
 	driver{aSerial, 115200},
 	proxy{&driver, bb},
 	hub{aHubVersion, proxy},
@@ -15,17 +17,20 @@ RadioHandler::RadioHandler(std::string aSerial, RS::DeviceVersion &aHubVersion,
 	telemPipe{Names::kTelemPipe, aBb}
 {
 	hub.registerObserver(this);
-	bus->registerObserver(this);
+	bus->registerObserver(EventType::PumpSetState, this);
+	bus->registerObserver(EventType::LampSetState, this);
 }
 
 void RadioHandler::start()
 {
-	proxy.start();
+	proxy.start(*scheduler);
 
 	receive = std::thread(&RadioHandler::receiveThread, this);
 	receive.detach();
-	transmit = std::thread(&RadioHandler::processThread, this);
-	transmit.detach();
+	scheduler->every("radio", std::chrono::milliseconds{50}, [this]() {
+		process();
+		return true;
+	});
 
 	createSchedules();
 }
@@ -49,6 +54,7 @@ void RadioHandler::receiveThread()
 		uint8_t packet[255];
 
 		while (size_t pktLen = proxy.read(packet, sizeof(packet))) {
+			std::lock_guard lock(hubMutex);
 			hub.update(packet, pktLen);
 		}
 	}
@@ -56,15 +62,14 @@ void RadioHandler::receiveThread()
 
 void RadioHandler::probe()
 {
+	std::lock_guard lock(hubMutex);
 	return hub.probeAll(true, true);
 }
 
-void RadioHandler::processThread()
+void RadioHandler::process()
 {
-	while (true) {
-		hub.process(TimeWrapper::milliseconds());
-		std::this_thread::sleep_for(std::chrono::milliseconds{50});
-	}
+	std::lock_guard lock(hubMutex);
+	hub.process(TimeWrapper::milliseconds());
 }
 
 void RadioHandler::onAckNotReceivedEv(const std::string &aName, RS::MessageType)
@@ -127,25 +132,23 @@ RS::Result RadioHandler::fileWriteResultEv(const std::string &aName, RS::Result
 
 void RadioHandler::deviceHealthReceivedEv(const std::string &aName, RS::Health aHealth, uint16_t aFlags)
 {
-	bb->set(aName + ".rs" + ".health", aHealth);
-	bb->set(aName + ".rs" + ".flags", aFlags);
+	bb->set(aName + ".rs" + ".health", static_cast<int>(aHealth));
+	bb->set(aName + ".rs" + ".flags", static_cast<unsigned>(aFlags));
 }
 
-void RadioHandler::handleEvent(EventType aEv, std::any &aValue)
+void RadioHandler::handleEvent(const BusEvent &aEvent)
 {
-	switch (aEv) {
-		case EventType::LampSetState:
-			hub.sendCmdToDevice(Names::kMultiControllerDev, static_cast<uint8_t>(Commands::SetLampState), std::any_cast<bool>(aValue));
-			break;
-		case EventType::PumpSetState:
-			hub.sendCmdToDevice(Names::kMultiControllerDev, static_cast<uint8_t>(Commands::SetPumpState), std::any_cast<bool>(aValue));
-			break;
-		default:
-			break;
+	std::lock_guard lock(hubMutex);
+
+	if (const auto *lamp = aEvent.as<Events::LampSetState>()) {
+		hub.sendCmdToDevice(Names::kMultiControllerDev, static_cast<uint8_t>(Commands::SetLampState), lamp->enabled);
+	} else if (const auto *pump = aEvent.as<Events::PumpSetState>()) {
+		hub.sendCmdToDevice(Names::kMultiControllerDev, static_cast<uint8_t>(Commands::SetPumpState), pump->enabled);
 	}
 }
 
 void RadioHandler::createSchedules()
 {
+	std::lock_guard lock(hubMutex);
 	hub.createSchedRequest(Names::kMultiControllerDev, static_cast<uint8_t>(Requests::RequestTelemetry), sizeof(MultiControllerTelem), 500ms);
 }
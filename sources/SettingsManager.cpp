@@ -13,19 +13,19 @@ SettingsManager::SettingsManager(std::shared_ptr<Blackboard> aBlackboard,
 
 SettingsManager::~SettingsManager()
 {
-	for (const auto &[key, _] : schema) {
-		blackboard->unsubscribe(key, this);
-	}
+	// Заодно освобождает ящик асинхронной доставки, иначе его унаследует объект по тому же адресу
+	blackboard->unsubscribeAll(this);
 }
 
 void SettingsManager::registerSetting(
-	const std::string &key, SettingType type, SettingValue defaultValue, const std::string &desc)
+	const std::string &key, SettingType type, SettingValue defaultValue, const std::string &desc, std::string_view unit)
 {
-	SettingDefinition def{key, type, defaultValue, desc};
+	SettingDefinition def{key, type, defaultValue, desc, std::string{unit}};
 	schema[key] = def;
 	defaults[key] = defaultValue;
 
-	blackboard->subscribe(key, this);
+	// Сохранение переписывает файл, поэтому оповещения приходят асинхронно
+	blackboard->subscribe(key, this, {Delivery::Async});
 }
 
 bool SettingsManager::load()
@@ -103,7 +103,7 @@ bool SettingsManager::load()
 	return result;
 }
 
-void SettingsManager::onEntryUpdated(std::string_view entry, const std::any & /*value*/)
+void SettingsManager::onEntryUpdated(std::string_view entry, const BbValue & /*value*/)
 {
 	if (!initialized) {
 		return;
@@ -186,6 +186,10 @@ json SettingsManager::generateSchema() const
 			},
 			def.defaultValue);
 
+		if (!def.unit.empty()) {
+			d["unit"] = def.unit;
+		}
+
 		out[key] = d;
 	}
 
@@ -198,31 +202,33 @@ json SettingsManager::getConfigForSaving() const
 	cfg["schema"] = generateSchema();
 
 	json vals;
+	// Значения берутся из одного среза, чтобы в файл не попало состояние посреди пакетной записи
+	const auto snap = blackboard->snapshot();
 
 	for (const auto &[key, def] : schema) {
 		switch (def.type) {
 			case SettingType::BOOL:
-				if (auto v = blackboard->get<bool>(key)) vals[key] = *v;
+				if (auto v = snap->get<bool>(key)) vals[key] = *v;
 				break;
 
 			case SettingType::INT:
-				if (auto v = blackboard->get<int>(key)) vals[key] = *v;
+				if (auto v = snap->get<int>(key)) vals[key] = *v;
 				break;
 
 			case SettingType::FLOAT:
-				if (auto v = blackboard->get<float>(key)) vals[key] = *v;
+				if (auto v = snap->get<float>(key)) vals[key] = *v;
 				break;
 
 			case SettingType::STRING:
-				if (auto v = blackboard->get<std::string>(key)) vals[key] = *v;
+				if (auto v = snap->get<std::string>(key)) vals[key] = *v;
 				break;
 
 			case SettingType::SECONDS:
-				if (auto v = blackboard->get<std::chrono::seconds>(key)) vals[key] = v->count();
+				if (auto v = snap->get<std::chrono::seconds>(key)) vals[key] = v->count();
 				break;
 
 			case SettingType::MSECONDS:
-				if (auto v = blackboard->get<std::chrono::milliseconds>(key)) vals[key] = v->count();
+				if (auto v = snap->get<std::chrono::milliseconds>(key)) vals[key] = v->count();
 				break;
 		}
 	}
@@ -0,0 +1,191 @@
+#include "shm/BbShmMirror.hpp"
+#include "BbSerializers.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(BbTypes::kTrivialSize <= BbShm::kValueSize, "Shared memory slot is too small for BbValue");
+
+BbShmMirror::BbShmMirror(std::shared_ptr<Blackboard> aBb, std::vector<std::string> aPrefixes, std::string aName,
+	uint32_t aCapacity) :
+	bb{aBb},
+	prefixes{std::move(aPrefixes)},
+	name{std::move(aName)},
+	capacity{std::max<uint32_t>(aCapacity, 1)}
+{
+	if (!createSegment()) {
+		return;
+	}
+
+	slotSeq.assign(capacity, 0);
+	scratch.reserve(BbShm::kValueSize);
+
+	// Сначала подписка, затем текущие значения: изменение, пришедшее между ними, новее среза
+	// и не будет затерто, см. storeLocked
+	for (const auto &prefix : prefixes) {
+		bb->subscribeToPrefix(prefix, this);
+	}
+
+	const auto snapshot = bb->snapshot();
+	std::lock_guard lock(mutex);
+	for (const auto &prefix : prefixes) {
+		for (const auto &entry : snapshot->byPrefix(prefix)) {
+			storeLocked(entry.key, entry.value(), snapshot->sequence());
+		}
+	}
+
+	HYDRO_LOG_INFO("BbShmMirror: mirroring into " + name + ", " + std::to_string(capacity) + " slots");
+}
+
+BbShmMirror::~BbShmMirror()
+{
+	if (!header) {
+		return;
+	}
+
+	bb->unsubscribeAll(static_cast<AbstractPrefixObserver *>(this));
+
+	header->writerPid.store(0, std::memory_order_release);
+	::munmap(header, mappedSize);
+	::shm_unlink(name.c_str());
+}
+
+void BbShmMirror::onPrefixUpdated(std::string_view aPrefix, std::string_view aEntry, const BbValue &aValue)
+{
+	onPrefixChanged(BbChange{aPrefix, aEntry, &aValue});
+}
+
+void BbShmMirror::onPrefixChanged(const BbChange &aChange)
+{
+	std::lock_guard lock(mutex);
+	storeLocked(aChange.entry, *aChange.value, aChange.seq, aChange.removed);
+}
+
+void BbShmMirror::onPrefixBatchUpdated(const std::vector<BbChange> &aChanges)
+{
+	std::lock_guard lock(mutex);
+	for (const auto &change : aChanges) {
+		storeLocked(change.entry, *change.value, change.seq, change.removed);
+	}
+}
+
+bool BbShmMirror::createSegment()
+{
+	// Сегмент от прошлого запуска (например после падения) не переиспользуем: его читатели
+	// держат старое отображение и по writerPid поймут, что надо переоткрыть
+	::shm_unlink(name.c_str());
+
+	const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		HYDRO_LOG_ERROR("BbShmMirror: shm_open failed for " + name + ": " + std::strerror(errno));
+		return false;
+	}
+
+	const size_t size = BbShm::segmentSize(capacity);
+	if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		HYDRO_LOG_ERROR("BbShmMirror: ftruncate failed: " + std::string{std::strerror(errno)});
+		::close(fd);
+		::shm_unlink(name.c_str());
+		return false;
+	}
+
+	void *mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED) {
+		HYDRO_LOG_ERROR("BbShmMirror: mmap failed: " + std::string{std::strerror(errno)});
+		::shm_unlink(name.c_str());
+		return false;
+	}
+
+	// Память после ftruncate нулевая, объекты только создаются на своих местах
+	auto *h = new (mapped) BbShm::Header{};
+	for (uint32_t i = 0; i < capacity; ++i) {
+		new (BbShm::slotAt(mapped, i)) BbShm::Slot{};
+	}
+
+	h->version = BbShm::kVersion;
+	h->capacity = capacity;
+	h->slotSize = sizeof(BbShm::Slot);
+	h->writerPid.store(static_cast<uint32_t>(::getpid()), std::memory_order_relaxed);
+	h->magic.store(BbShm::kMagic, std::memory_order_release);
+
+	header = h;
+	mappedSize = size;
+	return true;
+}
+
+void BbShmMirror::storeLocked(std::string_view aKey, const BbValue &aValue, uint64_t aSeq, bool aRemoved)
+{
+	// Удаление пишется только в уже занятый слот, под удаленную запись слот не заводится
+	const bool removed = aRemoved || !BbTypes::hasValue(aValue);
+	if (removed && slots.find(aKey) == slots.end()) {
+		return;
+	}
+
+	uint32_t index;
+	BbShm::Slot *slot = slotLocked(aKey, index);
+	if (!slot) {
+		return;
+	}
+
+	// Оповещения разных писателей могут прийти не по порядку, старое значение не кладем поверх нового.
+	// Номер 0 - оповещение без номера, его принимаем всегда
+	if (aSeq != 0 && aSeq < slotSeq[index]) {
+		return;
+	}
+	slotSeq[index] = std::max(slotSeq[index], aSeq);
+
+	scratch.clear();
+	BbShm::Payload payload{};
+	if (removed) {
+		payload.flags = BbShm::kRemoved;
+	} else {
+		BbSerializers::of(aValue).toBinary(aValue, scratch);
+		if (scratch.size() > BbShm::kValueSize) {
+			payload.flags = BbShm::kTruncated;
+		}
+	}
+
+	payload.size = static_cast<uint32_t>(std::min(scratch.size(), BbShm::kValueSize));
+	std::memcpy(payload.data, scratch.data(), payload.size);
+
+	slot->cell.store(removed ? 0 : static_cast<uint32_t>(aValue.index()), &payload, sizeof(payload));
+	slot->changeSeq.store(slotSeq[index], std::memory_order_release);
+
+	if (slotSeq[index] > header->sequence.load(std::memory_order_relaxed)) {
+		header->sequence.store(slotSeq[index], std::memory_order_release);
+	}
+}
+
+BbShm::Slot *BbShmMirror::slotLocked(std::string_view aKey, uint32_t &aIndex)
+{
+	if (auto it = slots.find(aKey); it != slots.end()) {
+		aIndex = it->second;
+		return BbShm::slotAt(header, aIndex);
+	}
+
+	const uint32_t used = header->used.load(std::memory_order_relaxed);
+	if (used == capacity || aKey.size() >= BbShm::kKeySize) {
+		if (!overflowReported) {
+			overflowReported = true;
+			HYDRO_LOG_ERROR("BbShmMirror: cannot mirror " + std::string{aKey} + ", segment is full or key is too long");
+		}
+		return nullptr;
+	}
+
+	// Имя пишется до публикации слота, читатель видит только слоты с готовым именем
+	BbShm::Slot *slot = BbShm::slotAt(header, used);
+	std::memcpy(slot->key, aKey.data(), aKey.size());
+	header->used.store(used + 1, std::memory_order_release);
+
+	slots.emplace(std::string{aKey}, used);
+	aIndex = used;
+	return slot;
+}
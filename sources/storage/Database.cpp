@@ -1,4 +1,5 @@
 #include "storage/Database.hpp"
+#include "BbSerializers.hpp"
 
 Database::Database(const std::string &dbPath)
 {
@@ -25,10 +26,10 @@ Database::Database(const std::string &dbPath)
 	initSchema();
 }
 
-void Database::insertAny(const std::string &key, const std::any &value)
+void Database::insertValue(const std::string &key, const BbValue &value)
 {
 	try {
-		auto tv = convertAny(value);
+		auto tv = convertValue(value);
 
 		dbClient->execSqlSync(
 			"INSERT INTO telemetry (key, type, value, timestamp)"
@@ -91,27 +92,14 @@ std::vector<std::tuple<std::string, std::string, double, std::string>> Database:
 	return out;
 }
 
-Database::TelemetryValue Database::convertAny(const std::any &a)
+Database::TelemetryValue Database::convertValue(const BbValue &a)
 {
-	if (a.type() == typeid(bool))
-		return {"bool", std::any_cast<bool>(a) ? 1.0 : 0.0};
+	const auto &serializer = BbSerializers::of(a);
 
-	if (a.type() == typeid(int))
-		return {"int", static_cast<double>(std::any_cast<int>(a))};
+	if (auto number = serializer.toSql(a))
+		return {std::string(serializer.name), *number};
 
-	if (a.type() == typeid(uint32_t))
-		return {"u32", static_cast<double>(std::any_cast<uint32_t>(a))};
-
-	if (a.type() == typeid(uint64_t)) {
-		uint64_t v = std::any_cast<uint64_t>(a);
-
-		return {"u64", static_cast<double>(v)};
-	}
-
-	if (a.type() == typeid(double))
-		return {"double", std::any_cast<double>(a)};
-
-	throw std::runtime_error("Unsupported std::any type");
+	throw std::runtime_error("Unsupported BbValue type: " + std::string(serializer.name));
 }
 
 void Database::initSchema()
@@ -0,0 +1,278 @@
+#include "storage/StateFile.hpp"
+#include "BbSerializers.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <variant>
+
+namespace {
+
+/// \brief Отображение файла в память только на чтение
+class MappedFile {
+public:
+	explicit MappedFile(const std::string &aPath)
+	{
+		const int fd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+
+		struct stat st{};
+		if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *ptr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED) {
+				data = static_cast<const uint8_t *>(ptr);
+				size = static_cast<size_t>(st.st_size);
+			}
+		}
+
+		::close(fd);
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	~MappedFile()
+	{
+		if (data) {
+			::munmap(const_cast<uint8_t *>(data), size);
+		}
+	}
+
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+};
+
+} // namespace
+
+StateFile::StateFile(std::string aPath, std::shared_ptr<Blackboard> aBb, std::vector<std::string> aPrefixes,
+	std::chrono::seconds aMaxAge, std::chrono::seconds aSaveInterval) :
+	path{std::move(aPath)},
+	bb{aBb},
+	prefixes{std::move(aPrefixes)},
+	maxAge{aMaxAge},
+	saveInterval{aSaveInterval},
+	lastSave{},
+	savedSequence{0},
+	restoredSavedAt{}
+{
+}
+
+bool StateFile::save(bool aForce)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (!aForce && lastSave != std::chrono::steady_clock::time_point{} && now - lastSave < saveInterval) {
+		return true;
+	}
+
+	const auto snap = bb->snapshot();
+	if (savedSequence != 0 && snap->sequence() == savedSequence) {
+		return true;
+	}
+
+	std::vector<uint8_t> records;
+	uint32_t count = 0;
+
+	for (const auto &prefix : prefixes) {
+		for (const auto &entry : snap->byPrefix(prefix)) {
+			std::vector<uint8_t> value;
+			appendValue(value, entry.value());
+			if (value.empty() && !std::holds_alternative<std::string>(entry.value())) {
+				continue;
+			}
+
+			RecordHeader record{};
+			record.keyLength = static_cast<uint16_t>(entry.key.size());
+			record.tag = static_cast<uint8_t>(entry.value().index());
+			record.valueLength = static_cast<uint32_t>(value.size());
+
+			const auto *raw = reinterpret_cast<const uint8_t *>(&record);
+			records.insert(records.end(), raw, raw + sizeof(record));
+			records.insert(records.end(), entry.key.begin(), entry.key.end());
+			records.insert(records.end(), value.begin(), value.end());
+			++count;
+		}
+	}
+
+	Header header{};
+	header.magic = kMagic;
+	header.version = kFormatVersion;
+	header.variantSize = static_cast<uint16_t>(std::variant_size_v<BbValue>);
+	header.count = count;
+	header.savedAt = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	header.checksum = checksum(records.data(), records.size());
+
+	std::vector<uint8_t> file(sizeof(header));
+	std::memcpy(file.data(), &header, sizeof(header));
+	file.insert(file.end(), records.begin(), records.end());
+
+	if (!writeAtomically(file)) {
+		return false;
+	}
+
+	savedSequence = snap->sequence();
+	lastSave = now;
+	return true;
+}
+
+size_t StateFile::restore()
+{
+	const MappedFile file{path};
+	if (!file.data) {
+		HYDRO_LOG_INFO("StateFile: no saved state at " + path);
+		return 0;
+	}
+
+	if (file.size < sizeof(Header)) {
+		HYDRO_LOG_ERROR("StateFile: file is truncated");
+		return 0;
+	}
+
+	Header header;
+	std::memcpy(&header, file.data, sizeof(header));
+
+	if (header.magic != kMagic || header.version != kFormatVersion
+		|| header.variantSize != std::variant_size_v<BbValue>) {
+		HYDRO_LOG_ERROR("StateFile: incompatible file format, ignoring");
+		return 0;
+	}
+
+	const uint8_t *records = file.data + sizeof(Header);
+	const size_t recordsSize = file.size - sizeof(Header);
+
+	if (checksum(records, recordsSize) != header.checksum) {
+		HYDRO_LOG_ERROR("StateFile: checksum mismatch, ignoring");
+		return 0;
+	}
+
+	const auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+	if (now - std::chrono::seconds{header.savedAt} > maxAge) {
+		HYDRO_LOG_INFO("StateFile: saved state is too old, ignoring");
+		return 0;
+	}
+
+	auto batch = bb->batch();
+	size_t offset = 0;
+	size_t restored = 0;
+
+	for (uint32_t i = 0; i < header.count; ++i) {
+		RecordHeader record;
+		if (recordsSize - offset < sizeof(record)) {
+			break;
+		}
+		std::memcpy(&record, records + offset, sizeof(record));
+		offset += sizeof(record);
+
+		if (recordsSize - offset < size_t{record.keyLength} + record.valueLength) {
+			break;
+		}
+
+		const std::string_view key{reinterpret_cast<const char *>(records + offset), record.keyLength};
+		offset += record.keyLength;
+		const uint8_t *valueData = records + offset;
+		offset += record.valueLength;
+
+		BbValue value;
+		if (!decodeValue(record.tag, valueData, record.valueLength, value)) {
+			HYDRO_LOG_ERROR("StateFile: can't decode " + std::string{key});
+			continue;
+		}
+
+		std::visit(
+			[&](auto &&v) {
+				if constexpr (!std::is_same_v<std::decay_t<decltype(v)>, std::monostate>) {
+					batch.set(key, std::move(v));
+				}
+			},
+			std::move(value));
+		++restored;
+	}
+
+	batch.commit();
+	savedSequence = bb->currentSequence();
+	restoredSavedAt = std::chrono::system_clock::time_point{std::chrono::seconds{header.savedAt}};
+
+	HYDRO_LOG_INFO("StateFile: restored " + std::to_string(restored) + " entries");
+	return restored;
+}
+
+std::chrono::milliseconds StateFile::restoredAge() const
+{
+	if (!restoredSavedAt) {
+		return std::chrono::milliseconds{0};
+	}
+
+	const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - *restoredSavedAt);
+	return std::max(age, std::chrono::milliseconds{0});
+}
+
+void StateFile::appendValue(std::vector<uint8_t> &aOut, const BbValue &aValue)
+{
+	BbSerializers::of(aValue).toBinary(aValue, aOut);
+}
+
+bool StateFile::decodeValue(uint8_t aTag, const uint8_t *aData, size_t aSize, BbValue &aOut)
+{
+	const auto *serializer = BbSerializers::at(aTag);
+	return serializer && serializer->fromBinary(aData, aSize, aOut);
+}
+
+uint64_t StateFile::checksum(const uint8_t *aData, size_t aSize)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < aSize; ++i) {
+		hash ^= aData[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+bool StateFile::writeAtomically(const std::vector<uint8_t> &aData) const
+{
+	const std::string tmpPath = path + ".tmp";
+
+	const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		HYDRO_LOG_ERROR("StateFile: can't open " + tmpPath);
+		return false;
+	}
+
+	size_t written = 0;
+	while (written < aData.size()) {
+		const ssize_t result = ::write(fd, aData.data() + written, aData.size() - written);
+		if (result < 0) {
+			::close(fd);
+			::unlink(tmpPath.c_str());
+			HYDRO_LOG_ERROR("StateFile: write failed");
+			return false;
+		}
+		written += static_cast<size_t>(result);
+	}
+
+	// Данные должны быть на диске до rename, иначе после сбоя питания можно получить пустой файл
+	const bool synced = ::fsync(fd) == 0;
+	::close(fd);
+
+	if (!synced || ::rename(tmpPath.c_str(), path.c_str()) != 0) {
+		::unlink(tmpPath.c_str());
+		HYDRO_LOG_ERROR("StateFile: can't replace " + path);
+		return false;
+	}
+
+	// Сам rename тоже надо закрепить на диске
+	const std::string dir = std::filesystem::absolute(path).parent_path().string();
+	const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirFd >= 0) {
+		::fsync(dirFd);
+		::close(dirFd);
+	}
+
+	return true;
+}
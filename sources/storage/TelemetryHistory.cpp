@@ -0,0 +1,76 @@
+#include "storage/TelemetryHistory.hpp"
+#include "BbSerializers.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+TelemetryHistory::TelemetryHistory(std::shared_ptr<Blackboard> aBb, std::shared_ptr<Database> aDb) :
+	bb{aBb},
+	db{aDb}
+{
+}
+
+TelemetryHistory::Result TelemetryHistory::query(const std::string &aKey, int64_t aFromMs, int64_t aToMs, size_t aLimit) const
+{
+	Result result;
+	if (aFromMs > aToMs || aLimit == 0) {
+		return result;
+	}
+
+	const BbHistory recent = bb->history(aKey, aFromMs, aToMs);
+
+	// В БД только то, что раньше начала кольца
+	if (db && (!recent.enabled || aFromMs < recent.coveredFromMs)) {
+		const int64_t dbTo = recent.enabled ? std::min(aToMs, recent.coveredFromMs - 1) : aToMs;
+		for (const auto &[key, type, value, timestamp] : db->queryHistory(aKey, formatTimestamp(aFromMs), formatTimestamp(dbTo), aLimit)) {
+			const int64_t ts = parseTimestamp(timestamp);
+			if (ts < 0) {
+				continue;
+			}
+			result.type = type;
+			result.samples.push_back(HistorySample{ts, value});
+		}
+	}
+
+	for (const auto &sample : recent.samples) {
+		if (result.samples.size() >= aLimit) {
+			break;
+		}
+		result.samples.push_back(sample);
+		++result.fromMemory;
+	}
+
+	// Для отсчетов только из памяти тип берем по текущему значению
+	if (result.type.empty() && result.fromMemory) {
+		if (const auto value = bb->getValue(aKey)) {
+			result.type = BbSerializers::of(*value).name;
+		}
+	}
+
+	return result;
+}
+
+int64_t TelemetryHistory::parseTimestamp(const std::string &aTimestamp)
+{
+	std::tm tm{};
+	std::istringstream stream(aTimestamp);
+	stream >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+	if (stream.fail()) {
+		return -1;
+	}
+
+	return static_cast<int64_t>(::timegm(&tm)) * 1000;
+}
+
+std::string TelemetryHistory::formatTimestamp(int64_t aTimestampMs)
+{
+	const std::time_t seconds = static_cast<std::time_t>(aTimestampMs / 1000);
+	std::tm tm{};
+	::gmtime_r(&seconds, &tm);
+
+	char buffer[32];
+	std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+	return buffer;
+}
@@ -0,0 +1,108 @@
+/*!
+@file
+@brief Масштабирование чтения Blackboard по ядрам
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#include "core/Blackboard.hpp"
+#include "core/BlackboardEntry.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Читатели крутят чтения как PumpController::process, писатель имитирует поток радио,
+// только в тысячу раз чаще реального (1 кадр в мс вместо 2 кадров в секунду)
+static constexpr size_t kKeys = 16;
+static constexpr auto kDuration = std::chrono::milliseconds{500};
+
+enum class Mode { Handle, String };
+
+static double run(std::shared_ptr<Blackboard> aBb, const std::vector<std::string> &aNames, unsigned aThreads, Mode aMode)
+{
+	std::vector<BlackboardEntry<float>> entries;
+	for (const auto &name : aNames) {
+		entries.emplace_back(name, aBb);
+	}
+
+	std::atomic<bool> running{true};
+	std::atomic<uint64_t> totalReads{0};
+
+	std::thread writer([&]() {
+		float value = 0.f;
+		while (running.load(std::memory_order_relaxed)) {
+			value += 1.f;
+			for (auto &entry : entries) {
+				entry = value;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+	});
+
+	std::vector<std::thread> readers;
+	for (unsigned t = 0; t < aThreads; ++t) {
+		readers.emplace_back([&]() {
+			uint64_t reads = 0;
+			float sink = 0.f;
+
+			while (running.load(std::memory_order_relaxed)) {
+				for (size_t i = 0; i < kKeys; ++i) {
+					if (aMode == Mode::Handle) {
+						sink += entries[i]();
+					} else {
+						sink += aBb->get<float>(aNames[i]).value_or(0.f);
+					}
+				}
+				reads += kKeys;
+			}
+
+			totalReads.fetch_add(reads + (sink < 0.f ? 1 : 0), std::memory_order_relaxed);
+		});
+	}
+
+	std::this_thread::sleep_for(kDuration);
+	running = false;
+
+	for (auto &reader : readers) {
+		reader.join();
+	}
+	writer.join();
+
+	const double seconds = std::chrono::duration<double>(kDuration).count();
+	return static_cast<double>(totalReads.load()) / seconds;
+}
+
+int main()
+{
+	auto bb = std::make_shared<Blackboard>();
+	std::vector<std::string> names;
+
+	for (size_t i = 0; i < kKeys; ++i) {
+		names.push_back("bench" + std::to_string(i) + ".telem.value");
+		bb->set(names.back(), 0.f);
+	}
+
+	const unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+	for (Mode mode : {Mode::Handle, Mode::String}) {
+		const char *modeName = mode == Mode::Handle ? "handle" : "string";
+		double single = 0.0;
+
+		for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+			const double rate = run(bb, names, threads, mode);
+			if (threads == 1) {
+				single = rate;
+			}
+
+			std::printf("mode=%s threads=%u reads/s=%.0f scaling=%.2f\n", modeName, threads, rate, rate / single);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,224 @@
+/*!
+@file
+@brief Задержка EventBus от отправки до рассылки при конкурентных отправителях и под нагрузкой рутиной
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#include "core/EventBus.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Отправители шлют события пачками с паузой, как контроллеры, только намного чаще.
+// Наблюдатель считает задержку от постановки в очередь (BusEvent::enqueued) до вызова handleEvent
+using Clock = std::chrono::steady_clock;
+
+static constexpr int kEventsPerProducer = 20000;
+static constexpr int kBurst = 16;
+
+struct LatencyObserver : public EventBusObserver {
+	std::vector<uint64_t> latenciesNs;
+
+	void handleEvent(const BusEvent &aEvent) override
+	{
+		latenciesNs.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - aEvent.enqueued).count()));
+	}
+};
+
+static uint64_t percentile(std::vector<uint64_t> &aValues, double aFraction)
+{
+	if (aValues.empty()) {
+		return 0;
+	}
+	const auto index = static_cast<size_t>(aFraction * static_cast<double>(aValues.size() - 1));
+	std::nth_element(aValues.begin(), aValues.begin() + static_cast<std::ptrdiff_t>(index), aValues.end());
+	return aValues[index];
+}
+
+static void run(unsigned aProducers, EventOverflow aOverflow)
+{
+	EventBus bus{256, aOverflow};
+	bus.setCoalescing(EventType::PumpSetState, false);
+	LatencyObserver observer;
+	observer.latenciesNs.reserve(static_cast<size_t>(aProducers) * kEventsPerProducer);
+	bus.registerObserver(EventType::PumpSetState, &observer);
+	bus.start();
+
+	const auto start = Clock::now();
+	std::vector<std::thread> producers;
+	for (unsigned p = 0; p < aProducers; ++p) {
+		producers.emplace_back([&bus]() {
+			for (int i = 0; i < kEventsPerProducer; ++i) {
+				bus.sendEvent(Events::PumpSetState{true});
+				if (i % kBurst == kBurst - 1) {
+					std::this_thread::sleep_for(std::chrono::microseconds{50});
+				}
+			}
+		});
+	}
+	for (auto &producer : producers) {
+		producer.join();
+	}
+
+	const auto expected = bus.stats().sent;
+	while (bus.stats().dispatched < expected) {
+		std::this_thread::sleep_for(std::chrono::microseconds{100});
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	bus.stop();
+
+	const EventBusStats stats = bus.stats();
+	auto &latencies = observer.latenciesNs;
+	const uint64_t maxNs = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+	std::printf("overflow=%s producers=%u events/s=%.0f p50_us=%.1f p99_us=%.1f max_us=%.1f dropped=%llu\n",
+		aOverflow == EventOverflow::Drop ? "drop" : "block", aProducers, static_cast<double>(stats.dispatched) / seconds,
+		static_cast<double>(percentile(latencies, 0.5)) / 1000.0, static_cast<double>(percentile(latencies, 0.99)) / 1000.0,
+		static_cast<double>(maxNs) / 1000.0, static_cast<unsigned long long>(stats.dropped));
+}
+
+// Команда выключения насоса на фоне потока рутинных событий. Рассылка каждого события занимает
+// kDispatchWork, как отправка по радио, рутинные отправители держат очередь полной.
+// В режиме fifo выключение идет в том же классе, что и рутина, как было до классов приоритета.
+// Рутину изображают команды лампы, выключение - команды насоса
+static constexpr int kSafetyEvents = 500;
+static constexpr auto kDispatchWork = std::chrono::microseconds{20};
+
+struct WorkObserver : public EventBusObserver {
+	std::vector<uint64_t> safetyNs;
+
+	void handleEvent(const BusEvent &aEvent) override
+	{
+		if (aEvent.type() == EventType::PumpSetState) {
+			safetyNs.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - aEvent.enqueued).count()));
+		}
+
+		const auto until = Clock::now() + kDispatchWork;
+		while (Clock::now() < until) {
+		}
+	}
+};
+
+static void runUnderLoad(unsigned aFlooders, bool aLanes)
+{
+	EventBus bus{256, EventOverflow::Drop};
+	bus.setCoalescing(EventType::PumpSetState, false);
+	bus.setCoalescing(EventType::LampSetState, false);
+	WorkObserver observer;
+	observer.safetyNs.reserve(kSafetyEvents);
+	bus.registerObserver(EventType::PumpSetState, &observer);
+	bus.registerObserver(EventType::LampSetState, &observer);
+	bus.start();
+
+	std::atomic<bool> done{false};
+	std::vector<std::thread> flooders;
+	for (unsigned p = 0; p < aFlooders; ++p) {
+		flooders.emplace_back([&bus, &done]() {
+			while (!done.load(std::memory_order_relaxed)) {
+				if (!bus.sendEvent(Events::LampSetState{true}, EventPriority::Routine)) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	const EventPriority safetyLane = aLanes ? EventPriority::Safety : EventPriority::Routine;
+	int safetySent = 0;
+	for (int i = 0; i < kSafetyEvents; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		// В режиме fifo очередь почти всегда полна, повторяем как контроллер насоса
+		while (!bus.sendEvent(Events::PumpSetState{false}, safetyLane)) {
+			std::this_thread::yield();
+		}
+		++safetySent;
+	}
+
+	done.store(true);
+	for (auto &flooder : flooders) {
+		flooder.join();
+	}
+	bus.stop();
+
+	const EventBusStats stats = bus.stats();
+	const EventLaneStats &routine = stats.lane(EventPriority::Routine);
+	auto &latencies = observer.safetyNs;
+	const uint64_t maxNs = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+	std::printf("dispatch=%s flooders=%u safety=%zu/%d safety_p50_us=%.1f safety_p99_us=%.1f safety_max_us=%.1f routine_p99_us=%llu routine_dropped=%llu\n",
+		aLanes ? "lanes" : "fifo", aFlooders, latencies.size(), safetySent,
+		static_cast<double>(percentile(latencies, 0.5)) / 1000.0, static_cast<double>(percentile(latencies, 0.99)) / 1000.0,
+		static_cast<double>(maxNs) / 1000.0, static_cast<unsigned long long>(routine.latency.percentileUs(99)),
+		static_cast<unsigned long long>(routine.dropped));
+}
+
+// Медленное радио: команда уходит kAirtime, контроллер повторяет требуемое состояние чаще.
+// Считаем, сколько команд ушло в эфир и было ли последней отправлено последнее намерение
+static constexpr auto kAirtime = std::chrono::milliseconds{5};
+
+struct AirObserver : public EventBusObserver {
+	std::atomic<int> commands{0};
+	std::atomic<bool> last{false};
+
+	void handleEvent(const BusEvent &aEvent) override
+	{
+		last.store(aEvent.as<Events::PumpSetState>()->enabled);
+		commands.fetch_add(1);
+		std::this_thread::sleep_for(kAirtime);
+	}
+};
+
+static void runSlowRadio(bool aCoalescing)
+{
+	EventBus bus{64, EventOverflow::Drop};
+	bus.setCoalescing(EventType::PumpSetState, aCoalescing);
+	AirObserver observer;
+	bus.registerObserver(EventType::PumpSetState, &observer);
+	bus.start();
+
+	// 400 повторов раз в 0.5 мс, желаемое состояние переключается каждые 100 повторов
+	bool desired = false;
+	for (int i = 0; i < 400; ++i) {
+		desired = (i / 100) % 2 == 0;
+		bus.sendEvent(Events::PumpSetState{desired});
+		std::this_thread::sleep_for(std::chrono::microseconds{500});
+	}
+
+	while (bus.stats().depth) {
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+	std::this_thread::sleep_for(kAirtime * 2);
+	bus.stop();
+
+	const EventBusStats stats = bus.stats();
+	std::printf("coalescing=%s radio_commands=%d dropped=%llu coalesced=%llu deduplicated=%llu last_is_latest=%s\n",
+		aCoalescing ? "on" : "off", observer.commands.load(), static_cast<unsigned long long>(stats.dropped),
+		static_cast<unsigned long long>(stats.coalesced), static_cast<unsigned long long>(stats.deduplicated),
+		observer.last.load() == desired ? "yes" : "no");
+}
+
+int main()
+{
+	const unsigned maxProducers = std::max(4u, std::thread::hardware_concurrency());
+
+	for (EventOverflow overflow : {EventOverflow::Block, EventOverflow::Drop}) {
+		for (unsigned producers = 1; producers <= maxProducers; producers *= 2) {
+			run(producers, overflow);
+		}
+	}
+
+	for (bool lanes : {false, true}) {
+		for (unsigned flooders = 1; flooders <= 2; ++flooders) {
+			runUnderLoad(flooders, lanes);
+		}
+	}
+
+	runSlowRadio(false);
+	runSlowRadio(true);
+
+	return 0;
+}
@@ -0,0 +1,431 @@
+/*!
+@file
+@brief Микробенчмарки ядра: Blackboard, обертки записей, разбор телеметрии, сериализация
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#include "BackWebSocket.hpp"
+#include "BbNames.hpp"
+#include "MicroDeviceHub.hpp"
+#include "core/Blackboard.hpp"
+#include "core/BlackboardEntry.hpp"
+#include "core/MonitorEntry.hpp"
+#include "storage/Database.hpp"
+#include "version.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Запуск: HydroBench [--filter подстрока] [--format json|csv] [--min-time мс] [--repetitions N]
+ *
+ * Каждый случай сначала калибруется: число итераций подбирается так, чтобы один прогон шел
+ * не меньше min-time. Затем делается repetitions прогонов, в отчет идут медиана, минимум и максимум
+ * нс на операцию. JSON вывод содержит версию сборки, чтобы сравнивать результаты между релизами
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// \brief Не дать компилятору выбросить вычисление
+template<typename T>
+inline void keep(const T &aValue)
+{
+	asm volatile("" : : "r,m"(aValue) : "memory");
+}
+
+using Runner = std::function<void(uint64_t)>; // Выполнить заданное число итераций
+
+struct Case {
+	std::string name;
+	std::function<Runner()> prepare; // Подготовка окружения не входит в замер
+};
+
+struct Result {
+	std::string name;
+	uint64_t iterations;
+	double medianNs;
+	double minNs;
+	double maxNs;
+};
+
+struct Options {
+	std::string filter;
+	bool csv = false;
+	std::chrono::milliseconds minTime{200};
+	unsigned repetitions = 5;
+};
+
+struct NullEntryObserver : public AbstractEntryObserver {
+	uint64_t calls = 0;
+
+	void onEntryUpdated(std::string_view, const BbValue &) override
+	{
+		++calls;
+	}
+};
+
+struct NullPrefixObserver : public AbstractPrefixObserver {
+	uint64_t calls = 0;
+
+	void onPrefixUpdated(std::string_view, std::string_view, const BbValue &) override
+	{
+		++calls;
+	}
+};
+
+double runOnce(const Case &aCase, uint64_t aIterations)
+{
+	const Runner run = aCase.prepare();
+	const auto start = Clock::now();
+	run(aIterations);
+	const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	return elapsed / static_cast<double>(aIterations);
+}
+
+Result measure(const Case &aCase, const Options &aOptions)
+{
+	const double target = std::chrono::duration<double, std::nano>(aOptions.minTime).count();
+
+	uint64_t iterations = 1;
+	while (true) {
+		const double perOp = runOnce(aCase, iterations);
+		if (perOp * static_cast<double>(iterations) >= target || iterations >= (uint64_t{1} << 40)) {
+			break;
+		}
+		// Растем не больше чем в 10 раз за шаг, первые прогоны бывают холодными
+		const double wanted = target / std::max(perOp, 0.1) * 1.2;
+		iterations = std::max(iterations + 1, std::min(iterations * 10, static_cast<uint64_t>(wanted)));
+	}
+
+	std::vector<double> samples;
+	for (unsigned i = 0; i < aOptions.repetitions; ++i) {
+		samples.push_back(runOnce(aCase, iterations));
+	}
+	std::sort(samples.begin(), samples.end());
+
+	return Result{aCase.name, iterations, samples[samples.size() / 2], samples.front(), samples.back()};
+}
+
+std::vector<std::string> makeNames(size_t aCount)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < aCount; ++i) {
+		names.push_back("bench" + std::to_string(i) + ".telem.value");
+	}
+	return names;
+}
+
+HydroRS::MultiControllerTelem makeTelem(uint64_t aCounter)
+{
+	HydroRS::MultiControllerTelem telem{};
+	telem.pumpState = aCounter % 2;
+	telem.lampState = true;
+	telem.upperState = false;
+	telem.flowDetector = aCounter % 2;
+	telem.temperature = 20.f + static_cast<float>(aCounter % 10);
+	telem.ph = 6.5f;
+	telem.ppm = static_cast<float>(700 + aCounter % 50);
+	telem.waterLevel = static_cast<float>(aCounter % 100);
+	telem.turbidimeter = 100.f;
+	return telem;
+}
+
+/// \brief Запись и чтение при разном количестве записей и подписчиков
+void addBlackboardCases(std::vector<Case> &aCases)
+{
+	for (size_t keys : {16, 256, 4096}) {
+		for (size_t observers : {0, 1, 8}) {
+			aCases.push_back({"bb.set.handle/keys=" + std::to_string(keys) + "/observers=" + std::to_string(observers),
+				[keys, observers]() -> Runner {
+					auto bb = std::make_shared<Blackboard>();
+					auto sinks = std::make_shared<std::vector<NullEntryObserver>>(observers);
+					std::vector<KeyId> ids;
+					for (const auto &name : makeNames(keys)) {
+						ids.push_back(bb->registerKey(name));
+						bb->set(ids.back(), 0.f);
+						for (auto &sink : *sinks) {
+							bb->subscribe(ids.back(), &sink);
+						}
+					}
+
+					return [bb, sinks, ids, keys](uint64_t aIterations) {
+						for (uint64_t i = 0; i < aIterations; ++i) {
+							bb->set(ids[i % keys], static_cast<float>(i));
+						}
+					};
+				}});
+		}
+
+		aCases.push_back({"bb.set.string/keys=" + std::to_string(keys), [keys]() -> Runner {
+			auto bb = std::make_shared<Blackboard>();
+			auto names = makeNames(keys);
+			for (const auto &name : names) {
+				bb->set(name, 0.f);
+			}
+
+			return [bb, names, keys](uint64_t aIterations) {
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					bb->set(names[i % keys], static_cast<float>(i));
+				}
+			};
+		}});
+
+		aCases.push_back({"bb.get.handle/keys=" + std::to_string(keys), [keys]() -> Runner {
+			auto bb = std::make_shared<Blackboard>();
+			std::vector<KeyId> ids;
+			for (const auto &name : makeNames(keys)) {
+				ids.push_back(bb->registerKey(name));
+				bb->set(ids.back(), 1.f);
+			}
+
+			return [bb, ids, keys](uint64_t aIterations) {
+				float sum = 0.f;
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					sum += bb->get<float>(ids[i % keys]).value_or(0.f);
+				}
+				keep(sum);
+			};
+		}});
+
+		aCases.push_back({"bb.get.string/keys=" + std::to_string(keys), [keys]() -> Runner {
+			auto bb = std::make_shared<Blackboard>();
+			auto names = makeNames(keys);
+			for (const auto &name : names) {
+				bb->set(name, 1.f);
+			}
+
+			return [bb, names, keys](uint64_t aIterations) {
+				float sum = 0.f;
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					sum += bb->get<float>(names[i % keys]).value_or(0.f);
+				}
+				keep(sum);
+			};
+		}});
+	}
+
+	for (size_t observers : {1, 8, 64}) {
+		aCases.push_back({"bb.notify.segment/observers=" + std::to_string(observers), [observers]() -> Runner {
+			auto bb = std::make_shared<Blackboard>();
+			auto sinks = std::make_shared<std::vector<NullPrefixObserver>>(observers);
+			for (auto &sink : *sinks) {
+				bb->subscribeToSegment("telem", &sink);
+			}
+			const KeyId id = bb->registerKey("pump.telem.value");
+
+			return [bb, sinks, id](uint64_t aIterations) {
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					bb->set(id, static_cast<float>(i));
+				}
+			};
+		}});
+	}
+
+	aCases.push_back({"bb.batch/keys=12", []() -> Runner {
+		auto bb = std::make_shared<Blackboard>();
+		auto sink = std::make_shared<NullPrefixObserver>();
+		bb->subscribeToSegment("telem", sink.get());
+		std::vector<KeyId> ids;
+		for (const auto &name : makeNames(12)) {
+			ids.push_back(bb->registerKey(name));
+		}
+
+		return [bb, sink, ids](uint64_t aIterations) {
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				auto batch = bb->batch();
+				for (KeyId id : ids) {
+					batch.set(id, static_cast<float>(i));
+				}
+			}
+		};
+	}});
+}
+
+void addEntryCases(std::vector<Case> &aCases)
+{
+	aCases.push_back({"entry.read", []() -> Runner {
+		auto level = std::make_shared<BlackboardEntry<float>>("waterLevel.telem.value", std::make_shared<Blackboard>());
+		*level = 42.f;
+
+		return [level](uint64_t aIterations) {
+			float sum = 0.f;
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				sum += (*level)();
+			}
+			keep(sum);
+		};
+	}});
+
+	aCases.push_back({"entry.write", []() -> Runner {
+		auto level = std::make_shared<BlackboardEntry<float>>("waterLevel.telem.value", std::make_shared<Blackboard>());
+
+		return [level](uint64_t aIterations) {
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				*level = static_cast<float>(i);
+			}
+		};
+	}});
+
+	aCases.push_back({"monitor.setClearFlag", []() -> Runner {
+		auto monitor = std::make_shared<MonitorEntry>(std::make_shared<Blackboard>());
+		monitor->invoke();
+
+		return [monitor](uint64_t aIterations) {
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				if (i % 2) {
+					monitor->clearFlag(MonitorFlags::FloatLevelTimeout);
+				} else {
+					monitor->setFlag(MonitorFlags::FloatLevelTimeout);
+				}
+			}
+		};
+	}});
+}
+
+void addTelemetryCases(std::vector<Case> &aCases)
+{
+	// Полный путь кадра: запись в трубу, MicroDeviceHub раскладывает его пакетом по устройствам
+	aCases.push_back({"hub.parseTelemPipe", []() -> Runner {
+		auto bb = std::make_shared<Blackboard>();
+		MonitorEntry{bb}.invoke();
+		auto hub = std::make_shared<MicroDeviceHub>(bb);
+		auto pipe = std::make_shared<BlackboardEntry<HydroRS::MultiControllerTelem>>(Names::kTelemPipe, bb);
+
+		return [hub, pipe](uint64_t aIterations) {
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				*pipe = makeTelem(i);
+			}
+		};
+	}});
+
+	const std::vector<std::pair<std::string, BbValue>> values{
+		{"float", BbValue{42.5f}},
+		{"int", BbValue{7}},
+		{"bool", BbValue{true}},
+		{"string", BbValue{std::string{"Pump working"}}},
+		{"seconds", BbValue{std::chrono::seconds{30}}},
+	};
+
+	for (const auto &[type, value] : values) {
+		aCases.push_back({"ws.toJson/" + type, [value]() -> Runner {
+			return [value](uint64_t aIterations) {
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					auto json = BackWebSocket::toJson(value);
+					keep(json);
+				}
+			};
+		}});
+	}
+
+	const std::vector<std::pair<std::string, BbValue>> dbValues{
+		{"bool", BbValue{true}},
+		{"int", BbValue{7}},
+		{"unsigned", BbValue{7u}},
+		{"float", BbValue{6.5f}},
+		{"seconds", BbValue{std::chrono::seconds{30}}},
+	};
+
+	for (const auto &[type, value] : dbValues) {
+		aCases.push_back({"db.convertValue/" + type, [value]() -> Runner {
+			return [value](uint64_t aIterations) {
+				for (uint64_t i = 0; i < aIterations; ++i) {
+					auto converted = Database::convertValue(value);
+					keep(converted.value);
+				}
+			};
+		}});
+	}
+}
+
+bool parseArgs(int argc, char **argv, Options &aOptions)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--filter" && hasValue) {
+			aOptions.filter = argv[++i];
+		} else if (arg == "--format" && hasValue) {
+			aOptions.csv = std::strcmp(argv[++i], "csv") == 0;
+		} else if (arg == "--min-time" && hasValue) {
+			aOptions.minTime = std::chrono::milliseconds{std::stoul(argv[++i])};
+		} else if (arg == "--repetitions" && hasValue) {
+			aOptions.repetitions = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+		} else {
+			std::fprintf(stderr, "Usage: %s [--filter substr] [--format json|csv] [--min-time ms] [--repetitions N]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+void printJson(const std::vector<Result> &aResults, const Options &aOptions)
+{
+	std::printf("{\n  \"meta\": {\"version\": \"%u.%u.%u\", \"git\": \"%s\", \"instrumentation\": %s, "
+				"\"minTimeMs\": %lld, \"repetitions\": %u},\n  \"results\": [\n",
+		static_cast<unsigned>(DEVICE_SW_MAJOR), static_cast<unsigned>(DEVICE_SW_MINOR), static_cast<unsigned>(DEVICE_SW_REVISION),
+		DEVICE_GIT_HASH_FULL, HYDRO_BB_INSTRUMENTATION ? "true" : "false",
+		static_cast<long long>(aOptions.minTime.count()), aOptions.repetitions);
+
+	for (size_t i = 0; i < aResults.size(); ++i) {
+		const auto &result = aResults[i];
+		std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f}%s\n",
+			result.name.c_str(), static_cast<unsigned long long>(result.iterations), result.medianNs, result.minNs,
+			result.maxNs, i + 1 < aResults.size() ? "," : "");
+	}
+
+	std::printf("  ]\n}\n");
+}
+
+void printCsv(const std::vector<Result> &aResults)
+{
+	std::printf("name,iterations,ns_per_op,min_ns,max_ns\n");
+	for (const auto &result : aResults) {
+		std::printf("%s,%llu,%.2f,%.2f,%.2f\n", result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+			result.medianNs, result.minNs, result.maxNs);
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (!parseArgs(argc, argv, options)) {
+		return 1;
+	}
+
+	std::vector<Case> cases;
+	addBlackboardCases(cases);
+	addEntryCases(cases);
+	addTelemetryCases(cases);
+
+	std::vector<Result> results;
+	for (const auto &benchCase : cases) {
+		if (benchCase.name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+		// Ход выполнения в stderr, stdout остается машиночитаемым
+		std::fprintf(stderr, "%s...\n", benchCase.name.c_str());
+		results.push_back(measure(benchCase, options));
+	}
+
+	if (options.csv) {
+		printCsv(results);
+	} else {
+		printJson(results, options);
+	}
+
+	return 0;
+}
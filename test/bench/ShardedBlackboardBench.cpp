@@ -0,0 +1,201 @@
+/*!
+@file
+@brief Телеметрия 255 установок: шардированный BB против одного общего
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#include "core/Blackboard.hpp"
+#include "core/ShardedBlackboard.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Каждая установка шлет кадр телеметрии 2 раза в секунду, кадр раскладывается в BB одним пакетом,
+// как в MicroDeviceHub::parseTelemPipe. Параллельно UI опрашивает *.telem.status по всем установкам
+static constexpr size_t kInstallations = ShardedBlackboard::kMaxInstallations;
+static constexpr size_t kKeysPerFrame = 12;
+static constexpr auto kPeriod = std::chrono::milliseconds{500};
+static constexpr auto kRealtimeDuration = std::chrono::seconds{3};
+static constexpr auto kSaturatedDuration = std::chrono::milliseconds{500};
+
+static const char *const kDevices[] = {"pump", "lamp", "upper", "lower"};
+
+/// \brief Установка глазами писателя: ее BB и дескрипторы ключей кадра
+struct Installation {
+	std::shared_ptr<Blackboard> bb;
+	std::vector<KeyId> keys;
+};
+
+enum class Layout { Sharded, Single };
+
+static std::vector<Installation> makeInstallations(Layout aLayout, ShardedBlackboard &aBoards,
+	const std::shared_ptr<Blackboard> &aSingle)
+{
+	std::vector<Installation> result(kInstallations);
+
+	for (size_t i = 0; i < kInstallations; ++i) {
+		auto &installation = result[i];
+		// В общем BB номер установки приходится класть в имя
+		const std::string prefix = aLayout == Layout::Single ? "inst" + std::to_string(i) + "." : "";
+		installation.bb = aLayout == Layout::Single ? aSingle : aBoards.shard(static_cast<InstallationId>(i));
+
+		for (size_t k = 0; k < kKeysPerFrame; ++k) {
+			const std::string device = kDevices[k % std::size(kDevices)];
+			const std::string name = k < std::size(kDevices) ? device + ".telem.status" : device + ".telem.value" + std::to_string(k);
+			installation.keys.push_back(installation.bb->registerKey(prefix + name));
+		}
+	}
+
+	return result;
+}
+
+static void writeFrame(Installation &aInstallation, unsigned aCounter)
+{
+	auto batch = aInstallation.bb->batch();
+	for (size_t k = 0; k < aInstallation.keys.size(); ++k) {
+		if (k < std::size(kDevices)) {
+			batch.set(aInstallation.keys[k], static_cast<int>(aCounter % 4));
+		} else {
+			batch.set(aInstallation.keys[k], static_cast<float>(aCounter + k));
+		}
+	}
+	batch.commit();
+}
+
+/// \brief Читатель как у UI: статусы всех установок
+static size_t readStatuses(Layout aLayout, const ShardedBlackboard &aBoards, const std::shared_ptr<Blackboard> &aSingle)
+{
+	size_t found = 0;
+	if (aLayout == Layout::Sharded) {
+		aBoards.forEachMatch("*.telem.status", [&](InstallationId, const BbDelta &) { ++found; });
+	} else {
+		found = aSingle->matching("*.*.telem.status").size();
+	}
+	return found;
+}
+
+struct Result {
+	double framesPerSecond = 0.0;
+	double p50Us = 0.0;
+	double p99Us = 0.0;
+	double maxUs = 0.0;
+	uint64_t queries = 0;
+};
+
+/// \param aRealtime true - каждая установка пишет раз в kPeriod, false - писатели пишут без пауз
+static Result run(Layout aLayout, unsigned aWriters, bool aRealtime)
+{
+	ShardedBlackboard boards;
+	auto single = std::make_shared<Blackboard>();
+	auto installations = makeInstallations(aLayout, boards, single);
+
+	for (auto &installation : installations) {
+		writeFrame(installation, 0);
+	}
+
+	std::atomic<bool> running{true};
+	std::atomic<uint64_t> frames{0};
+	std::atomic<uint64_t> queries{0};
+	std::vector<std::vector<double>> latencies(aWriters);
+
+	const auto duration = aRealtime ? std::chrono::duration_cast<std::chrono::milliseconds>(kRealtimeDuration) : kSaturatedDuration;
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> writers;
+	for (unsigned t = 0; t < aWriters; ++t) {
+		writers.emplace_back([&, t]() {
+			std::vector<Installation *> own;
+			for (size_t i = t; i < installations.size(); i += aWriters) {
+				own.push_back(&installations[i]);
+			}
+
+			uint64_t written = 0;
+			unsigned counter = 1;
+
+			while (running.load(std::memory_order_relaxed)) {
+				for (size_t k = 0; k < own.size() && running.load(std::memory_order_relaxed); ++k) {
+					if (aRealtime) {
+						// Установки потока равномерно разнесены внутри периода
+						const auto offset = kPeriod * k / own.size();
+						std::this_thread::sleep_until(start + kPeriod * (counter - 1) + offset);
+					}
+
+					const auto before = std::chrono::steady_clock::now();
+					writeFrame(*own[k], counter);
+					const auto after = std::chrono::steady_clock::now();
+
+					latencies[t].push_back(std::chrono::duration<double, std::micro>(after - before).count());
+					++written;
+				}
+				++counter;
+			}
+
+			frames.fetch_add(written, std::memory_order_relaxed);
+		});
+	}
+
+	std::thread reader([&]() {
+		uint64_t done = 0;
+		size_t sink = 0;
+		while (running.load(std::memory_order_relaxed)) {
+			sink += readStatuses(aLayout, boards, single);
+			++done;
+			if (aRealtime) {
+				std::this_thread::sleep_for(std::chrono::milliseconds{100});
+			}
+		}
+		queries.store(done + (sink == 0 ? 1 : 0), std::memory_order_relaxed);
+	});
+
+	std::this_thread::sleep_for(duration);
+	running = false;
+
+	for (auto &writer : writers) {
+		writer.join();
+	}
+	reader.join();
+
+	std::vector<double> all;
+	for (const auto &perThread : latencies) {
+		all.insert(all.end(), perThread.begin(), perThread.end());
+	}
+	std::sort(all.begin(), all.end());
+
+	Result result;
+	result.framesPerSecond = static_cast<double>(frames.load()) / std::chrono::duration<double>(duration).count();
+	result.queries = queries.load();
+	if (!all.empty()) {
+		result.p50Us = all[all.size() / 2];
+		result.p99Us = all[all.size() * 99 / 100];
+		result.maxUs = all.back();
+	}
+	return result;
+}
+
+int main()
+{
+	const unsigned maxWriters = std::max(4u, std::thread::hardware_concurrency());
+
+	for (bool realtime : {true, false}) {
+		for (Layout layout : {Layout::Sharded, Layout::Single}) {
+			for (unsigned writers = 1; writers <= maxWriters; writers *= 2) {
+				const Result result = run(layout, writers, realtime);
+				std::printf("mode=%s layout=%s installations=%zu writers=%u frames/s=%.0f p50_us=%.1f p99_us=%.1f "
+							"max_us=%.1f queries=%llu\n",
+					realtime ? "2hz" : "saturated", layout == Layout::Sharded ? "sharded" : "single", kInstallations,
+					writers, result.framesPerSecond, result.p50Us, result.p99Us, result.maxUs,
+					static_cast<unsigned long long>(result.queries));
+			}
+		}
+	}
+
+	return 0;
+}
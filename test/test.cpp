@@ -1,6 +1,1338 @@
 #include <jsoncpp/json/writer.h>
 
+#include "BbSerializers.hpp"
+#include "BbNames.hpp"
+#include "core/Blackboard.hpp"
+#include "core/BlackboardEntry.hpp"
+#include "core/EventBus.hpp"
+#include "core/FieldValidators.hpp"
+#include "core/RadioTypes.hpp"
+#include "core/Scheduler.hpp"
+#include "core/ShardedBlackboard.hpp"
+#include "shm/BbShmMirror.hpp"
+#include "shm/BbShmReader.hpp"
+#include "storage/StateFile.hpp"
+#include "storage/TelemetryHistory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Счетчик аллокаций, глобальные new/delete подменены на время всего теста
+static std::atomic<size_t> allocations{0};
+
+// Освобождение вынесено, иначе после инлайна GCC ругается на пару new/free (-Wmismatched-new-delete)
+[[gnu::noinline]] static void release(void *aPtr) noexcept
+{
+	std::free(aPtr);
+}
+
+void *operator new(std::size_t aSize)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(aSize ? aSize : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void *aPtr) noexcept
+{
+	release(aPtr);
+}
+
+void operator delete(void *aPtr, std::size_t) noexcept
+{
+	release(aPtr);
+}
+
+static int failures = 0;
+
+#define CHECK(expr)                                                                                                    \
+	do {                                                                                                               \
+		if (!(expr)) {                                                                                                 \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #expr << std::endl;                         \
+			++failures;                                                                                                \
+		}                                                                                                              \
+	} while (0)
+
+struct CountingObserver : public AbstractEntryObserver, public AbstractPrefixObserver {
+	size_t entryCalls = 0;
+	size_t prefixCalls = 0;
+	size_t batchCalls = 0;
+
+	void onEntryUpdated(std::string_view, const BbValue &) override
+	{
+		++entryCalls;
+	}
+
+	void onPrefixUpdated(std::string_view, std::string_view, const BbValue &) override
+	{
+		++prefixCalls;
+	}
+
+	void onPrefixBatchUpdated(const std::vector<BbChange> &changes) override
+	{
+		++batchCalls;
+		prefixCalls += changes.size();
+	}
+};
+
+/// Запись и чтение скалярной телеметрии не должны трогать аллокатор
+static void testScalarSetGetDoesNotAllocate()
+{
+	auto bb = std::make_shared<Blackboard>();
+	CountingObserver observer;
+
+	BlackboardEntry<float> level{"waterLevel.telem.value", bb};
+	BlackboardEntry<bool> pump{"pump.telem.value", bb};
+	BlackboardEntry<DeviceStatus> status{"pump.telem.status", bb};
+	level.subscribe(&observer);
+	bb->subscribeToSegment(".telem", &observer);
+
+	// Первая запись создает значения, дальше только обновления
+	level = 0.f;
+	pump = true;
+	status = DeviceStatus::NotFound;
+	bb->set("ppmMeter.telem.value", 0.f);
+
+	const size_t before = allocations.load();
+	float sum = 0.f;
+
+	for (int i = 1; i <= 1000; ++i) {
+		level = static_cast<float>(i);
+		pump = (i % 2) == 0;
+		status = (i % 2) ? DeviceStatus::Working : DeviceStatus::Warning;
+		bb->set("ppmMeter.telem.value", static_cast<float>(i) * 2.f);
+
+		sum += level();
+		sum += bb->get<float>("ppmMeter.telem.value").value_or(0.f);
+		sum += pump() ? 1.f : 0.f;
+		sum += status() == DeviceStatus::Working ? 1.f : 0.f;
+	}
+
+	CHECK(allocations.load() == before);
+	CHECK(sum > 0.f);
+	CHECK(observer.entryCalls == 1001);
+	CHECK(observer.prefixCalls == 4004);
+}
+
+/// Структура телеметрии хранится inline и тоже не аллоцирует
+static void testTelemetryStructDoesNotAllocate()
+{
+	auto bb = std::make_shared<Blackboard>();
+	BlackboardEntry<HydroRS::MultiControllerTelem> pipe{"multiController.rs.data", bb};
+
+	HydroRS::MultiControllerTelem telem{};
+	pipe = telem;
+
+	const size_t before = allocations.load();
+
+	for (int i = 0; i < 100; ++i) {
+		telem.waterLevel = static_cast<float>(i);
+		pipe = telem;
+		CHECK(pipe().waterLevel == static_cast<float>(i));
+	}
+
+	CHECK(allocations.load() == before);
+}
+
+/// Префикс совпадает посимвольно с начала имени, сегмент - только целой компонентой
+static void testPrefixAndSegmentSemantics()
+{
+	Blackboard bb;
+	CountingObserver prefix;
+	CountingObserver segment;
+
+	bb.subscribeToPrefix("pump.", &prefix);
+	bb.subscribeToSegment("telem", &segment);
+
+	bb.set("pump.telem.value", true);
+	bb.set("lamp.telem.value", true);
+	bb.set("pump.telemetry.value", true);
+	bb.set("system.config.pump.", true);
+
+	CHECK(prefix.prefixCalls == 2);
+	CHECK(segment.prefixCalls == 2);
+
+	CHECK(bb.getKeysByPrefix("pump.").size() == 2);
+	CHECK(bb.getKeysBySegment(".telem").size() == 2);
+	CHECK(bb.getKeysBySegment("pump").size() == 3);
+
+	bb.remove("pump.telem.value");
+	CHECK(bb.getKeysByPrefix("pump.").size() == 1);
+	CHECK(bb.getKeysBySegment("telem").size() == 1);
+}
+
+static void testTypeChangeRejected()
+{
+	Blackboard bb;
+	CHECK(bb.set("pump.config.enabled", true));
+	CHECK(!bb.set("pump.config.enabled", 1));
+	CHECK(bb.get<bool>("pump.config.enabled").value());
+	CHECK(!bb.get<int>("pump.config.enabled").has_value());
+}
+
+/// Валидаторы привязываются и к уже существующим, и к новым записям, и выстраиваются в цепочку
+static void testValidatorChain()
+{
+	Blackboard bb;
+	CHECK(bb.set("lamp.config.onTime", 10));
+
+	CHECK(bb.insertValidator("lamp.config.", std::make_unique<RangeValidator<int>>(0, 1440)));
+	CHECK(bb.insertValidator("lamp.config.onTime", std::make_unique<RangeValidator<int>>(0, 720)));
+	CHECK(bb.insertValidator("lamp.config.name", std::make_unique<RegexValidator>("[a-z]+")));
+
+	CHECK(bb.set("lamp.config.onTime", 700));
+	CHECK(!bb.set("lamp.config.onTime", 800));
+	CHECK(!bb.set("lamp.config.onTime", -1));
+	CHECK(bb.get<int>("lamp.config.onTime").value() == 700);
+
+	CHECK(bb.set("lamp.config.offTime", 0));
+	CHECK(bb.set("lamp.config.offTime", 1000));
+	CHECK(!bb.set("lamp.config.offTime", 1500));
+
+	CHECK(bb.set("lamp.config.name", std::string{"main"}));
+	CHECK(!bb.set("lamp.config.name", std::string{"Main1"}));
+	CHECK(bb.get<std::string>("lamp.config.name").value() == "main");
+
+	// Записи вне префикса не затронуты
+	CHECK(bb.set("lamp.telem.value", 5000));
+	CHECK(bb.set("lamp.telem.value", 6000));
+}
+
+/// Пакет применяется целиком и приходит наблюдателю префикса одним вызовом
+static void testBatchCoalescesNotifications()
+{
+	auto bb = std::make_shared<Blackboard>();
+	CountingObserver observer;
+	BlackboardEntry<DeviceStatus> status{"pump.telem.status", bb};
+	status.subscribe(&observer);
+	bb->subscribeToSegment("telem", &observer);
+	bb->subscribeToSegment("config", &observer);
+
+	{
+		auto batch = bb->batch();
+		batch.set("pump.telem.value", true);
+		status.set(batch, DeviceStatus::Working);
+		batch.set("lamp.telem.value", 1.5f);
+		batch.set("lamp.telem.value", 2.5f);
+		batch.set("lamp.config.enabled", true);
+		batch.set("lamp.int.uptime", 1u);
+		CHECK(batch.commit() == 5);
+	}
+
+	CHECK(observer.batchCalls == 1);
+	CHECK(observer.prefixCalls == 4);
+	CHECK(observer.entryCalls == 1);
+	CHECK(status() == DeviceStatus::Working);
+	CHECK(bb->get<float>("lamp.telem.value").value() == 2.5f);
+
+	// Неизмененные и отвергнутые записи не попадают в пакет
+	CHECK(bb->setMany({{"pump.telem.value", true}, {"lamp.telem.value", 3.5f}, {"lamp.config.enabled", 1}}) == 1);
+	CHECK(observer.batchCalls == 2);
+	CHECK(observer.prefixCalls == 5);
+}
+
+/// Наблюдатель, который держит поток доставки, пока его не отпустят
+struct GatedObserver : public AbstractEntryObserver {
+	std::atomic<bool> open{false};
+	std::mutex mutex;
+	std::vector<int> values;
+	std::thread::id thread;
+
+	void onEntryUpdated(std::string_view, const BbValue &value) override
+	{
+		while (!open.load()) {
+			std::this_thread::yield();
+		}
+
+		std::lock_guard lock(mutex);
+		values.push_back(std::get<int>(value));
+		thread = std::this_thread::get_id();
+	}
+};
+
+/// Асинхронный наблюдатель не задерживает писателя, получает оповещения по порядку,
+/// а при переполнении очереди теряет самые старые
+static void testAsyncDeliveryIsOrderedAndBounded()
+{
+	Blackboard bb;
+	GatedObserver observer;
+	bb.subscribe("pump.int.counter", &observer, {Delivery::Async, 8});
+
+	for (int i = 0; i < 100; ++i) {
+		bb.set("pump.int.counter", i);
+	}
+
+	observer.open = true;
+	bb.unsubscribe("pump.int.counter", &observer);
+
+	const DispatchStats stats = bb.dispatchStats();
+	CHECK(stats.queued == 0);
+	CHECK(stats.dropped > 0);
+	CHECK(stats.delivered + stats.dropped == 100);
+
+	std::lock_guard lock(observer.mutex);
+	CHECK(!observer.values.empty());
+	CHECK(observer.values.back() == 99);
+	CHECK(std::is_sorted(observer.values.begin(), observer.values.end()));
+	CHECK(observer.thread != std::this_thread::get_id());
+
+	// После отписки оповещения больше не приходят
+	const size_t delivered = observer.values.size();
+	bb.set("pump.int.counter", 1000);
+	std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	CHECK(observer.values.size() == delivered);
+}
+
+struct LatestObserver : public AbstractPrefixObserver {
+	std::mutex mutex;
+	std::map<std::string, int, std::less<>> latest;
+	size_t deliveries = 0;
+
+	void onPrefixUpdated(std::string_view, std::string_view entry, const BbValue &value) override
+	{
+		std::lock_guard lock(mutex);
+		++deliveries;
+		latest[std::string{entry}] = std::get<int>(value);
+	}
+
+	void onPrefixBatchUpdated(const std::vector<BbChange> &changes) override
+	{
+		std::lock_guard lock(mutex);
+		++deliveries;
+		for (const auto &change : changes) {
+			latest[std::string{change.entry}] = std::get<int>(*change.value);
+		}
+	}
+};
+
+/// Подписка с ограничением частоты получает не больше одного пакета за интервал,
+/// промежуточные значения схлопываются до последнего
+static void testRateLimitedSubscription()
+{
+	using namespace std::chrono;
+
+	Blackboard bb;
+	LatestObserver observer;
+	bb.subscribeToPrefix("pump.telem.", &observer, {Delivery::Async, 256, milliseconds{50}});
+
+	const auto start = steady_clock::now();
+	for (int i = 0; i < 1000; ++i) {
+		bb.set(i % 2 ? "pump.telem.ppm" : "pump.telem.level", i);
+	}
+	std::this_thread::sleep_for(milliseconds{120});
+	const auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+
+	{
+		std::lock_guard lock(observer.mutex);
+		CHECK(observer.deliveries >= 1);
+		CHECK(observer.deliveries <= 2 + static_cast<size_t>(elapsed.count() / 50));
+		CHECK(observer.latest["pump.telem.level"] == 998);
+		CHECK(observer.latest["pump.telem.ppm"] == 999);
+	}
+
+	const DispatchStats stats = bb.dispatchStats();
+	CHECK(stats.coalesced > 900);
+	CHECK(stats.queued == 0);
+
+	// Отписка не ждет конца интервала, накопленное доставляется сразу
+	bb.set("pump.telem.level", 5000);
+	bb.unsubscribeFromPrefix("pump.telem.", &observer);
+	{
+		std::lock_guard lock(observer.mutex);
+		CHECK(observer.latest["pump.telem.level"] == 5000);
+	}
+
+	// Вторая подписка того же наблюдателя со своим интервалом ограничивается, хотя первая без него
+	LatestObserver mixed;
+	bb.subscribeToPrefix("lamp.telem.", &mixed, {Delivery::Async});
+	bb.subscribeToPrefix("pump.telem.", &mixed, {Delivery::Async, 256, milliseconds{50}});
+	for (int i = 0; i < 100; ++i) {
+		bb.set("pump.telem.level", i);
+	}
+	std::this_thread::sleep_for(milliseconds{120});
+	size_t deliveries = 0;
+	{
+		std::lock_guard lock(mixed.mutex);
+		deliveries = mixed.deliveries;
+		CHECK(deliveries >= 1 && deliveries <= 4);
+	}
+
+	// После полной отписки ящик освобождается, новая подписка без интервала получает каждое изменение
+	bb.unsubscribeAll(&mixed);
+	bb.subscribeToPrefix("pump.telem.", &mixed, {Delivery::Async});
+	for (int i = 0; i < 10; ++i) {
+		bb.set("pump.telem.level", 1000 + i);
+	}
+	bb.unsubscribeAll(&mixed);
+	std::lock_guard lock(mixed.mutex);
+	CHECK(mixed.deliveries == deliveries + 10);
+}
+
+/// Счетчики записей различают изменения и отказы, без HYDRO_BB_INSTRUMENTATION срез пустой
+static void testInstrumentation()
+{
+	Blackboard bb;
+	CountingObserver observer;
+	bb.subscribe("pump.config.mode", &observer);
+	bb.insertValidator("pump.config.mode", std::make_unique<RangeValidator<int>>(0, 2));
+
+	bb.set("pump.config.mode", 0);
+	bb.set("pump.config.mode", 1);
+	bb.set("pump.config.mode", 1);  // Без изменения
+	bb.set("pump.config.mode", 7);  // Валидатор
+	bb.set("pump.config.mode", 1.f); // Смена типа
+
+	const BbStats stats = bb.stats();
+	CHECK(stats.enabled == static_cast<bool>(HYDRO_BB_INSTRUMENTATION));
+
+#if HYDRO_BB_INSTRUMENTATION
+	CHECK(stats.keys.size() == 1);
+	if (!stats.keys.empty()) {
+		CHECK(stats.keys[0].key == "pump.config.mode");
+		CHECK(stats.keys[0].writes == 5);
+		CHECK(stats.keys[0].changes == 2);
+		CHECK(stats.keys[0].rejected == 2);
+	}
+	CHECK(stats.observers.size() == 1);
+	if (!stats.observers.empty()) {
+		CHECK(stats.observers[0].name == "CountingObserver");
+		CHECK(stats.observers[0].latency.count == 2);
+	}
+	CHECK(stats.exclusiveWait.count > 0);
+#else
+	CHECK(stats.keys.empty() && stats.observers.empty());
+#endif
+
+	LatencyHistogram histogram;
+	histogram.record(std::chrono::microseconds{3});
+	histogram.record(std::chrono::microseconds{100});
+	const auto snap = histogram.snapshot();
+	CHECK(snap.count == 2 && snap.maxUs == 100);
+	CHECK(snap.percentileUs(50) == 4);
+	CHECK(snap.percentileUs(99) == 100);
+}
+
+/// changesSince отдает каждую измененную запись один раз, в порядке изменений, вместе с удалениями
+static void testChangesSince()
+{
+	Blackboard bb;
+	CHECK(bb.currentSequence() == 0);
+
+	bb.set("pump.telem.value", true);
+	bb.set("lamp.telem.value", false);
+	bb.set("waterLevel.telem.value", 1.f);
+	const uint64_t mark = bb.currentSequence();
+	CHECK(mark == 3);
+
+	bb.set("lamp.telem.value", true);
+	bb.set("pump.telem.value", false);
+	bb.set("lamp.telem.value", false);
+	bb.set("lamp.telem.value", false); // Без изменения номер не растет
+	bb.remove("waterLevel.telem.value");
+
+	const BbChangeLog log = bb.changesSince(mark);
+	CHECK(log.sequence == 7);
+	CHECK(log.entries.size() == 3);
+	if (log.entries.size() == 3) {
+		CHECK(log.entries[0].key == "pump.telem.value");
+		CHECK(log.entries[1].key == "lamp.telem.value");
+		CHECK(log.entries[1].version == 3);
+		CHECK(!std::get<bool>(log.entries[1].value));
+		CHECK(log.entries[2].key == "waterLevel.telem.value");
+		CHECK(!BbTypes::hasValue(log.entries[2].value));
+	}
+
+	CHECK(bb.changesSince(0).entries.size() == 3);
+	CHECK(bb.changesSince(log.sequence).entries.empty());
+	CHECK(bb.getVersion("lamp.telem.value") == 3);
+}
+
+/// Срез не меняется вслед за BB и переиспользуется, пока BB не изменился
+/// Запоминает, какой номер BB считал доставленным в момент каждой доставки
+struct WatermarkObserver : public AbstractPrefixObserver {
+	explicit WatermarkObserver(Blackboard &aBb) : bb{aBb}
+	{
+	}
+
+	Blackboard &bb;
+	std::mutex mutex;
+	std::map<std::string, uint64_t, std::less<>> watermarks; // Ключ последней доставки -> номер
+
+	void onPrefixUpdated(std::string_view, std::string_view, const BbValue &) override
+	{
+	}
+
+	void onPrefixChanged(const BbChange &change) override
+	{
+		const uint64_t watermark = bb.deliveredSequence(this);
+		std::lock_guard lock(mutex);
+		watermarks[std::string{change.entry}] = watermark;
+	}
+
+	void onPrefixBatchUpdated(const std::vector<BbChange> &changes) override
+	{
+		for (const auto &change : changes) {
+			onPrefixChanged(change);
+		}
+	}
+};
+
+/// Сегменты с разными интервалами сбрасываются независимо: номер для продолжения после разрыва
+/// не должен обгонять изменение, которое еще ждет в другом ящике
+static void testDeliveredSequence()
+{
+	using namespace std::chrono;
+
+	Blackboard bb;
+	WatermarkObserver observer{bb};
+	bb.subscribeToSegment("telem", &observer, {Delivery::Async, 256, milliseconds{200}});
+	bb.subscribeToSegment("int", &observer, {Delivery::Async});
+
+	bb.set("pump.telem.value", 1); // Первый сброс без ожидания
+	std::this_thread::sleep_for(milliseconds{20});
+	bb.set("pump.telem.value", 2); // Ждет конца интервала
+	const uint64_t slowSeq = bb.currentSequence();
+	bb.set("pump.int.counter", 3); // Доставляется сразу
+	std::this_thread::sleep_for(milliseconds{50});
+
+	{
+		std::lock_guard lock(observer.mutex);
+		CHECK(observer.watermarks.count("pump.int.counter"));
+		// Писатель мог еще не закончить рассылку, тогда номер отстает сильнее, но не обгоняет
+		CHECK(observer.watermarks["pump.int.counter"] < slowSeq);
+	}
+	CHECK(bb.deliveredSequence(&observer) == slowSeq - 1);
+
+	std::this_thread::sleep_for(milliseconds{250});
+	{
+		std::lock_guard lock(observer.mutex);
+		CHECK(observer.watermarks["pump.telem.value"] == bb.currentSequence());
+	}
+	CHECK(bb.deliveredSequence(&observer) == bb.currentSequence());
+	bb.unsubscribeAll(&observer);
+}
+
+static void testSnapshot()
+{
+	Blackboard bb;
+	bb.set("pump.telem.value", true);
+	bb.set("pump.config.onTime", std::chrono::seconds{15});
+	bb.set("lamp.telem.value", false);
+
+	const auto snap = bb.snapshot();
+	CHECK(snap == bb.snapshot());
+	CHECK(snap->sequence() == bb.currentSequence());
+	CHECK(snap->all().size() == 3);
+	CHECK(snap->byPrefix("pump.").size() == 2);
+	CHECK(snap->byPrefix("lamp.").size() == 1);
+	CHECK(snap->byPrefix("water").empty());
+
+	bb.set("pump.telem.value", false);
+	bb.remove("lamp.telem.value");
+
+	CHECK(snap->get<bool>("pump.telem.value").value());
+	CHECK(snap->has("lamp.telem.value"));
+	CHECK(snap->get<std::chrono::seconds>("pump.config.onTime").value().count() == 15);
+
+	const auto fresh = bb.snapshot();
+	CHECK(fresh != snap);
+	CHECK(!fresh->get<bool>("pump.telem.value").value());
+	CHECK(!fresh->has("lamp.telem.value"));
+
+	size_t telem = 0;
+	fresh->forEachInSegment(".telem", [&](const BbSnapshot::Entry &) { ++telem; });
+	CHECK(telem == 1);
+
+	// Следующий срез делит буферы неизмененных строк с предыдущим и копирует только измененные
+	const auto bufferOf = [](const BbSnapshot &aSnap, std::string_view aKey) {
+		const BbSnapshot::Entry *entry = aSnap.find(aKey);
+		return entry ? entry->held.handle().get() : nullptr;
+	};
+	bb.set("pump.config.name", std::string{"main"});
+	bb.set("lamp.config.name", std::string{"grow"});
+	const auto base = bb.snapshot();
+	bb.set("lamp.config.name", std::string{"bloom"});
+	const auto next = bb.snapshot();
+	CHECK(bufferOf(*next, "pump.config.name") && bufferOf(*next, "pump.config.name") == bufferOf(*base, "pump.config.name"));
+	CHECK(bufferOf(*next, "lamp.config.name") != bufferOf(*base, "lamp.config.name"));
+	CHECK(next->get<std::string>("lamp.config.name").value() == "bloom");
+	CHECK(base->get<std::string>("lamp.config.name").value() == "grow");
+	CHECK(next->all().size() == base->all().size());
+
+	// Новая запись меняет набор, срез собирается заново, но неизмененные буферы все равно переходят
+	bb.set("water.telem.value", 1.5f);
+	const auto grown = bb.snapshot();
+	CHECK(grown->all().size() == next->all().size() + 1);
+	CHECK(bufferOf(*grown, "pump.config.name") == bufferOf(*base, "pump.config.name"));
+	CHECK(grown->get<float>("water.telem.value").value() == 1.5f);
+	CHECK(grown->get<std::string>("lamp.config.name").value() == "bloom");
+}
+
+/// Файл состояния сохраняет только выбранные префиксы и восстанавливает их в новый BB
+static void testStateFileRoundTrip()
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "hydro_state_test.bin").string();
+	std::filesystem::remove(path);
+
+	{
+		auto bb = std::make_shared<Blackboard>();
+		bb->set("pump.int.plainType", 1);
+		bb->set("pump.int.nextSwitchTime", std::chrono::seconds{42});
+		bb->set("pump.int.note", std::string{"resume"});
+		bb->set("pump.telem.value", true);
+
+		StateFile state{path, bb, {"pump.int."}};
+		CHECK(state.save(true));
+	}
+
+	auto bb = std::make_shared<Blackboard>();
+	bb->set("pump.int.plainType", 0);
+	StateFile state{path, bb, {"pump.int."}};
+	CHECK(state.restore() == 3);
+	CHECK(bb->get<int>("pump.int.plainType").value() == 1);
+	CHECK(bb->get<std::chrono::seconds>("pump.int.nextSwitchTime").value().count() == 42);
+	CHECK(bb->get<std::string>("pump.int.note").value() == "resume");
+	CHECK(!bb->has("pump.telem.value"));
+	CHECK(state.restoredAge() < std::chrono::seconds{5});
+
+	// Возраст считается от времени сохранения в заголовке, без восстановления он нулевой
+	{
+		const int64_t savedAt = std::chrono::duration_cast<std::chrono::seconds>(
+			(std::chrono::system_clock::now() - std::chrono::minutes{2}).time_since_epoch()).count();
+		std::FILE *file = std::fopen(path.c_str(), "r+b");
+		std::fseek(file, 12, SEEK_SET); // magic, версия, число альтернатив, число записей
+		std::fwrite(&savedAt, sizeof(savedAt), 1, file);
+		std::fclose(file);
+	}
+	StateFile older{path, std::make_shared<Blackboard>(), {"pump.int."}};
+	CHECK(older.restoredAge() == std::chrono::milliseconds{0});
+	CHECK(older.restore() == 3);
+	CHECK(older.restoredAge() >= std::chrono::minutes{2} && older.restoredAge() < std::chrono::minutes{3});
+
+	// Испорченный файл не применяется
+	{
+		std::FILE *file = std::fopen(path.c_str(), "r+b");
+		std::fseek(file, -1, SEEK_END);
+		std::fputc('x', file);
+		std::fclose(file);
+	}
+	StateFile broken{path, std::make_shared<Blackboard>(), {"pump.int."}};
+	CHECK(broken.restore() == 0);
+
+	std::filesystem::remove(path);
+}
+
+/// Установки не видят записей друг друга, запрос по маске проходит по всем
+static void testShardedQuery()
+{
+	ShardedBlackboard boards{4};
+	CHECK(boards.size() == 4);
+	CHECK(boards.shard(4) == nullptr);
+
+	boards.shard(0)->set("pump.telem.status", 2);
+	boards.shard(2)->set("pump.telem.status", 3);
+	boards.shard(2)->set("lamp.telem.status", 1);
+	boards.shard(2)->set("pump.telem.status.raw", 7);
+	boards.shard(3)->set("pump.config.status", 0);
+
+	CHECK(!boards.shard(1)->has("pump.telem.status"));
+
+	const auto all = boards.query("*.telem.status");
+	CHECK(all.size() == 3);
+	CHECK(all[0].installation == 0 && std::get<int>(all[0].value) == 2);
+	CHECK(all[1].installation == 2 && all[1].key == "lamp.telem.status");
+	CHECK(all[2].installation == 2 && all[2].key == "pump.telem.status");
+
+	CHECK(boards.query("pump.*.status").size() == 3);
+	CHECK(boards.query("pump.telem.status").size() == 2);
+	CHECK(boards.query("*.missing.status").empty());
+	CHECK(boards.query("*.*.*").size() == 4);
+	CHECK(KeyPattern::matchMask("a.b", "*.*") && !KeyPattern::matchMask("a.b.c", "*.*") && !KeyPattern::matchMask("a", "*.*"));
+}
+
+static void testChangePolicy()
+{
+	Blackboard bb;
+	CountingObserver observer;
+	bb.setChangePolicy("ph", ChangePolicy{.absolute = 0.05});
+	bb.subscribe("ph.telem.value", &observer);
+
+	bb.set("ph.telem.value", 6.50f);
+	bb.set("ph.telem.value", 6.53f); // Шум
+	bb.set("ph.telem.value", 6.47f); // Шум
+	bb.set("ph.telem.value", 6.54f); // Все еще ближе 0.05 к принятому 6.50
+	bb.set("ph.telem.value", 6.60f);
+	CHECK(observer.entryCalls == 2);
+	CHECK(bb.get<float>("ph.telem.value") == 6.60f);
+	CHECK(bb.suppressedCount("ph.telem.value") == 3 && bb.suppressedCount() == 3);
+
+	// Политика подхватывает записи, зарегистрированные до нее, и не трогает не числовые значения
+	bb.set("ppm.telem.value", 1000u);
+	bb.set("ppm.telem.status", std::string{"ok"});
+	bb.setChangePolicy("ppm.", ChangePolicy{.relative = 0.01});
+	CHECK(!bb.set("ppm.telem.value", 1005u));
+	CHECK(bb.set("ppm.telem.value", 1011u));
+	CHECK(bb.set("ppm.telem.status", std::string{"warn"}));
+
+	// Принудительное обновление пропускает мелкое изменение, минимальный интервал - нет
+	bb.setChangePolicy("temp", ChangePolicy{.absolute = 1.0, .refresh = std::chrono::milliseconds{20}});
+	bb.set("temp.telem.value", 20.0f);
+	CHECK(!bb.set("temp.telem.value", 20.1f));
+	std::this_thread::sleep_for(std::chrono::milliseconds{30});
+	CHECK(bb.set("temp.telem.value", 20.1f));
+
+	// Неизменное значение до истечения refresh молчит, после - публикуется заново
+	CountingObserver steady;
+	bb.subscribe("temp.telem.value", &steady);
+	const auto version = bb.getVersion("temp.telem.value");
+	CHECK(!bb.set("temp.telem.value", 20.1f));
+	std::this_thread::sleep_for(std::chrono::milliseconds{30});
+	CHECK(bb.set("temp.telem.value", 20.1f));
+	CHECK(steady.entryCalls == 1 && bb.getVersion("temp.telem.value") == version + 1);
+	CHECK(!bb.set("temp.telem.value", 20.1f));
+	bb.unsubscribe("temp.telem.value", &steady);
+
+	bb.setChangePolicy("level", ChangePolicy{.minInterval = std::chrono::seconds{10}});
+	bb.set("level.telem.value", 10);
+	CHECK(!bb.set("level.telem.value", 90));
+	CHECK(bb.suppressedCount() == 6);
+}
+
+static void testHistory()
+{
+	auto bb = std::make_shared<Blackboard>();
+	bb->set("ph.telem.value", 6.0f);
+	bb->enableHistory("ph.", 4);
+	bb->enableHistory("ppm.", 64);
+
+	for (int i = 1; i <= 5; ++i) {
+		bb->set("ph.telem.value", 6.0f + static_cast<float>(i));
+	}
+	bb->set("ph.telem.status", std::string{"ok"}); // Не числовая, в кольцо не идет
+
+	const int64_t now = HistoryRing::nowMs();
+	const BbHistory ph = bb->history("ph.telem.value", 0, now + 1000);
+	CHECK(ph.enabled);
+	// Кольцо на 4 отсчета: из 6 (текущее при включении + 5 записей) остались последние,
+	// один мог быть отброшен как перезаписываемый
+	CHECK(ph.samples.size() >= 3 && ph.samples.size() <= 4);
+	CHECK(!ph.samples.empty() && ph.samples.back().value == 11.0);
+	// Самый старый отсчет кольцо не гарантирует, покрытие начинается не позже следующего
+	CHECK(ph.samples.size() >= 2 && ph.coveredFromMs <= ph.samples[1].timestampMs);
+	CHECK(bb->history("ph.telem.value", 0, now + 1000, 2).samples.size() == 2);
+	CHECK(!bb->history("ph.telem.status", 0, now + 1000).enabled || bb->history("ph.telem.status", 0, now + 1000).samples.empty());
+
+	// Запись, появившаяся после включения, получает кольцо при регистрации
+	bb->set("ppm.telem.value", 900u);
+	bb->set("ppm.telem.value", 950u);
+	CHECK(bb->history("ppm.telem.value", 0, now + 1000).samples.size() == 2);
+	CHECK(!bb->history("lamp.telem.value", 0, now + 1000).enabled);
+
+	// Без БД единый запрос отвечает из памяти
+	TelemetryHistory history{bb, nullptr};
+	const auto result = history.query("ppm.telem.value", now - 60000, now + 1000);
+	CHECK(result.fromMemory == 2 && result.type == "u32");
+	CHECK(result.samples.size() == 2 && result.samples[1].value == 950.0);
+
+	CHECK(TelemetryHistory::parseTimestamp("2025-09-10 12:00:05") == 1757505605000);
+	CHECK(TelemetryHistory::formatTimestamp(1757505605999) == "2025-09-10 12:00:05");
+	CHECK(TelemetryHistory::parseTimestamp("yesterday") == -1);
+}
+
+static void testKeyDescriptors()
+{
+	static_assert(Names::kPumpMode.kIndex == BbTypes::kIndex<int>);
+	static_assert(Names::kKeys.find("pump.config.onTime")->unit == "s");
+	static_assert(Names::kKeys.find("bridge.config.mac.3") != nullptr);
+	static_assert(Names::kKeys.find("pump.telem.status") == nullptr);
+
+	auto bb = std::make_shared<Blackboard>();
+	BlackboardEntry<float> minLevel{Names::kWaterLevelMinLevel, bb};
+	minLevel = 42.5f;
+
+	// Значение кодируется по своему типу, float не читается как unsigned
+	const auto json = BbSerializers::toJson(bb->getValue(Names::kWaterLevelMinLevel).value());
+	CHECK(json.is_number_float() && json.get<float>() == 42.5f);
+
+	BbValue value;
+	const auto *key = Names::findKey("waterLevel.config.minValue");
+	CHECK(key && BbSerializers::fromJson(*key, BbSerializers::Json(17), value));
+	CHECK(bb->setValue(key->name, value) && minLevel() == 17.f);
+
+	CHECK(!BbSerializers::fromJson(Names::kPumpOnTime.kIndex, BbSerializers::Json("15"), value));
+	CHECK(BbSerializers::fromJson(Names::kPumpOnTime.kIndex, BbSerializers::Json(15), value));
+	CHECK(std::get<std::chrono::seconds>(value) == std::chrono::seconds{15});
+	CHECK(BbSerializers::toJson(BbValue{}).is_null());
+}
+
+static void testSerializerRegistry()
+{
+	// У каждого типа BbValue есть имя и все представления
+	for (const auto &serializer : BbSerializers::kRegistry) {
+		CHECK(!serializer.name.empty() && serializer.toJson && serializer.fromJson && serializer.toBinary
+			&& serializer.fromBinary && serializer.toSql);
+	}
+
+	// float - основной тип телеметрии, в БД он пишется
+	const auto level = Database::convertValue(BbValue{12.5f});
+	CHECK(level.type == "float" && level.value == 12.5);
+	CHECK(Database::convertValue(BbValue{std::chrono::seconds{30}}).type == "seconds");
+
+	bool rejected = false;
+	try {
+		Database::convertValue(BbValue{std::string{"text"}});
+	} catch (const std::runtime_error &) {
+		rejected = true;
+	}
+	CHECK(rejected);
+
+	HydroRS::MultiControllerTelem telem{};
+	telem.ph = 6.5f;
+	telem.ppmStatus = HydroRS::PPMStatus::SystemDefective;
+
+	std::vector<uint8_t> bytes;
+	const BbValue source{telem};
+	BbSerializers::of(source).toBinary(source, bytes);
+	CHECK(bytes.size() == sizeof(telem));
+
+	BbValue restored;
+	CHECK(BbSerializers::at(source.index())->fromBinary(bytes.data(), bytes.size(), restored));
+	CHECK(std::get<HydroRS::MultiControllerTelem>(restored).ph == 6.5f);
+	CHECK(!BbSerializers::at(source.index())->fromBinary(bytes.data(), bytes.size() - 1, restored));
+	CHECK(BbSerializers::at(std::variant_size_v<BbValue>) == nullptr);
+
+	const auto json = BbSerializers::toJson(source);
+	CHECK(json["ph"].get<float>() == 6.5f && json["ppmStatus"].get<unsigned>() == 2);
+
+	// Версия устройства уходит в JSON полями и читается обратно
+	const BbValue version{RS::DeviceVersion{0, 2, 1, 4, 7, 0xABCDEF01u}};
+	const auto versionJson = BbSerializers::toJson(version);
+	CHECK(versionJson.is_object() && versionJson["minor"].get<unsigned>() == 4);
+	BbValue parsed;
+	CHECK(BbSerializers::fromJson(version.index(), versionJson, parsed));
+	CHECK(BbSerializers::toJson(parsed) == versionJson);
+	auto overflow = versionJson;
+	overflow["major"] = 300;
+	CHECK(!BbSerializers::fromJson(version.index(), overflow, parsed));
+	CHECK(!BbSerializers::fromJson(version.index(), nlohmann::json{{"major", 1}}, parsed));
+}
+
+struct HoldingObserver : public AbstractEntryObserver, public AbstractPrefixObserver {
+	std::mutex mutex;
+	std::vector<BbShared> held; // Буферы, полученные вместе с оповещением
+	size_t inlineCalls = 0;
+
+	void onEntryUpdated(std::string_view, const BbValue &) override
+	{
+		std::lock_guard lock(mutex);
+		++inlineCalls;
+	}
+
+	void onEntryShared(std::string_view, const BbShared &value) override
+	{
+		std::lock_guard lock(mutex);
+		held.push_back(value);
+	}
+
+	void onPrefixUpdated(std::string_view, std::string_view, const BbValue &) override
+	{
+		std::lock_guard lock(mutex);
+		++inlineCalls;
+	}
+
+	void onPrefixChanged(const BbChange &change) override
+	{
+		if (!change.shared) {
+			AbstractPrefixObserver::onPrefixChanged(change);
+			return;
+		}
+		std::lock_guard lock(mutex);
+		held.push_back(*change.shared);
+	}
+};
+
+/// Строки и структуры рассылаются одним общим буфером на всех подписчиков, скаляры - копией
+static void testSharedPayload()
+{
+	Blackboard bb;
+	HoldingObserver first;
+	HoldingObserver second;
+	HoldingObserver prefix;
+
+	const std::string key = "pump.int.statusStr";
+	bb.subscribe(key, &first, {Delivery::Async, 8});
+	bb.subscribe(key, &second, {Delivery::Async, 8});
+	bb.subscribeToPrefix("pump.", &prefix, {Delivery::Async, 8});
+
+	const std::string status(64, 's');
+	bb.set(key, status);
+	bb.set("pump.int.counter", 1);
+
+	HydroRS::MultiControllerTelem telem{};
+	telem.ph = 7.f;
+	bb.set("pump.rs.data", telem);
+
+	bb.unsubscribe(key, &first);
+	bb.unsubscribe(key, &second);
+	bb.unsubscribeFromPrefix("pump.", &prefix);
+
+	CHECK(first.held.size() == 1 && second.held.size() == 1 && prefix.held.size() == 2);
+	CHECK(first.held[0] == second.held[0] && first.held[0] == prefix.held[0]);
+	CHECK(std::get<std::string>(*first.held[0]) == status);
+	CHECK(std::get<HydroRS::MultiControllerTelem>(*prefix.held[1]).ph == 7.f);
+	CHECK(prefix.inlineCalls == 1);
+
+	// Срез получает тот же буфер, что и подписчики, без новой копии
+	const auto snap = bb.snapshot();
+	const auto *entry = snap->find(key);
+	CHECK(entry && entry->held.handle() == first.held[0]);
+
+	// Удержанный буфер не меняется следующими записями
+	bb.set(key, std::string{"updated"});
+	CHECK(std::get<std::string>(*first.held[0]) == status);
+	CHECK(bb.snapshot()->find(key) && bb.snapshot()->find(key)->held.handle() != first.held[0]);
+}
+
+/// Зеркало в разделяемой памяти читается другим отображением без участия BB
+static void testShmMirror()
+{
+	const std::string name = "/pihydrowave-test-" + std::to_string(::getpid());
+	auto bb = std::make_shared<Blackboard>();
+	bb->set("waterLevel.telem.value", 12.5f);
+	bb->set("lamp.telem.value", true);
+
+	BbShmReader reader{name};
+	{
+		BbShmMirror mirror{bb, {"waterLevel."}, name, 4};
+		CHECK(mirror.isOpen());
+		CHECK(reader.open() && reader.writerAlive());
+
+		// Значение, существовавшее до старта зеркала, уже в сегменте
+		const auto level = reader.find("waterLevel.telem.value");
+		CHECK(level.has_value() && !reader.find("lamp.telem.value"));
+
+		BbShmReader::Value value;
+		CHECK(level && reader.read(*level, value) && value.tag == BbTypes::kIndex<float>);
+
+		bb->set("waterLevel.telem.value", 13.5f);
+		bb->set("waterLevel.int.statusStr", std::string{"ok"});
+		CHECK(level && reader.read(*level, value));
+
+		BbValue decoded;
+		CHECK(BbSerializers::at(value.tag)->fromBinary(value.payload.data, value.payload.size, decoded));
+		CHECK(std::get<float>(decoded) == 13.5f);
+		CHECK(reader.sequence() == bb->currentSequence());
+
+		// Опоздавшее старое оповещение не затирает свежее значение
+		const BbValue stale{1.f};
+		mirror.onPrefixChanged(BbChange{"waterLevel.", "waterLevel.telem.value", &stale, 1});
+		CHECK(level && reader.read(*level, value) && value.seq == bb->currentSequence() - 1);
+
+		const auto status = reader.find("waterLevel.int.statusStr");
+		CHECK(status && reader.read(*status, value) && value.bytes() == "ok" && !value.truncated());
+
+		// Длинная строка помечается обрезанной, удаление видно по признаку и новому номеру
+		bb->set("waterLevel.int.statusStr", std::string(BbShm::kValueSize + 10, 'x'));
+		CHECK(status && reader.read(*status, value) && value.truncated() && value.payload.size == BbShm::kValueSize);
+		bb->remove("waterLevel.int.statusStr");
+		CHECK(status && reader.read(*status, value) && value.removed() && value.tag == 0);
+		CHECK(value.seq == bb->currentSequence() && reader.sequence() == bb->currentSequence());
+
+		// Сверх емкости записи не зеркалируются
+		for (int i = 0; i < 4; ++i) {
+			bb->set("waterLevel.int.extra" + std::to_string(i), i);
+		}
+		CHECK(reader.size() == 4);
+	}
+
+	// После остановки писателя сегмент удален
+	CHECK(!reader.writerAlive());
+	BbShmReader late{name};
+	CHECK(!late.open());
+}
+
+struct RecordingBusObserver : public EventBusObserver {
+	std::mutex mutex;
+	std::vector<uint32_t> targets;
+	std::vector<bool> states;
+	std::thread::id thread;
+
+	void handleEvent(const BusEvent &aEvent) override
+	{
+		std::lock_guard lock(mutex);
+		targets.push_back(aEvent.target);
+		if (const auto *pump = aEvent.as<Events::PumpSetState>()) {
+			states.push_back(pump->enabled);
+		} else if (const auto *lamp = aEvent.as<Events::LampSetState>()) {
+			states.push_back(lamp->enabled);
+		}
+		thread = std::this_thread::get_id();
+	}
+
+	void subscribe(EventBus &aBus)
+	{
+		aBus.registerObserver(EventType::PumpSetState, this);
+		aBus.registerObserver(EventType::LampSetState, this);
+	}
+};
+
+static bool waitDispatched(const EventBus &aBus, uint64_t aCount)
+{
+	for (int i = 0; i < 2000 && aBus.stats().dispatched < aCount; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+	return aBus.stats().dispatched == aCount;
+}
+
+/// Шина доставляет события из нескольких потоков в потоке диспетчера, переполнение по политике
+static void testEventBusDispatch()
+{
+	{
+		// Без диспетчера очередь заполняется и лишнее отбрасывается
+		RecordingBusObserver observer;
+		EventBus bus{4, EventOverflow::Drop};
+		bus.setCoalescing(EventType::PumpSetState, false);
+		observer.subscribe(bus);
+
+		size_t accepted = 0;
+		for (uint32_t i = 0; i < 10; ++i) {
+			accepted += bus.sendEvent(Events::PumpSetState{true}, EventPriority::Command, i) ? 1 : 0;
+		}
+		CHECK(accepted == 4 && bus.stats().dropped == 6 && bus.stats().depth == 4);
+
+		bus.start();
+		CHECK(waitDispatched(bus, 4));
+		std::lock_guard lock(observer.mutex);
+		CHECK((observer.targets == std::vector<uint32_t>{0, 1, 2, 3}));
+		CHECK(observer.thread != std::this_thread::get_id());
+	}
+
+	{
+		// В режиме Block отправители ждут место, ничего не теряется и порядок каждого отправителя сохраняется
+		RecordingBusObserver observer;
+		EventBus bus{8, EventOverflow::Block};
+		bus.setCoalescing(EventType::LampSetState, false);
+		observer.subscribe(bus);
+		bus.start();
+
+		constexpr uint32_t kProducers = 4;
+		constexpr uint32_t kPerProducer = 2000;
+		std::vector<std::thread> producers;
+		for (uint32_t p = 0; p < kProducers; ++p) {
+			producers.emplace_back([&bus, p]() {
+				for (uint32_t i = 0; i < kPerProducer; ++i) {
+					bus.sendEvent(Events::LampSetState{true}, EventPriority::Command, p * kPerProducer + i);
+				}
+			});
+		}
+		for (auto &producer : producers) {
+			producer.join();
+		}
+
+		CHECK(waitDispatched(bus, kProducers * kPerProducer));
+		CHECK(bus.stats().dropped == 0);
+
+		std::lock_guard lock(observer.mutex);
+		std::vector<int64_t> last(kProducers, -1);
+		bool ordered = true;
+		for (uint32_t target : observer.targets) {
+			ordered = ordered && target > last[target / kPerProducer];
+			last[target / kPerProducer] = target;
+		}
+		CHECK(ordered && observer.targets.size() == kProducers * kPerProducer);
+
+		bus.stop();
+		CHECK(!bus.sendEvent(Events::LampSetState{false}));
+	}
+}
+
+/// Событие Safety обгоняет очередь рутинных, переполнение рутинного класса его не вытесняет
+static void testEventBusPriority()
+{
+	RecordingBusObserver observer;
+	RecordingBusObserver pumpOnly;
+	EventBus bus{4, EventOverflow::Drop};
+	bus.setCoalescing(EventType::PumpSetState, false);
+	bus.setCoalescing(EventType::LampSetState, false);
+	observer.subscribe(bus);
+	bus.registerObserver(EventType::PumpSetState, &pumpOnly);
+
+	for (uint32_t i = 0; i < 6; ++i) {
+		bus.sendEvent(Events::LampSetState{true}, EventPriority::Routine, i);
+	}
+	bus.sendEvent(Events::LampSetState{true}, EventPriority::Command, 10);
+	CHECK(bus.sendEvent(Events::PumpSetState{false}, EventPriority::Safety, 100));
+
+	EventBusStats stats = bus.stats();
+	CHECK(stats.lane(EventPriority::Routine).dropped == 2 && stats.lane(EventPriority::Routine).depth == 4);
+	CHECK(stats.lane(EventPriority::Safety).depth == 1 && stats.lane(EventPriority::Safety).dropped == 0);
+	CHECK(stats.depth == 6 && stats.dropped == 2);
+
+	bus.start();
+	CHECK(waitDispatched(bus, 6));
+	{
+		std::lock_guard lock(observer.mutex);
+		CHECK((observer.targets == std::vector<uint32_t>{100, 10, 0, 1, 2, 3}));
+	}
+	{
+		// Подписчик одного типа видит только его
+		std::lock_guard lock(pumpOnly.mutex);
+		CHECK((pumpOnly.targets == std::vector<uint32_t>{100}));
+	}
+
+	stats = bus.stats();
+	CHECK(stats.lane(EventPriority::Safety).dispatched == 1 && stats.lane(EventPriority::Safety).latency.count == 1);
+	CHECK(stats.lane(EventPriority::Command).dispatched == 1);
+	CHECK(stats.lane(EventPriority::Routine).latency.count == 4 && stats.depth == 0);
+}
+
+/// Ожидающая команда одного адресата заменяется новой, совпадающая отбрасывается, срочная обгоняет
+static void testEventBusCoalescing()
+{
+	auto drained = [](const EventBus &aBus) {
+		for (int i = 0; i < 2000 && aBus.stats().depth; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+		return aBus.stats().depth == 0;
+	};
+
+	{
+		RecordingBusObserver observer;
+		EventBus bus{4, EventOverflow::Drop};
+		observer.subscribe(bus);
+
+		bus.sendEvent(Events::PumpSetState{true});
+		bus.sendEvent(Events::PumpSetState{true});
+		bus.sendEvent(Events::PumpSetState{false});
+		bus.sendEvent(Events::LampSetState{false}, EventPriority::Command, 1);
+		bus.sendEvent(Events::LampSetState{true}, EventPriority::Command, 2);
+		for (int i = 0; i < 100; ++i) {
+			CHECK(bus.sendEvent(Events::LampSetState{i % 2 == 0}, EventPriority::Command, 1));
+		}
+
+		EventBusStats stats = bus.stats();
+		CHECK(stats.depth == 3 && stats.dropped == 0);
+		CHECK(stats.coalesced == 101 && stats.deduplicated == 1);
+
+		bus.start();
+		CHECK(waitDispatched(bus, 3));
+		{
+			std::lock_guard lock(observer.mutex);
+			CHECK((observer.targets == std::vector<uint32_t>{0, 1, 2}));
+			CHECK((observer.states == std::vector<bool>{false, false, true}));
+		}
+
+		// После рассылки повтор той же команды снова уходит
+		bus.sendEvent(Events::PumpSetState{false});
+		CHECK(waitDispatched(bus, 4));
+	}
+
+	{
+		// Выключение поверх ожидающего включения переходит в класс Safety, старая метка устаревает.
+		// Следующая команда заменяет значение, но остается в классе Safety
+		RecordingBusObserver observer;
+		EventBus bus{4, EventOverflow::Drop};
+		observer.subscribe(bus);
+
+		bus.sendEvent(Events::LampSetState{true}, EventPriority::Routine, 1);
+		bus.sendEvent(Events::PumpSetState{true}, EventPriority::Command);
+		bus.sendEvent(Events::PumpSetState{false}, EventPriority::Safety);
+		bus.sendEvent(Events::PumpSetState{true}, EventPriority::Command);
+
+		bus.start();
+		CHECK(waitDispatched(bus, 2) && drained(bus));
+		std::lock_guard lock(observer.mutex);
+		CHECK((observer.targets == std::vector<uint32_t>{0, 1}));
+		CHECK((observer.states == std::vector<bool>{true, true}));
+
+		const EventBusStats stats = bus.stats();
+		CHECK(stats.lane(EventPriority::Command).superseded == 1 && stats.lane(EventPriority::Safety).dispatched == 1);
+	}
+}
+
+struct CountingBusObserver : public EventBusObserver {
+	std::atomic<uint64_t> enabled{0};
+
+	void handleEvent(const BusEvent &aEvent) override
+	{
+		if (const auto *pump = aEvent.as<Events::PumpSetState>(); pump && pump->enabled) {
+			enabled.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+};
+
+/// Нагрузка лежит в ячейке очереди: отправка и рассылка не выделяют память ни в одном потоке
+static void testEventBusDoesNotAllocate()
+{
+	CountingBusObserver observer;
+	EventBus bus{16, EventOverflow::Block};
+	bus.registerObserver(EventType::PumpSetState, &observer);
+	bus.start();
+
+	// Первая склеиваемая команда адресата заводит слот, дальше он переиспользуется
+	bus.sendEvent(Events::PumpSetState{true}, EventPriority::Command, 1);
+	CHECK(waitDispatched(bus, 1));
+
+	bus.setCoalescing(EventType::PumpSetState, false);
+	const size_t before = allocations.load();
+	for (uint32_t i = 0; i < 1000; ++i) {
+		bus.sendEvent(Events::PumpSetState{i % 2 == 0}, i % 3 ? EventPriority::Command : EventPriority::Safety, i);
+	}
+	bus.setCoalescing(EventType::PumpSetState, true);
+	for (uint32_t i = 0; i < 100; ++i) {
+		bus.sendEvent(Events::PumpSetState{i % 2 == 0}, EventPriority::Command, 1);
+	}
+	const bool drained = waitDispatched(bus, bus.stats().sent);
+	CHECK(allocations.load() == before);
+
+	CHECK(drained && observer.enabled.load() >= 500);
+}
+
+/// Планировщик: не раньше срока, дальние сроки через старшие уровни колеса, снятие задач, сон без опроса
+static void testScheduler()
+{
+	using namespace std::chrono;
+	Scheduler scheduler{microseconds{100}};
+
+	std::atomic<int> periodic{0};
+	std::atomic<int> limited{0};
+	std::atomic<int64_t> nearUs{0};
+	std::atomic<int64_t> farUs{0};
+	std::atomic<bool> cancelled{false};
+
+	// Задержка отсчитывается от вызова, добавившего задачу
+	const auto since = [](Scheduler::Clock::time_point aFrom) {
+		return duration_cast<microseconds>(Scheduler::Clock::now() - aFrom).count();
+	};
+
+	scheduler.every("periodic", milliseconds{20}, [&]() {
+		++periodic;
+		return true;
+	});
+	scheduler.every("limited", milliseconds{5}, [&]() { return ++limited < 3; }, milliseconds{0});
+	// 100 тиков - первый уровень, 5000 тиков - второй
+	const auto nearFrom = Scheduler::Clock::now();
+	scheduler.after("near", milliseconds{10}, [&, nearFrom]() { nearUs = since(nearFrom); });
+	const auto farFrom = Scheduler::Clock::now();
+	scheduler.after("far", milliseconds{500}, [&, farFrom]() { farUs = since(farFrom); });
+	const Scheduler::TaskId doomed = scheduler.after("doomed", milliseconds{50}, [&]() { cancelled = true; });
+	CHECK(scheduler.cancel(doomed));
+	CHECK(!scheduler.cancel(doomed));
+	scheduler.start();
+
+	for (int i = 0; i < 2000 && farUs.load() == 0; ++i) {
+		std::this_thread::sleep_for(milliseconds{1});
+	}
+	scheduler.stop();
+
+	CHECK(nearUs.load() >= 10000);
+	CHECK(farUs.load() >= 500000);
+	CHECK(!cancelled.load());
+	CHECK(limited.load() == 3);
+
+	// Сетка 20 мс за полсекунды, с запасом на медленную машину
+	const SchedulerStats stats = scheduler.stats();
+	CHECK(periodic.load() >= 10 && periodic.load() <= 26);
+	CHECK(stats.tasks == 1);
+	CHECK(stats.fired == static_cast<uint64_t>(periodic.load() + limited.load() + 2));
+	// Поток просыпается к срокам, а не каждый тик
+	CHECK(stats.wakeups <= 2 * stats.fired + 10);
+
+	// Задача, добавленная посреди тика, не срабатывает раньше задержки
+	Scheduler coarse{milliseconds{10}};
+	std::this_thread::sleep_for(milliseconds{15});
+	std::atomic<int64_t> coarseUs{0};
+	const auto coarseFrom = Scheduler::Clock::now();
+	coarse.after("coarse", milliseconds{10}, [&, coarseFrom]() { coarseUs = since(coarseFrom); });
+	coarse.start();
+	for (int i = 0; i < 200 && coarseUs.load() == 0; ++i) {
+		std::this_thread::sleep_for(milliseconds{1});
+	}
+	coarse.stop();
+	CHECK(coarseUs.load() >= 10000);
+}
+
+static void testSchedulerBackground()
+{
+	using namespace std::chrono;
+	Scheduler scheduler{milliseconds{1}};
+
+	std::atomic<int> fast{0};
+	std::atomic<int> slow{0};
+	std::atomic<bool> busy{false};
+	std::atomic<bool> overlapped{false};
+
+	scheduler.every("fast", milliseconds{5}, [&]() {
+		++fast;
+		return true;
+	});
+	// Вызов дольше периода: следующие сроки пропускаются, а не копятся
+	scheduler.background("slow", milliseconds{10}, [&]() {
+		if (busy.exchange(true)) {
+			overlapped = true;
+		}
+		std::this_thread::sleep_for(milliseconds{50});
+		busy = false;
+		return ++slow < 3;
+	});
+	scheduler.start();
+	std::this_thread::sleep_for(milliseconds{300});
+	scheduler.stop();
+
+	const SchedulerStats stats = scheduler.stats();
+	CHECK(!overlapped.load());
+	CHECK(slow.load() == 3);
+	// На общем потоке три вызова по 50 мс съели бы половину сроков быстрой задачи
+	CHECK(fast.load() >= 40);
+	CHECK(stats.overruns > 0);
+	CHECK(stats.tasks == 1);
+}
+
 int main()
 {
-return 0;
+	testScalarSetGetDoesNotAllocate();
+	testTelemetryStructDoesNotAllocate();
+	testPrefixAndSegmentSemantics();
+	testTypeChangeRejected();
+	testValidatorChain();
+	testBatchCoalescesNotifications();
+	testAsyncDeliveryIsOrderedAndBounded();
+	testRateLimitedSubscription();
+	testInstrumentation();
+	testChangesSince();
+	testDeliveredSequence();
+	testSnapshot();
+	testStateFileRoundTrip();
+	testShardedQuery();
+	testChangePolicy();
+	testHistory();
+	testKeyDescriptors();
+	testSerializerRegistry();
+	testSharedPayload();
+	testShmMirror();
+	testEventBusDispatch();
+	testEventBusPriority();
+	testEventBusCoalescing();
+	testEventBusDoesNotAllocate();
+	testScheduler();
+	testSchedulerBackground();
+
+	if (failures) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+
+	return 0;
 }
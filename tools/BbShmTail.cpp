@@ -0,0 +1,142 @@
+/*!
+@file
+@brief Пример читателя зеркала Blackboard: печатает изменения записей из разделяемой памяти
+@author V-Nezlo (vlladimirka@gmail.com)
+@date 10.09.2025
+@version 1.0
+*/
+
+#include "BbSerializers.hpp"
+#include "shm/BbShmReader.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// BbShmTail [-n имя_сегмента] [-p период_мс] [-1] [префикс...]
+// Без префиксов печатает все записи сегмента. -1 - напечатать текущие значения и выйти
+
+struct TailOptions {
+	std::string name = BbShm::kDefaultName;
+	std::chrono::milliseconds period{200};
+	bool once = false;
+	std::vector<std::string> prefixes;
+};
+
+static bool parseArgs(int argc, char **argv, TailOptions &aOptions)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "-n" && hasValue) {
+			aOptions.name = argv[++i];
+		} else if (arg == "-p" && hasValue) {
+			aOptions.period = std::chrono::milliseconds{std::strtoul(argv[++i], nullptr, 10)};
+		} else if (arg == "-1") {
+			aOptions.once = true;
+		} else if (arg.starts_with("-")) {
+			return false;
+		} else {
+			aOptions.prefixes.emplace_back(arg);
+		}
+	}
+	return true;
+}
+
+static bool selected(const TailOptions &aOptions, std::string_view aKey)
+{
+	if (aOptions.prefixes.empty()) {
+		return true;
+	}
+	for (const auto &prefix : aOptions.prefixes) {
+		if (aKey.starts_with(prefix)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static std::string format(const BbShmReader::Value &aValue)
+{
+	if (aValue.removed()) {
+		return "<removed>";
+	}
+
+	BbValue value;
+	const auto *serializer = BbSerializers::at(aValue.tag);
+	const auto bytes = aValue.bytes();
+	if (!serializer || !serializer->fromBinary(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size(), value)) {
+		return "<tag " + std::to_string(aValue.tag) + ">";
+	}
+	return BbSerializers::toJson(value).dump() + (aValue.truncated() ? " <truncated>" : "");
+}
+
+int main(int argc, char **argv)
+{
+	TailOptions options;
+	if (!parseArgs(argc, argv, options)) {
+		std::fprintf(stderr, "Usage: %s [-n segment] [-p period_ms] [-1] [prefix...]\n", argv[0]);
+		return 1;
+	}
+
+	BbShmReader reader{options.name};
+	std::vector<uint64_t> printed; // Последний напечатанный номер изменения по слотам
+	uint64_t lastSequence = UINT64_MAX;
+	auto lastLivenessCheck = std::chrono::steady_clock::now();
+
+	while (true) {
+		if (!reader.isOpen()) {
+			if (!reader.open()) {
+				if (options.once) {
+					std::fprintf(stderr, "Segment %s is not available\n", options.name.c_str());
+					return 1;
+				}
+				std::this_thread::sleep_for(std::chrono::seconds{1});
+				continue;
+			}
+			printed.clear();
+			lastSequence = UINT64_MAX;
+		}
+
+		// Опрос идет по общей памяти без системных вызовов, пока номер изменения стоит - печатать нечего
+		const uint64_t sequence = reader.sequence();
+		if (sequence != lastSequence) {
+			lastSequence = sequence;
+			printed.resize(reader.size(), 0);
+
+			BbShmReader::Value value;
+			for (size_t i = 0; i < printed.size(); ++i) {
+				const auto key = reader.key(i);
+				if (!selected(options, key) || !reader.read(i, value) || (value.tag == 0 && !value.removed())
+					|| (printed[i] != 0 && value.seq == printed[i])) {
+					continue;
+				}
+
+				printed[i] = value.seq;
+				std::printf("%llu %.*s = %s\n", static_cast<unsigned long long>(value.seq), static_cast<int>(key.size()),
+					key.data(), format(value).c_str());
+			}
+			std::fflush(stdout);
+		}
+
+		if (options.once) {
+			return 0;
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastLivenessCheck > std::chrono::seconds{2}) {
+			lastLivenessCheck = now;
+			if (!reader.writerAlive()) {
+				reader.close();
+			}
+		}
+
+		std::this_thread::sleep_for(options.period);
+	}
+}